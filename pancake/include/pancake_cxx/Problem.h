@@ -28,6 +28,33 @@ namespace pancake
 class Problem
 {
 public:
+  /**
+   * Handle to a scalar key/value pair resolved once by @ref key, for keys
+   * read at every iteration.  Reads through a handle neither allocate nor
+   * throw.
+   */
+  template <typename T>
+  class Key
+  {
+  public:
+    Key() : resolved(false), constant(false), cached(false), val() {}
+
+    /**
+     * @returns true if the key is defined with the type of the handle
+     */
+    inline bool defined() const { return resolved; }
+
+  private:
+    friend class Problem;
+
+    std::string name;
+    bool resolved;
+    bool constant;
+    bool cached;
+    size_t dims[TINF_PROBLEM_MAX_RANK];
+    T val;
+  };
+
   /**
    * Construct a Problem object from an opaque problem pointer.
    *
@@ -1008,6 +1035,73 @@ public:
     return false;
   }
 
+  /**
+   * Resolve a scalar key into a typed handle.
+   *
+   * @param key  Variable key
+   * @param constant  The value never changes, it is read once and cached
+   * @returns Handle for @ref value
+   **/
+  template <typename T>
+  inline Key<T>
+  key(const char *key, bool constant = false)
+  {
+    Key<T> handle;
+    handle.name = key;
+    handle.constant = constant;
+    resolve(handle);
+    return handle;
+  }
+
+  /**
+   * Retrieve the value of a resolved key.  A key that was not defined when
+   * it was resolved is looked up again until it is.
+   *
+   * @param handle  Handle from @ref key
+   * @param val  Pointer to typename T
+   * @returns true if key/value defined as typename T
+   **/
+  template <typename T>
+  inline bool
+  value(Key<T> &handle, T *val)
+  {
+    if (handle.cached)
+    {
+      *val = handle.val;
+      return true;
+    }
+    if (!handle.resolved && !resolve(handle))
+      return false;
+    if (TINF_SUCCESS != tinf_problem_value(problem, handle.name.c_str(),
+                                           handle.name.size(), val, 0,
+                                           handle.dims))
+      return false;
+    if (handle.constant)
+    {
+      handle.val = *val;
+      handle.cached = true;
+    }
+    return true;
+  }
+
+private:
+  template <typename T>
+  inline bool
+  resolve(Key<T> &handle)
+  {
+    enum TINF_DATA_TYPE type;
+    enum TINF_DATA_TYPE template_type;
+    int32_t rank;
+    int32_t err;
+    if (TINF_SUCCESS != tinf_type<T>(template_type))
+      return false;
+    handle.resolved =
+        tinf_problem_defined(problem, handle.name.c_str(), handle.name.size(),
+                             &type, &rank, handle.dims, &err) &&
+        TINF_SUCCESS == err && template_type == type && 0 == rank;
+    return handle.resolved;
+  }
+
 private:
   void *problem;
 };
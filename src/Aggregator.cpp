@@ -0,0 +1,199 @@
+/*
+ *  Notices:
+ *  Copyright 2023 United States Government as represented by the
+ *  Administrator of the National Aeronautics and Space Administration.
+ *  No copyright is claimed in the United States under Title 17,
+ *  U.S. Code. All Other Rights Reserved.
+ *
+ *  Disclaimers No Warranty: THE SUBJECT SOFTWARE IS PROVIDED "AS
+ *  IS" WITHOUT ANY WARRANTY OF ANY KIND, EITHER EXPRESSED, IMPLIED,
+ *  OR STATUTORY, INCLUDING, BUT NOT LIMITED TO, ANY WARRANTY THAT
+ *  THE SUBJECT SOFTWARE WILL CONFORM TO SPECIFICATIONS, ANY IMPLIED
+ *  WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE,
+ *  OR FREEDOM FROM INFRINGEMENT, ANY WARRANTY THAT THE SUBJECT
+ *  SOFTWARE WILL BE ERROR FREE, OR ANY WARRANTY THAT DOCUMENTATION,
+ *  IF PROVIDED, WILL CONFORM TO THE SUBJECT SOFTWARE. THIS AGREEMENT
+ *  DOES NOT, IN ANY MANNER, CONSTITUTE AN ENDORSEMENT BY GOVERNMENT
+ *  AGENCY OR ANY PRIOR RECIPIENT OF ANY RESULTS, RESULTING DESIGNS,
+ *  HARDWARE, SOFTWARE PRODUCTS OR ANY OTHER APPLICATIONS RESULTING
+ *  FROM USE OF THE SUBJECT SOFTWARE.  FURTHER, GOVERNMENT AGENCY
+ *  DISCLAIMS ALL WARRANTIES AND LIABILITIES REGARDING THIRD-PARTY
+ *  SOFTWARE, IF PRESENT IN THE ORIGINAL SOFTWARE, AND DISTRIBUTES
+ *  IT "AS IS." 
+ *
+ *  Waiver and Indemnity:  RECIPIENT AGREES TO WAIVE ANY AND ALL
+ *  CLAIMS AGAINST THE UNITED STATES GOVERNMENT, ITS CONTRACTORS
+ *  AND SUBCONTRACTORS, AS WELL AS ANY PRIOR RECIPIENT.  IF RECIPIENT'S
+ *  USE OF THE SUBJECT SOFTWARE RESULTS IN ANY LIABILITIES, DEMANDS,
+ *  DAMAGES, EXPENSES OR LOSSES ARISING FROM SUCH USE, INCLUDING
+ *  ANY DAMAGES FROM PRODUCTS BASED ON, OR RESULTING FROM, RECIPIENT'S
+ *  USE OF THE SUBJECT SOFTWARE, RECIPIENT SHALL INDEMNIFY AND HOLD
+ *  HARMLESS THE UNITED STATES GOVERNMENT, ITS CONTRACTORS AND
+ *  SUBCONTRACTORS, AS WELL AS ANY PRIOR RECIPIENT, TO THE EXTENT
+ *  PERMITTED BY LAW.  RECIPIENT'S SOLE REMEDY FOR ANY SUCH MATTER
+ *  SHALL BE THE IMMEDIATE, UNILATERAL TERMINATION OF THIS AGREEMENT.
+ */
+
+#ifdef __GNUG__
+  #pragma implementation "Aggregator.h"
+#endif
+
+#include <exception>
+#include <stdexcept>
+#include <string>
+#include <sstream>
+#include <algorithm>
+#include <iostream>
+
+#include "Aggregator.h"
+#include "tinf_iris.h"
+#include "TinfCheck.h"
+
+using namespace VisKombyne;
+
+namespace
+{
+
+/** Largest message of the gather, in bytes */
+const int64_t CHUNK = (int64_t)1 << 30;
+
+} // namespace
+
+Aggregator::Aggregator(void* comm, const std::string& format,
+                       const WriterOptions& options, int32_t per_node,
+                       bool shared, WriteQueue* queue) :
+  m_group(MPI_COMM_NULL), m_writers(MPI_COMM_NULL), m_writers_comm(NULL),
+  m_domain(0), m_writer(NULL), m_queue(queue)
+{
+  int32_t error;
+
+  MPI_Comm mpi_comm = MPI_Comm_f2c(tinf_iris_get_mpi_fcomm(comm, &error));
+  TINF_CHECK_SUCCESS(error, "Could not get MPI communicator");
+  int32_t rank = tinf_iris_rank(comm, &error);
+  TINF_CHECK_SUCCESS(error, "Could not get rank");
+
+  /* Aggregation groups are split from the ranks sharing a node, which need
+   * not be contiguous in the global rank order */
+  if( per_node > 0 ) {
+    MPI_Comm node;
+    MPI_Comm_split_type(mpi_comm, MPI_COMM_TYPE_SHARED, rank, MPI_INFO_NULL,
+                        &node);
+    int32_t local_rank, local_size;
+    MPI_Comm_rank(node, &local_rank);
+    MPI_Comm_size(node, &local_size);
+
+    int32_t groups = std::min(per_node, local_size);
+    int32_t group = (int32_t)((int64_t)local_rank*groups/local_size);
+    MPI_Comm_split(node, group, local_rank, &m_group);
+    MPI_Comm_free(&node);
+  } else {
+    MPI_Comm_split(mpi_comm, rank, rank, &m_group);
+  }
+
+  int32_t group_rank;
+  MPI_Comm_rank(m_group, &group_rank);
+  bool aggregator = (0 == group_rank);
+
+  MPI_Comm_split(mpi_comm, aggregator ? 0 : MPI_UNDEFINED, rank, &m_writers);
+
+  if( aggregator ) {
+    MPI_Comm_rank(m_writers, &m_domain);
+    MPI_Comm wcomm = shared ? m_writers : MPI_COMM_SELF;
+    error = tinf_iris_create(&m_writers_comm, MPI_Comm_c2f(wcomm));
+    TINF_CHECK_SUCCESS(error, "Could not create aggregator communicator");
+    m_writer = Writer::create(format, m_writers_comm, options);
+  }
+}
+
+Aggregator::~Aggregator()
+{
+  /* Pending writes use m_writer, a failed one must not escape the
+   * destructor */
+  try {
+    if( m_queue )
+      m_queue->flush();
+  } catch( std::exception& e ) {
+    std::cerr << "Native output failed: " << e.what() << std::endl;
+  }
+  delete m_writer;
+  if( m_writers_comm )
+    tinf_iris_destroy(m_writers_comm);
+  if( MPI_COMM_NULL != m_writers )
+    MPI_Comm_free(&m_writers);
+  if( MPI_COMM_NULL != m_group )
+    MPI_Comm_free(&m_group);
+}
+
+void Aggregator::write(const std::string& filename, const Extract& piece)
+{
+  Extract merged;
+  gather(piece, merged);
+
+  if( !aggregator() )
+    return;
+
+  std::string name = filename;
+  std::stringstream ss;
+  ss << m_domain;
+  size_t pos;
+  while( (pos=name.find("%domain")) != std::string::npos )
+    name.replace(pos, 7, ss.str());
+
+  if( m_queue )
+    m_queue->push(m_writer, name, merged);
+  else
+    m_writer->write(name, merged);
+}
+
+void Aggregator::gather(const Extract& piece, Extract& merged)
+{
+  int32_t size;
+  MPI_Comm_size(m_group, &size);
+
+  if( 1 == size ) {
+    merged = piece;
+    return;
+  }
+
+  std::vector<char> buffer;
+  piece.pack(buffer);
+
+  int64_t bytes = buffer.size();
+  std::vector<int64_t> counts(aggregator() ? size : 0);
+  MPI_Gather(&bytes, 1, MPI_INT64_T, counts.data(), 1, MPI_INT64_T, 0,
+             m_group);
+
+  /* Pieces are sent in chunks that fit the int counts of MPI, a group can
+   * gather well over 2 GiB */
+  std::vector<MPI_Request> requests;
+  std::vector<int64_t> displs(counts.size(), 0);
+  std::vector<char> recv;
+
+  if( aggregator() ) {
+    for( size_t i=1; i<counts.size(); ++i )
+      displs[i] = displs[i-1] + counts[i-1];
+    recv.resize(displs.back() + counts.back());
+    std::copy(buffer.begin(), buffer.end(), recv.begin());
+
+    for( int32_t i=1; i<size; ++i ) {
+      for( int64_t offset=0; offset<counts[i]; offset+=CHUNK ) {
+        int32_t n = (int32_t)std::min(CHUNK, counts[i]-offset);
+        requests.push_back(MPI_REQUEST_NULL);
+        MPI_Irecv(recv.data()+displs[i]+offset, n, MPI_CHAR, i, 0, m_group,
+                  &requests.back());
+      }
+    }
+    MPI_Waitall((int)requests.size(), requests.data(), MPI_STATUSES_IGNORE);
+  } else {
+    for( int64_t offset=0; offset<bytes; offset+=CHUNK ) {
+      int32_t n = (int32_t)std::min(CHUNK, bytes-offset);
+      MPI_Send(buffer.data()+offset, n, MPI_CHAR, 0, 0, m_group);
+    }
+  }
+
+  for( size_t i=0; i<counts.size(); ++i ) {
+    Extract part;
+    part.unpack(recv.data()+displs[i], counts[i]);
+    merged.append(part);
+  }
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+/*
+ *  Notices:
+ *  Copyright 2023 United States Government as represented by the
+ *  Administrator of the National Aeronautics and Space Administration.
+ *  No copyright is claimed in the United States under Title 17,
+ *  U.S. Code. All Other Rights Reserved.
+ *
+ *  Disclaimers No Warranty: THE SUBJECT SOFTWARE IS PROVIDED "AS
+ *  IS" WITHOUT ANY WARRANTY OF ANY KIND, EITHER EXPRESSED, IMPLIED,
+ *  OR STATUTORY, INCLUDING, BUT NOT LIMITED TO, ANY WARRANTY THAT
+ *  THE SUBJECT SOFTWARE WILL CONFORM TO SPECIFICATIONS, ANY IMPLIED
+ *  WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE,
+ *  OR FREEDOM FROM INFRINGEMENT, ANY WARRANTY THAT THE SUBJECT
+ *  SOFTWARE WILL BE ERROR FREE, OR ANY WARRANTY THAT DOCUMENTATION,
+ *  IF PROVIDED, WILL CONFORM TO THE SUBJECT SOFTWARE. THIS AGREEMENT
+ *  DOES NOT, IN ANY MANNER, CONSTITUTE AN ENDORSEMENT BY GOVERNMENT
+ *  AGENCY OR ANY PRIOR RECIPIENT OF ANY RESULTS, RESULTING DESIGNS,
+ *  HARDWARE, SOFTWARE PRODUCTS OR ANY OTHER APPLICATIONS RESULTING
+ *  FROM USE OF THE SUBJECT SOFTWARE.  FURTHER, GOVERNMENT AGENCY
+ *  DISCLAIMS ALL WARRANTIES AND LIABILITIES REGARDING THIRD-PARTY
+ *  SOFTWARE, IF PRESENT IN THE ORIGINAL SOFTWARE, AND DISTRIBUTES
+ *  IT "AS IS." 
+ *
+ *  Waiver and Indemnity:  RECIPIENT AGREES TO WAIVE ANY AND ALL
+ *  CLAIMS AGAINST THE UNITED STATES GOVERNMENT, ITS CONTRACTORS
+ *  AND SUBCONTRACTORS, AS WELL AS ANY PRIOR RECIPIENT.  IF RECIPIENT'S
+ *  USE OF THE SUBJECT SOFTWARE RESULTS IN ANY LIABILITIES, DEMANDS,
+ *  DAMAGES, EXPENSES OR LOSSES ARISING FROM SUCH USE, INCLUDING
+ *  ANY DAMAGES FROM PRODUCTS BASED ON, OR RESULTING FROM, RECIPIENT'S
+ *  USE OF THE SUBJECT SOFTWARE, RECIPIENT SHALL INDEMNIFY AND HOLD
+ *  HARMLESS THE UNITED STATES GOVERNMENT, ITS CONTRACTORS AND
+ *  SUBCONTRACTORS, AS WELL AS ANY PRIOR RECIPIENT, TO THE EXTENT
+ *  PERMITTED BY LAW.  RECIPIENT'S SOLE REMEDY FOR ANY SUCH MATTER
+ *  SHALL BE THE IMMEDIATE, UNILATERAL TERMINATION OF THIS AGREEMENT.
+ */
+
+#include <string>
+#include <vector>
+#include <mpi.h>
+
+#include "Writer.h"
+#include "WriteQueue.h"
+
+namespace VisKombyne
+{
+
+/**
+ * Node-level aggregation of native outputs.
+ *
+ * The ranks of each node (MPI_COMM_TYPE_SHARED) are split into a number of
+ * contiguous groups, the pieces of a group are gathered on its first rank
+ * (the aggregator) and only the aggregators write.  With no aggregation
+ * every rank is its own aggregator.
+ *
+ * If the file name contains "%domain" each aggregator writes its own file
+ * with "%domain" replaced by the aggregator index, otherwise the
+ * aggregators write collectively to a single shared file.
+ */
+class Aggregator : public Writer
+{
+  public:
+    /**
+     * Constructor.
+     *
+     * @param comm  Communications object of all ranks
+     * @param format  Output format written by the aggregators
+     * @param options  Writer options
+     * @param per_node  Number of aggregators per node (0 for none)
+     * @param shared  Aggregators write a single shared file
+     * @param queue  Queue of the aggregated outputs (NULL writes directly)
+     */
+    Aggregator(void* comm, const std::string& format,
+               const WriterOptions& options, int32_t per_node, bool shared,
+               WriteQueue* queue=NULL);
+    virtual ~Aggregator();
+
+    virtual void write(const std::string& filename, const Extract& piece);
+
+    inline bool aggregator() const { return NULL != m_writer; }
+
+  private:
+    inline void gather(const Extract& piece, Extract& merged);
+
+  private:
+    MPI_Comm m_group;
+    MPI_Comm m_writers;
+    void* m_writers_comm;
+    int32_t m_domain;
+    Writer* m_writer;
+    WriteQueue* m_queue;
+};
+
+} // namespace VisKombyne
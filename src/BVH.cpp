@@ -0,0 +1,131 @@
+/*
+ *  Notices:
+ *  Copyright 2023 United States Government as represented by the
+ *  Administrator of the National Aeronautics and Space Administration.
+ *  No copyright is claimed in the United States under Title 17,
+ *  U.S. Code. All Other Rights Reserved.
+ *
+ *  Disclaimers No Warranty: THE SUBJECT SOFTWARE IS PROVIDED "AS
+ *  IS" WITHOUT ANY WARRANTY OF ANY KIND, EITHER EXPRESSED, IMPLIED,
+ *  OR STATUTORY, INCLUDING, BUT NOT LIMITED TO, ANY WARRANTY THAT
+ *  THE SUBJECT SOFTWARE WILL CONFORM TO SPECIFICATIONS, ANY IMPLIED
+ *  WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE,
+ *  OR FREEDOM FROM INFRINGEMENT, ANY WARRANTY THAT THE SUBJECT
+ *  SOFTWARE WILL BE ERROR FREE, OR ANY WARRANTY THAT DOCUMENTATION,
+ *  IF PROVIDED, WILL CONFORM TO THE SUBJECT SOFTWARE. THIS AGREEMENT
+ *  DOES NOT, IN ANY MANNER, CONSTITUTE AN ENDORSEMENT BY GOVERNMENT
+ *  AGENCY OR ANY PRIOR RECIPIENT OF ANY RESULTS, RESULTING DESIGNS,
+ *  HARDWARE, SOFTWARE PRODUCTS OR ANY OTHER APPLICATIONS RESULTING
+ *  FROM USE OF THE SUBJECT SOFTWARE.  FURTHER, GOVERNMENT AGENCY
+ *  DISCLAIMS ALL WARRANTIES AND LIABILITIES REGARDING THIRD-PARTY
+ *  SOFTWARE, IF PRESENT IN THE ORIGINAL SOFTWARE, AND DISTRIBUTES
+ *  IT "AS IS." 
+ *
+ *  Waiver and Indemnity:  RECIPIENT AGREES TO WAIVE ANY AND ALL
+ *  CLAIMS AGAINST THE UNITED STATES GOVERNMENT, ITS CONTRACTORS
+ *  AND SUBCONTRACTORS, AS WELL AS ANY PRIOR RECIPIENT.  IF RECIPIENT'S
+ *  USE OF THE SUBJECT SOFTWARE RESULTS IN ANY LIABILITIES, DEMANDS,
+ *  DAMAGES, EXPENSES OR LOSSES ARISING FROM SUCH USE, INCLUDING
+ *  ANY DAMAGES FROM PRODUCTS BASED ON, OR RESULTING FROM, RECIPIENT'S
+ *  USE OF THE SUBJECT SOFTWARE, RECIPIENT SHALL INDEMNIFY AND HOLD
+ *  HARMLESS THE UNITED STATES GOVERNMENT, ITS CONTRACTORS AND
+ *  SUBCONTRACTORS, AS WELL AS ANY PRIOR RECIPIENT, TO THE EXTENT
+ *  PERMITTED BY LAW.  RECIPIENT'S SOLE REMEDY FOR ANY SUCH MATTER
+ *  SHALL BE THE IMMEDIATE, UNILATERAL TERMINATION OF THIS AGREEMENT.
+ */
+
+#ifdef __GNUG__
+  #pragma implementation "BVH.h"
+#endif
+
+#include <algorithm>
+#include <cfloat>
+
+#include "BVH.h"
+
+using namespace VisKombyne;
+
+BVH::BVH(const std::vector<double>& boxes)
+{
+  int64_t n = boxes.size()/6;
+  m_items.resize(n);
+  for( int64_t i=0; i<n; ++i )
+    m_items[i] = i;
+  m_nodes.reserve(2*(n/LEAF_SIZE+1));
+  if( n > 0 )
+    build(0, n, boxes);
+}
+
+int64_t BVH::build(int64_t first, int64_t count,
+                   const std::vector<double>& boxes)
+{
+  int64_t index = m_nodes.size();
+  m_nodes.push_back(Node());
+
+  Node node;
+  std::fill(node.box, node.box+3, DBL_MAX);
+  std::fill(node.box+3, node.box+6, -DBL_MAX);
+  for( int64_t i=first; i<first+count; ++i ) {
+    const double* b = &boxes[6*m_items[i]];
+    for( int32_t d=0; d<3; ++d ) {
+      node.box[d] = std::min(node.box[d], b[d]);
+      node.box[d+3] = std::max(node.box[d+3], b[d+3]);
+    }
+  }
+
+  if( count <= LEAF_SIZE ) {
+    node.first = first;
+    node.count = count;
+    m_nodes[index] = node;
+    return index;
+  }
+
+  int32_t axis = 0;
+  for( int32_t d=1; d<3; ++d )
+    if( node.box[d+3]-node.box[d] > node.box[axis+3]-node.box[axis] )
+      axis = d;
+
+  int64_t half = count/2;
+  std::nth_element(m_items.begin()+first, m_items.begin()+first+half,
+                   m_items.begin()+first+count,
+                   [&](int64_t a, int64_t b) {
+                     return boxes[6*a+axis] + boxes[6*a+axis+3] <
+                            boxes[6*b+axis] + boxes[6*b+axis+3];
+                   });
+
+  /* The left child follows its parent, first holds the right child */
+  build(first, half, boxes);
+  node.first = build(first+half, count-half, boxes);
+  node.count = 0;
+  m_nodes[index] = node;
+  return index;
+}
+
+void BVH::query(const double point[3], std::vector<int64_t>& items) const
+{
+  items.clear();
+  if( m_nodes.empty() )
+    return;
+
+  std::vector<int64_t> stack(1, 0);
+  while( !stack.empty() ) {
+    const Node& node = m_nodes[stack.back()];
+    int64_t index = stack.back();
+    stack.pop_back();
+
+    bool inside = true;
+    for( int32_t d=0; d<3; ++d )
+      inside &= (point[d] >= node.box[d] && point[d] <= node.box[d+3]);
+    if( !inside )
+      continue;
+
+    if( node.count > 0 ) {
+      for( int64_t i=node.first; i<node.first+node.count; ++i )
+        items.push_back(m_items[i]);
+    } else {
+      /* The left child follows its parent */
+      stack.push_back(index+1);
+      stack.push_back(node.first);
+    }
+  }
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+/*
+ *  Notices:
+ *  Copyright 2023 United States Government as represented by the
+ *  Administrator of the National Aeronautics and Space Administration.
+ *  No copyright is claimed in the United States under Title 17,
+ *  U.S. Code. All Other Rights Reserved.
+ *
+ *  Disclaimers No Warranty: THE SUBJECT SOFTWARE IS PROVIDED "AS
+ *  IS" WITHOUT ANY WARRANTY OF ANY KIND, EITHER EXPRESSED, IMPLIED,
+ *  OR STATUTORY, INCLUDING, BUT NOT LIMITED TO, ANY WARRANTY THAT
+ *  THE SUBJECT SOFTWARE WILL CONFORM TO SPECIFICATIONS, ANY IMPLIED
+ *  WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE,
+ *  OR FREEDOM FROM INFRINGEMENT, ANY WARRANTY THAT THE SUBJECT
+ *  SOFTWARE WILL BE ERROR FREE, OR ANY WARRANTY THAT DOCUMENTATION,
+ *  IF PROVIDED, WILL CONFORM TO THE SUBJECT SOFTWARE. THIS AGREEMENT
+ *  DOES NOT, IN ANY MANNER, CONSTITUTE AN ENDORSEMENT BY GOVERNMENT
+ *  AGENCY OR ANY PRIOR RECIPIENT OF ANY RESULTS, RESULTING DESIGNS,
+ *  HARDWARE, SOFTWARE PRODUCTS OR ANY OTHER APPLICATIONS RESULTING
+ *  FROM USE OF THE SUBJECT SOFTWARE.  FURTHER, GOVERNMENT AGENCY
+ *  DISCLAIMS ALL WARRANTIES AND LIABILITIES REGARDING THIRD-PARTY
+ *  SOFTWARE, IF PRESENT IN THE ORIGINAL SOFTWARE, AND DISTRIBUTES
+ *  IT "AS IS." 
+ *
+ *  Waiver and Indemnity:  RECIPIENT AGREES TO WAIVE ANY AND ALL
+ *  CLAIMS AGAINST THE UNITED STATES GOVERNMENT, ITS CONTRACTORS
+ *  AND SUBCONTRACTORS, AS WELL AS ANY PRIOR RECIPIENT.  IF RECIPIENT'S
+ *  USE OF THE SUBJECT SOFTWARE RESULTS IN ANY LIABILITIES, DEMANDS,
+ *  DAMAGES, EXPENSES OR LOSSES ARISING FROM SUCH USE, INCLUDING
+ *  ANY DAMAGES FROM PRODUCTS BASED ON, OR RESULTING FROM, RECIPIENT'S
+ *  USE OF THE SUBJECT SOFTWARE, RECIPIENT SHALL INDEMNIFY AND HOLD
+ *  HARMLESS THE UNITED STATES GOVERNMENT, ITS CONTRACTORS AND
+ *  SUBCONTRACTORS, AS WELL AS ANY PRIOR RECIPIENT, TO THE EXTENT
+ *  PERMITTED BY LAW.  RECIPIENT'S SOLE REMEDY FOR ANY SUCH MATTER
+ *  SHALL BE THE IMMEDIATE, UNILATERAL TERMINATION OF THIS AGREEMENT.
+ */
+
+#include <vector>
+#include <cstdint>
+
+namespace VisKombyne
+{
+
+/**
+ * Bounding volume hierarchy of axis aligned boxes, built by median splits
+ * along the longest axis.
+ */
+class BVH
+{
+  public:
+    /**
+     * Build the hierarchy.
+     *
+     * @param boxes  Boxes (xmin, ymin, zmin, xmax, ymax, zmax) of the items
+     */
+    BVH(const std::vector<double>& boxes);
+
+    /**
+     * Items whose box contains a point.
+     */
+    void query(const double point[3], std::vector<int64_t>& items) const;
+
+    static const int64_t LEAF_SIZE = 8;
+
+  private:
+    struct Node
+    {
+      double box[6];
+      int64_t first;   /* first item (leaf) or right child */
+      int64_t count;   /* number of items, 0 for an interior node */
+    };
+
+    int64_t build(int64_t first, int64_t count,
+                  const std::vector<double>& boxes);
+
+  private:
+    std::vector<Node> m_nodes;
+    std::vector<int64_t> m_items;
+};
+
+} // namespace VisKombyne
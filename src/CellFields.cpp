@@ -0,0 +1,135 @@
+/*
+ *  Notices:
+ *  Copyright 2023 United States Government as represented by the
+ *  Administrator of the National Aeronautics and Space Administration.
+ *  No copyright is claimed in the United States under Title 17,
+ *  U.S. Code. All Other Rights Reserved.
+ *
+ *  Disclaimers No Warranty: THE SUBJECT SOFTWARE IS PROVIDED "AS
+ *  IS" WITHOUT ANY WARRANTY OF ANY KIND, EITHER EXPRESSED, IMPLIED,
+ *  OR STATUTORY, INCLUDING, BUT NOT LIMITED TO, ANY WARRANTY THAT
+ *  THE SUBJECT SOFTWARE WILL CONFORM TO SPECIFICATIONS, ANY IMPLIED
+ *  WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE,
+ *  OR FREEDOM FROM INFRINGEMENT, ANY WARRANTY THAT THE SUBJECT
+ *  SOFTWARE WILL BE ERROR FREE, OR ANY WARRANTY THAT DOCUMENTATION,
+ *  IF PROVIDED, WILL CONFORM TO THE SUBJECT SOFTWARE. THIS AGREEMENT
+ *  DOES NOT, IN ANY MANNER, CONSTITUTE AN ENDORSEMENT BY GOVERNMENT
+ *  AGENCY OR ANY PRIOR RECIPIENT OF ANY RESULTS, RESULTING DESIGNS,
+ *  HARDWARE, SOFTWARE PRODUCTS OR ANY OTHER APPLICATIONS RESULTING
+ *  FROM USE OF THE SUBJECT SOFTWARE.  FURTHER, GOVERNMENT AGENCY
+ *  DISCLAIMS ALL WARRANTIES AND LIABILITIES REGARDING THIRD-PARTY
+ *  SOFTWARE, IF PRESENT IN THE ORIGINAL SOFTWARE, AND DISTRIBUTES
+ *  IT "AS IS." 
+ *
+ *  Waiver and Indemnity:  RECIPIENT AGREES TO WAIVE ANY AND ALL
+ *  CLAIMS AGAINST THE UNITED STATES GOVERNMENT, ITS CONTRACTORS
+ *  AND SUBCONTRACTORS, AS WELL AS ANY PRIOR RECIPIENT.  IF RECIPIENT'S
+ *  USE OF THE SUBJECT SOFTWARE RESULTS IN ANY LIABILITIES, DEMANDS,
+ *  DAMAGES, EXPENSES OR LOSSES ARISING FROM SUCH USE, INCLUDING
+ *  ANY DAMAGES FROM PRODUCTS BASED ON, OR RESULTING FROM, RECIPIENT'S
+ *  USE OF THE SUBJECT SOFTWARE, RECIPIENT SHALL INDEMNIFY AND HOLD
+ *  HARMLESS THE UNITED STATES GOVERNMENT, ITS CONTRACTORS AND
+ *  SUBCONTRACTORS, AS WELL AS ANY PRIOR RECIPIENT, TO THE EXTENT
+ *  PERMITTED BY LAW.  RECIPIENT'S SOLE REMEDY FOR ANY SUCH MATTER
+ *  SHALL BE THE IMMEDIATE, UNILATERAL TERMINATION OF THIS AGREEMENT.
+ */
+
+#ifdef __GNUG__
+  #pragma implementation "CellFields.h"
+#endif
+
+#include <exception>
+#include <stdexcept>
+#include <sstream>
+#include <algorithm>
+
+#include "CellFields.h"
+#include "Extract.h"
+#include "tinf_solution.h"
+#include "TinfCheck.h"
+
+using namespace VisKombyne;
+
+CellFields::CellFields(void* soln, UMesh& mesh,
+                       const std::vector<std::string>& names) :
+  m_soln(soln), m_mesh(mesh), m_generation(-1)
+{
+  m_fields.reserve(names.size());
+  std::vector<std::string>::const_iterator it;
+  for(it = names.begin(); it != names.end(); ++it)
+    m_fields.push_back(Field(it->c_str(), TINF_DOUBLE));
+
+  std::vector<Field>::iterator f;
+  for(f = m_fields.begin(); f != m_fields.end(); ++f) {
+    f->size(m_mesh.nCell01());
+    m_names.push_back(f->name());
+  }
+}
+
+void CellFields::centroids()
+{
+  const int32_t* conn = m_mesh.cellConnects();
+  const double* x = m_mesh.x();
+  const double* y = m_mesh.y();
+  const double* z = m_mesh.z();
+
+  m_x.resize(m_mesh.nCell01());
+  m_y.resize(m_mesh.nCell01());
+  m_z.resize(m_mesh.nCell01());
+
+  int64_t c = 0;
+  for( int64_t i=0; i<m_mesh.cellConnectsSize(); ++c ) {
+    int32_t n = Extract::nodesPerCell(conn[i++]);
+    double cx = 0.0, cy = 0.0, cz = 0.0;
+    for( int32_t j=0; j<n; ++j, ++i ) {
+      cx += x[conn[i]];
+      cy += y[conn[i]];
+      cz += z[conn[i]];
+    }
+    m_x[c] = cx/n;
+    m_y[c] = cy/n;
+    m_z[c] = cz/n;
+  }
+
+  m_generation = m_mesh.generation();
+}
+
+void CellFields::fetch(int64_t step)
+{
+  int32_t error;
+
+  if( m_fields.empty() || m_fields[0].step() == step )
+    return;
+
+  if( m_mesh.generation() != m_generation )
+    centroids();
+
+  const std::vector<int64_t>& elements = m_mesh.cellElements();
+  int64_t ncells = m_mesh.nCell01();
+  int64_t nvalues = m_names.size();
+
+  std::vector<double> batch(BATCH*nvalues);
+  for( int64_t begin=0; begin<ncells; begin+=BATCH ) {
+    int64_t end = std::min(begin+BATCH, ncells);
+
+    for( int64_t c=begin; c<end; ++c ) {
+      error = tinf_solution_get_outputs_in_cell(m_soln, TINF_DOUBLE,
+                                                TINF_DOUBLE, &m_x[c],
+                                                &m_y[c], &m_z[c],
+                                                elements[c], nvalues,
+                                                m_names.data(),
+                                                &batch[(c-begin)*nvalues]);
+      TINF_CHECK_SUCCESS(error, "Failed to retrieve Solver cell outputs");
+    }
+
+    for( int64_t v=0; v<nvalues; ++v ) {
+      double* values = m_fields[v].values();
+      for( int64_t c=begin; c<end; ++c )
+        values[c] = batch[(c-begin)*nvalues+v];
+    }
+  }
+
+  std::vector<Field>::iterator f;
+  for(f = m_fields.begin(); f != m_fields.end(); ++f)
+    f->step(step);
+}
@@ -0,0 +1,285 @@
+/*
+ *  Notices:
+ *  Copyright 2023 United States Government as represented by the
+ *  Administrator of the National Aeronautics and Space Administration.
+ *  No copyright is claimed in the United States under Title 17,
+ *  U.S. Code. All Other Rights Reserved.
+ *
+ *  Disclaimers No Warranty: THE SUBJECT SOFTWARE IS PROVIDED "AS
+ *  IS" WITHOUT ANY WARRANTY OF ANY KIND, EITHER EXPRESSED, IMPLIED,
+ *  OR STATUTORY, INCLUDING, BUT NOT LIMITED TO, ANY WARRANTY THAT
+ *  THE SUBJECT SOFTWARE WILL CONFORM TO SPECIFICATIONS, ANY IMPLIED
+ *  WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE,
+ *  OR FREEDOM FROM INFRINGEMENT, ANY WARRANTY THAT THE SUBJECT
+ *  SOFTWARE WILL BE ERROR FREE, OR ANY WARRANTY THAT DOCUMENTATION,
+ *  IF PROVIDED, WILL CONFORM TO THE SUBJECT SOFTWARE. THIS AGREEMENT
+ *  DOES NOT, IN ANY MANNER, CONSTITUTE AN ENDORSEMENT BY GOVERNMENT
+ *  AGENCY OR ANY PRIOR RECIPIENT OF ANY RESULTS, RESULTING DESIGNS,
+ *  HARDWARE, SOFTWARE PRODUCTS OR ANY OTHER APPLICATIONS RESULTING
+ *  FROM USE OF THE SUBJECT SOFTWARE.  FURTHER, GOVERNMENT AGENCY
+ *  DISCLAIMS ALL WARRANTIES AND LIABILITIES REGARDING THIRD-PARTY
+ *  SOFTWARE, IF PRESENT IN THE ORIGINAL SOFTWARE, AND DISTRIBUTES
+ *  IT "AS IS." 
+ *
+ *  Waiver and Indemnity:  RECIPIENT AGREES TO WAIVE ANY AND ALL
+ *  CLAIMS AGAINST THE UNITED STATES GOVERNMENT, ITS CONTRACTORS
+ *  AND SUBCONTRACTORS, AS WELL AS ANY PRIOR RECIPIENT.  IF RECIPIENT'S
+ *  USE OF THE SUBJECT SOFTWARE RESULTS IN ANY LIABILITIES, DEMANDS,
+ *  DAMAGES, EXPENSES OR LOSSES ARISING FROM SUCH USE, INCLUDING
+ *  ANY DAMAGES FROM PRODUCTS BASED ON, OR RESULTING FROM, RECIPIENT'S
+ *  USE OF THE SUBJECT SOFTWARE, RECIPIENT SHALL INDEMNIFY AND HOLD
+ *  HARMLESS THE UNITED STATES GOVERNMENT, ITS CONTRACTORS AND
+ *  SUBCONTRACTORS, AS WELL AS ANY PRIOR RECIPIENT, TO THE EXTENT
+ *  PERMITTED BY LAW.  RECIPIENT'S SOLE REMEDY FOR ANY SUCH MATTER
+ *  SHALL BE THE IMMEDIATE, UNILATERAL TERMINATION OF THIS AGREEMENT.
+ */
+
+#ifdef __GNUG__
+  #pragma implementation "Codec.h"
+#endif
+
+#include <stdexcept>
+#include <algorithm>
+#include <cstring>
+#include <cmath>
+
+#include "Codec.h"
+
+using namespace VisKombyne;
+
+/* Largest quantized magnitude */
+static const double MAX_QUANTUM = 2251799813685248.0; /* 2^51 */
+
+/* Adding 1.5*2^52 rounds to the nearest integer, which is then held in the
+ * low mantissa bits: a vectorizable double to int64 conversion. */
+static const double ROUNDER = 6755399441055744.0;
+static const int64_t ROUNDER_BITS = 0x4338000000000000LL;
+
+/* Lanes of the vectorizable reductions */
+static const int32_t LANES = 8;
+
+/* Maximum that keeps a NaN once one is seen */
+static inline double nanMax(double a, double b)
+{
+  return (b > a || b != b) ? b : a;
+}
+
+bool Codec::quantize(const double* values, int64_t n, double step,
+                     int64_t* q)
+{
+  const double inv = 1.0/step;
+
+  /* !(a < MAX_QUANTUM) also holds for NaN and infinities, which a running
+   * maximum would drop */
+  int32_t lane[LANES] = { 0 };
+  int64_t i = 0;
+  for( ; i+LANES<=n; i+=LANES ) {
+    for( int32_t l=0; l<LANES; ++l ) {
+      double s = values[i+l]*inv;
+      lane[l] |= !(std::fabs(s) < MAX_QUANTUM);
+      double r = s + ROUNDER;
+      int64_t bits;
+      memcpy(&bits, &r, sizeof(bits));
+      q[i+l] = bits - ROUNDER_BITS;
+    }
+  }
+  int32_t outside = 0;
+  for( ; i<n; ++i ) {
+    double s = values[i]*inv;
+    outside |= !(std::fabs(s) < MAX_QUANTUM);
+    double r = s + ROUNDER;
+    int64_t bits;
+    memcpy(&bits, &r, sizeof(bits));
+    q[i] = bits - ROUNDER_BITS;
+  }
+  for( int32_t l=0; l<LANES; ++l )
+    outside |= lane[l];
+
+  return !outside;
+}
+
+void Codec::predict(const int64_t* q, int64_t n, int64_t* residuals)
+{
+  if( n > 0 )
+    residuals[0] = q[0];
+  for( int64_t i=1; i<n; ++i )
+    residuals[i] = q[i] - q[i-1];
+}
+
+void Codec::unpredict(int64_t* q, int64_t n)
+{
+  for( int64_t i=1; i<n; ++i )
+    q[i] += q[i-1];
+}
+
+double Codec::maxError(const double* values, const int64_t* q, int64_t n,
+                       double step)
+{
+  double lane[LANES] = { 0.0 };
+  int64_t i = 0;
+  for( ; i+LANES<=n; i+=LANES ) {
+    for( int32_t l=0; l<LANES; ++l ) {
+      double e = std::fabs(values[i+l] - (double)q[i+l]*step);
+      lane[l] = nanMax(lane[l], e);
+    }
+  }
+  double error = 0.0;
+  for( ; i<n; ++i )
+    error = nanMax(error, std::fabs(values[i] - (double)q[i]*step));
+  for( int32_t l=0; l<LANES; ++l )
+    error = nanMax(error, lane[l]);
+  return error;
+}
+
+void Codec::encode(const int64_t* residuals, int64_t n,
+                   std::vector<char>& buffer)
+{
+  /* Zigzag and byte planes: small residuals leave the high planes zero */
+  std::vector<uint8_t> planes(8*n);
+  for( int32_t p=0; p<8; ++p ) {
+    uint8_t* plane = planes.data() + p*n;
+    for( int64_t i=0; i<n; ++i ) {
+      uint64_t z = ((uint64_t)residuals[i] << 1) ^
+                   (uint64_t)(residuals[i] >> 63);
+      plane[i] = (uint8_t)(z >> (8*p));
+    }
+  }
+  entropyEncode(planes.data(), planes.size(), buffer);
+}
+
+size_t Codec::decode(const char* buffer, size_t size, int64_t n,
+                     int64_t* residuals)
+{
+  std::vector<uint8_t> planes;
+  size_t used = entropyDecode(buffer, size, planes);
+  if( planes.size() != (size_t)(8*n) )
+    throw std::runtime_error("Bad compressed array size");
+
+  std::fill(residuals, residuals+n, 0);
+  for( int32_t p=0; p<8; ++p ) {
+    const uint8_t* plane = planes.data() + p*n;
+    for( int64_t i=0; i<n; ++i )
+      residuals[i] |= (int64_t)((uint64_t)plane[i] << (8*p));
+  }
+  for( int64_t i=0; i<n; ++i ) {
+    uint64_t z = (uint64_t)residuals[i];
+    residuals[i] = (int64_t)(z >> 1) ^ -(int64_t)(z & 1);
+  }
+  return used;
+}
+
+/*
+ * Stream: uint64 count, uint16 frequencies[256] summing to PROB_SCALE,
+ * uint64 payload size and the rANS payload.
+ */
+void Codec::entropyEncode(const uint8_t* data, size_t n,
+                          std::vector<char>& buffer)
+{
+  uint64_t count[256] = { 0 };
+  for( size_t i=0; i<n; ++i )
+    ++count[data[i]];
+
+  /* Normalize the frequencies, every present symbol keeps at least 1 */
+  uint32_t freq[256] = { 0 };
+  uint32_t sum = 0;
+  for( int32_t s=0; s<256; ++s ) {
+    if( count[s] ) {
+      freq[s] = std::max<uint64_t>(1, count[s]*PROB_SCALE/n);
+      sum += freq[s];
+    }
+  }
+
+  /* Rare symbols rounded up to 1 can push the sum over the scale, take the
+   * excess one at a time from the most frequent symbols (at most 256 steps,
+   * PROB_SCALE is well above the symbol count so one is always above 1),
+   * then give any remainder to the most frequent one */
+  if( n > 0 ) {
+    while( sum > PROB_SCALE ) {
+      --freq[std::max_element(freq, freq+256) - freq];
+      --sum;
+    }
+    freq[std::max_element(freq, freq+256) - freq] += PROB_SCALE - sum;
+  }
+
+  uint32_t cum[257];
+  cum[0] = 0;
+  for( int32_t s=0; s<256; ++s )
+    cum[s+1] = cum[s] + freq[s];
+
+  /* Encode backwards, the decoder reads forwards */
+  std::vector<uint8_t> payload;
+  payload.reserve(n/4 + 16);
+  uint32_t x = RANS_L;
+  for( size_t i=n; i-- > 0; ) {
+    uint32_t f = freq[data[i]];
+    uint32_t x_max = ((RANS_L >> PROB_BITS) << 8)*f;
+    while( x >= x_max ) {
+      payload.push_back((uint8_t)(x & 0xff));
+      x >>= 8;
+    }
+    x = ((x/f) << PROB_BITS) + (x%f) + cum[data[i]];
+  }
+  for( int32_t b=0; b<4; ++b ) {
+    payload.push_back((uint8_t)(x & 0xff));
+    x >>= 8;
+  }
+  std::reverse(payload.begin(), payload.end());
+
+  uint64_t header[2] = { n, payload.size() };
+  uint16_t table[256];
+  for( int32_t s=0; s<256; ++s )
+    table[s] = (uint16_t)freq[s];
+
+  const char* c = (const char*)&header[0];
+  buffer.insert(buffer.end(), c, c+sizeof(uint64_t));
+  c = (const char*)table;
+  buffer.insert(buffer.end(), c, c+sizeof(table));
+  c = (const char*)&header[1];
+  buffer.insert(buffer.end(), c, c+sizeof(uint64_t));
+  buffer.insert(buffer.end(), payload.begin(), payload.end());
+}
+
+size_t Codec::entropyDecode(const char* buffer, size_t size,
+                            std::vector<uint8_t>& data)
+{
+  uint64_t n, bytes;
+  uint16_t table[256];
+  size_t header = 2*sizeof(uint64_t) + sizeof(table);
+  if( size < header )
+    throw std::runtime_error("Truncated compressed stream");
+  memcpy(&n, buffer, sizeof(n));
+  memcpy(table, buffer+sizeof(n), sizeof(table));
+  memcpy(&bytes, buffer+sizeof(n)+sizeof(table), sizeof(bytes));
+  if( bytes < 4 || size < header+bytes )
+    throw std::runtime_error("Truncated compressed stream");
+
+  uint32_t cum[257];
+  cum[0] = 0;
+  for( int32_t s=0; s<256; ++s )
+    cum[s+1] = cum[s] + table[s];
+  if( n > 0 && PROB_SCALE != cum[256] )
+    throw std::runtime_error("Corrupt compressed stream");
+
+  uint8_t slots[PROB_SCALE];
+  for( int32_t s=0; s<256; ++s )
+    for( uint32_t j=cum[s]; j<cum[s+1]; ++j )
+      slots[j] = (uint8_t)s;
+
+  const uint8_t* p = (const uint8_t*)buffer + header;
+  const uint8_t* end = p + bytes;
+  uint32_t x = 0;
+  for( int32_t b=0; b<4; ++b )
+    x = (x << 8) | *p++;
+
+  data.resize(n);
+  for( uint64_t i=0; i<n; ++i ) {
+    uint32_t slot = x & (PROB_SCALE-1);
+    uint8_t s = slots[slot];
+    data[i] = s;
+    x = table[s]*(x >> PROB_BITS) + slot - cum[s];
+    while( x < RANS_L && p < end )
+      x = (x << 8) | *p++;
+  }
+
+  return header + bytes;
+}
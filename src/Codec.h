@@ -0,0 +1,106 @@
+#pragma once
+
+/*
+ *  Notices:
+ *  Copyright 2023 United States Government as represented by the
+ *  Administrator of the National Aeronautics and Space Administration.
+ *  No copyright is claimed in the United States under Title 17,
+ *  U.S. Code. All Other Rights Reserved.
+ *
+ *  Disclaimers No Warranty: THE SUBJECT SOFTWARE IS PROVIDED "AS
+ *  IS" WITHOUT ANY WARRANTY OF ANY KIND, EITHER EXPRESSED, IMPLIED,
+ *  OR STATUTORY, INCLUDING, BUT NOT LIMITED TO, ANY WARRANTY THAT
+ *  THE SUBJECT SOFTWARE WILL CONFORM TO SPECIFICATIONS, ANY IMPLIED
+ *  WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE,
+ *  OR FREEDOM FROM INFRINGEMENT, ANY WARRANTY THAT THE SUBJECT
+ *  SOFTWARE WILL BE ERROR FREE, OR ANY WARRANTY THAT DOCUMENTATION,
+ *  IF PROVIDED, WILL CONFORM TO THE SUBJECT SOFTWARE. THIS AGREEMENT
+ *  DOES NOT, IN ANY MANNER, CONSTITUTE AN ENDORSEMENT BY GOVERNMENT
+ *  AGENCY OR ANY PRIOR RECIPIENT OF ANY RESULTS, RESULTING DESIGNS,
+ *  HARDWARE, SOFTWARE PRODUCTS OR ANY OTHER APPLICATIONS RESULTING
+ *  FROM USE OF THE SUBJECT SOFTWARE.  FURTHER, GOVERNMENT AGENCY
+ *  DISCLAIMS ALL WARRANTIES AND LIABILITIES REGARDING THIRD-PARTY
+ *  SOFTWARE, IF PRESENT IN THE ORIGINAL SOFTWARE, AND DISTRIBUTES
+ *  IT "AS IS." 
+ *
+ *  Waiver and Indemnity:  RECIPIENT AGREES TO WAIVE ANY AND ALL
+ *  CLAIMS AGAINST THE UNITED STATES GOVERNMENT, ITS CONTRACTORS
+ *  AND SUBCONTRACTORS, AS WELL AS ANY PRIOR RECIPIENT.  IF RECIPIENT'S
+ *  USE OF THE SUBJECT SOFTWARE RESULTS IN ANY LIABILITIES, DEMANDS,
+ *  DAMAGES, EXPENSES OR LOSSES ARISING FROM SUCH USE, INCLUDING
+ *  ANY DAMAGES FROM PRODUCTS BASED ON, OR RESULTING FROM, RECIPIENT'S
+ *  USE OF THE SUBJECT SOFTWARE, RECIPIENT SHALL INDEMNIFY AND HOLD
+ *  HARMLESS THE UNITED STATES GOVERNMENT, ITS CONTRACTORS AND
+ *  SUBCONTRACTORS, AS WELL AS ANY PRIOR RECIPIENT, TO THE EXTENT
+ *  PERMITTED BY LAW.  RECIPIENT'S SOLE REMEDY FOR ANY SUCH MATTER
+ *  SHALL BE THE IMMEDIATE, UNILATERAL TERMINATION OF THIS AGREEMENT.
+ */
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+namespace VisKombyne
+{
+
+/**
+ * Error-bounded compression of double arrays.
+ *
+ * Values are quantized to integer multiples of a step (the absolute error
+ * is at most half the step), the caller subtracts a prediction from the
+ * quantized values (e.g. the previous node, see predict()) and the
+ * residuals are zigzag encoded, split in byte planes and entropy coded
+ * with a static order-0 rANS coder.  The quantization, prediction and
+ * shuffle loops are branch free so that the compiler vectorizes them.
+ */
+class Codec
+{
+  public:
+    /**
+     * Quantize values to multiples of a step.
+     *
+     * @returns false if a value is out of the exactly representable range,
+     *          NaN or infinite
+     */
+    static bool quantize(const double* values, int64_t n, double step,
+                         int64_t* q);
+
+    /** Residuals of the prediction by the previous value */
+    static void predict(const int64_t* q, int64_t n, int64_t* residuals);
+    /** Inverse of predict(), in place */
+    static void unpredict(int64_t* q, int64_t n);
+
+    /**
+     * Largest absolute difference between the values and q*step, NaN if any
+     * value is NaN.
+     */
+    static double maxError(const double* values, const int64_t* q, int64_t n,
+                           double step);
+
+    /**
+     * Encode residuals, appending to a buffer.
+     */
+    static void encode(const int64_t* residuals, int64_t n,
+                       std::vector<char>& buffer);
+
+    /**
+     * Decode n residuals.
+     *
+     * @returns the number of bytes consumed
+     */
+    static size_t decode(const char* buffer, size_t size, int64_t n,
+                         int64_t* residuals);
+
+    /** Static order-0 rANS coding of bytes */
+    static void entropyEncode(const uint8_t* data, size_t n,
+                              std::vector<char>& buffer);
+    static size_t entropyDecode(const char* buffer, size_t size,
+                                std::vector<uint8_t>& data);
+
+  private:
+    static const uint32_t PROB_BITS = 12;
+    static const uint32_t PROB_SCALE = 1u << PROB_BITS;
+    static const uint32_t RANS_L = 1u << 23;
+};
+
+} // namespace VisKombyne
@@ -0,0 +1,123 @@
+/*
+ *  Notices:
+ *  Copyright 2023 United States Government as represented by the
+ *  Administrator of the National Aeronautics and Space Administration.
+ *  No copyright is claimed in the United States under Title 17,
+ *  U.S. Code. All Other Rights Reserved.
+ *
+ *  Disclaimers No Warranty: THE SUBJECT SOFTWARE IS PROVIDED "AS
+ *  IS" WITHOUT ANY WARRANTY OF ANY KIND, EITHER EXPRESSED, IMPLIED,
+ *  OR STATUTORY, INCLUDING, BUT NOT LIMITED TO, ANY WARRANTY THAT
+ *  THE SUBJECT SOFTWARE WILL CONFORM TO SPECIFICATIONS, ANY IMPLIED
+ *  WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE,
+ *  OR FREEDOM FROM INFRINGEMENT, ANY WARRANTY THAT THE SUBJECT
+ *  SOFTWARE WILL BE ERROR FREE, OR ANY WARRANTY THAT DOCUMENTATION,
+ *  IF PROVIDED, WILL CONFORM TO THE SUBJECT SOFTWARE. THIS AGREEMENT
+ *  DOES NOT, IN ANY MANNER, CONSTITUTE AN ENDORSEMENT BY GOVERNMENT
+ *  AGENCY OR ANY PRIOR RECIPIENT OF ANY RESULTS, RESULTING DESIGNS,
+ *  HARDWARE, SOFTWARE PRODUCTS OR ANY OTHER APPLICATIONS RESULTING
+ *  FROM USE OF THE SUBJECT SOFTWARE.  FURTHER, GOVERNMENT AGENCY
+ *  DISCLAIMS ALL WARRANTIES AND LIABILITIES REGARDING THIRD-PARTY
+ *  SOFTWARE, IF PRESENT IN THE ORIGINAL SOFTWARE, AND DISTRIBUTES
+ *  IT "AS IS." 
+ *
+ *  Waiver and Indemnity:  RECIPIENT AGREES TO WAIVE ANY AND ALL
+ *  CLAIMS AGAINST THE UNITED STATES GOVERNMENT, ITS CONTRACTORS
+ *  AND SUBCONTRACTORS, AS WELL AS ANY PRIOR RECIPIENT.  IF RECIPIENT'S
+ *  USE OF THE SUBJECT SOFTWARE RESULTS IN ANY LIABILITIES, DEMANDS,
+ *  DAMAGES, EXPENSES OR LOSSES ARISING FROM SUCH USE, INCLUDING
+ *  ANY DAMAGES FROM PRODUCTS BASED ON, OR RESULTING FROM, RECIPIENT'S
+ *  USE OF THE SUBJECT SOFTWARE, RECIPIENT SHALL INDEMNIFY AND HOLD
+ *  HARMLESS THE UNITED STATES GOVERNMENT, ITS CONTRACTORS AND
+ *  SUBCONTRACTORS, AS WELL AS ANY PRIOR RECIPIENT, TO THE EXTENT
+ *  PERMITTED BY LAW.  RECIPIENT'S SOLE REMEDY FOR ANY SUCH MATTER
+ *  SHALL BE THE IMMEDIATE, UNILATERAL TERMINATION OF THIS AGREEMENT.
+ */
+
+/*
+ * Round trip checks of the rANS coder of Codec on distributions that stress
+ * the frequency normalization, and of the rejection of non-finite values by
+ * the quantizer.
+ */
+
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include <random>
+#include <cstdint>
+#include <cmath>
+#include <limits>
+
+#include "Codec.h"
+
+using namespace VisKombyne;
+
+static bool roundTrip(const char* name, const std::vector<uint8_t>& data)
+{
+  std::vector<char> buffer;
+  Codec::entropyEncode(data.data(), data.size(), buffer);
+
+  std::vector<uint8_t> decoded;
+  bool ok;
+  try {
+    size_t used = Codec::entropyDecode(buffer.data(), buffer.size(), decoded);
+    ok = (used == buffer.size() && decoded == data);
+  } catch( std::exception& e ) {
+    std::cerr << name << ": " << e.what() << std::endl;
+    ok = false;
+  }
+
+  std::cerr << name << ": " << (ok ? "passed" : "FAILED") << std::endl;
+  return ok;
+}
+
+static bool rejected(const char* name, int64_t at, double value)
+{
+  std::vector<double> values(19, 1.0);
+  values[at] = value;
+  std::vector<int64_t> q(values.size());
+
+  bool ok = !Codec::quantize(values.data(), values.size(), 0.01, q.data());
+  double error = Codec::maxError(values.data(), q.data(), values.size(), 0.01);
+  if( value != value )
+    ok = ok && (error != error);
+
+  std::cerr << name << ": " << (ok ? "passed" : "FAILED") << std::endl;
+  return ok;
+}
+
+int main()
+{
+  std::mt19937 generator(1);
+  bool ok = true;
+
+  /* Every byte value, nearly equally frequent */
+  std::vector<uint8_t> uniform(100000);
+  std::vector<uint8_t>::iterator it;
+  for(it = uniform.begin(); it != uniform.end(); ++it)
+    *it = (uint8_t)(generator() & 0xff);
+  ok &= roundTrip("near-uniform", uniform);
+
+  /* Equally frequent common symbols and many rare ones rounded up to 1,
+   * their excess exceeds the largest frequency */
+  std::vector<uint8_t> rare;
+  for( int32_t s=0; s<56; ++s )
+    rare.insert(rare.end(), 1000, (uint8_t)s);
+  for( int32_t s=56; s<256; ++s )
+    rare.push_back((uint8_t)s);
+  std::shuffle(rare.begin(), rare.end(), generator);
+  ok &= roundTrip("rare symbols", rare);
+
+  ok &= roundTrip("single symbol", std::vector<uint8_t>(1000, 7));
+  ok &= roundTrip("empty", std::vector<uint8_t>());
+
+  /* Non-finite values must not quantize (the lane and the tail loops) */
+  const double nan = std::numeric_limits<double>::quiet_NaN();
+  const double inf = std::numeric_limits<double>::infinity();
+  ok &= rejected("NaN in a lane", 3, nan);
+  ok &= rejected("NaN in the tail", 17, nan);
+  ok &= rejected("Inf in a lane", 5, inf);
+  ok &= rejected("-Inf in the tail", 18, -inf);
+
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,414 @@
+/*
+ *  Notices:
+ *  Copyright 2023 United States Government as represented by the
+ *  Administrator of the National Aeronautics and Space Administration.
+ *  No copyright is claimed in the United States under Title 17,
+ *  U.S. Code. All Other Rights Reserved.
+ *
+ *  Disclaimers No Warranty: THE SUBJECT SOFTWARE IS PROVIDED "AS
+ *  IS" WITHOUT ANY WARRANTY OF ANY KIND, EITHER EXPRESSED, IMPLIED,
+ *  OR STATUTORY, INCLUDING, BUT NOT LIMITED TO, ANY WARRANTY THAT
+ *  THE SUBJECT SOFTWARE WILL CONFORM TO SPECIFICATIONS, ANY IMPLIED
+ *  WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE,
+ *  OR FREEDOM FROM INFRINGEMENT, ANY WARRANTY THAT THE SUBJECT
+ *  SOFTWARE WILL BE ERROR FREE, OR ANY WARRANTY THAT DOCUMENTATION,
+ *  IF PROVIDED, WILL CONFORM TO THE SUBJECT SOFTWARE. THIS AGREEMENT
+ *  DOES NOT, IN ANY MANNER, CONSTITUTE AN ENDORSEMENT BY GOVERNMENT
+ *  AGENCY OR ANY PRIOR RECIPIENT OF ANY RESULTS, RESULTING DESIGNS,
+ *  HARDWARE, SOFTWARE PRODUCTS OR ANY OTHER APPLICATIONS RESULTING
+ *  FROM USE OF THE SUBJECT SOFTWARE.  FURTHER, GOVERNMENT AGENCY
+ *  DISCLAIMS ALL WARRANTIES AND LIABILITIES REGARDING THIRD-PARTY
+ *  SOFTWARE, IF PRESENT IN THE ORIGINAL SOFTWARE, AND DISTRIBUTES
+ *  IT "AS IS." 
+ *
+ *  Waiver and Indemnity:  RECIPIENT AGREES TO WAIVE ANY AND ALL
+ *  CLAIMS AGAINST THE UNITED STATES GOVERNMENT, ITS CONTRACTORS
+ *  AND SUBCONTRACTORS, AS WELL AS ANY PRIOR RECIPIENT.  IF RECIPIENT'S
+ *  USE OF THE SUBJECT SOFTWARE RESULTS IN ANY LIABILITIES, DEMANDS,
+ *  DAMAGES, EXPENSES OR LOSSES ARISING FROM SUCH USE, INCLUDING
+ *  ANY DAMAGES FROM PRODUCTS BASED ON, OR RESULTING FROM, RECIPIENT'S
+ *  USE OF THE SUBJECT SOFTWARE, RECIPIENT SHALL INDEMNIFY AND HOLD
+ *  HARMLESS THE UNITED STATES GOVERNMENT, ITS CONTRACTORS AND
+ *  SUBCONTRACTORS, AS WELL AS ANY PRIOR RECIPIENT, TO THE EXTENT
+ *  PERMITTED BY LAW.  RECIPIENT'S SOLE REMEDY FOR ANY SUCH MATTER
+ *  SHALL BE THE IMMEDIATE, UNILATERAL TERMINATION OF THIS AGREEMENT.
+ */
+
+#ifdef __GNUG__
+  #pragma implementation "Cutter.h"
+#endif
+
+#include <exception>
+#include <stdexcept>
+#include <algorithm>
+#include <unordered_map>
+#include <cfloat>
+#include <thread>
+
+#include "Cutter.h"
+#include "kombyne_data_celltype.h"
+
+using namespace VisKombyne;
+
+namespace
+{
+
+/**
+ * Cut cases of a cell type.  A node is inside when its scalar is below the
+ * contour value, case bit i is set for an inside node i.  Each case is a
+ * list of polygons, each a vertex count followed by the cell edges holding
+ * the vertices, terminated by 0.
+ */
+struct CellTable
+{
+  int32_t nnodes;
+  std::vector<std::pair<int32_t, int32_t> > edges;
+  std::vector<std::vector<int8_t> > cases;
+};
+
+struct Shape
+{
+  int32_t nnodes;
+  const char* faces;     /* nodes of each face, faces separated by '|' */
+  double xyz[8][3];      /* reference node coordinates */
+};
+
+const Shape TET = { 4, "021|013|123|032",
+  { {0,0,0}, {1,0,0}, {0,1,0}, {0,0,1} } };
+const Shape PYR = { 5, "0321|014|124|234|304",
+  { {0,0,0}, {1,0,0}, {1,1,0}, {0,1,0}, {0.5,0.5,1} } };
+const Shape WEDGE = { 6, "012|354|0341|1452|2530",
+  { {0,0,0}, {1,0,0}, {0,1,0}, {0,0,1}, {1,0,1}, {0,1,1} } };
+const Shape HEX = { 8, "0321|4567|0154|1265|2376|3047",
+  { {0,0,0}, {1,0,0}, {1,1,0}, {0,1,0},
+    {0,0,1}, {1,0,1}, {1,1,1}, {0,1,1} } };
+
+int32_t edgeIndex(CellTable& t, int32_t a, int32_t b)
+{
+  std::pair<int32_t, int32_t> e(std::min(a,b), std::max(a,b));
+  std::vector<std::pair<int32_t, int32_t> >::iterator it;
+  it = std::find(t.edges.begin(), t.edges.end(), e);
+  if( it != t.edges.end() )
+    return it - t.edges.begin();
+  t.edges.push_back(e);
+  return t.edges.size()-1;
+}
+
+/*
+ * Generate the cut cases of a shape: the intersected edges of each face
+ * form segments which are chained into polygons, oriented with the normal
+ * pointing from the inside to the outside nodes.
+ */
+CellTable generate(const Shape& shape)
+{
+  CellTable t;
+  t.nnodes = shape.nnodes;
+
+  std::vector<std::vector<int32_t> > faces(1);
+  for( const char* c=shape.faces; *c; ++c ) {
+    if( '|' == *c )
+      faces.push_back(std::vector<int32_t>());
+    else
+      faces.back().push_back(*c - '0');
+  }
+  for( size_t f=0; f<faces.size(); ++f )
+    for( size_t i=0; i<faces[f].size(); ++i )
+      edgeIndex(t, faces[f][i], faces[f][(i+1)%faces[f].size()]);
+
+  t.cases.resize(1 << t.nnodes);
+  for( int32_t mask=0; mask<(1 << t.nnodes); ++mask ) {
+    std::vector<std::pair<int32_t, int32_t> > segments;
+    for( size_t f=0; f<faces.size(); ++f ) {
+      const std::vector<int32_t>& face = faces[f];
+      size_t n = face.size();
+      std::vector<int32_t> cut;
+      std::vector<int32_t> after;  /* node following each cut edge */
+      for( size_t i=0; i<n; ++i ) {
+        int32_t a = face[i], b = face[(i+1)%n];
+        if( ((mask >> a) & 1) != ((mask >> b) & 1) ) {
+          cut.push_back(edgeIndex(t, a, b));
+          after.push_back(b);
+        }
+      }
+      if( 2 == cut.size() ) {
+        segments.push_back(std::make_pair(cut[0], cut[1]));
+      } else if( 4 == cut.size() ) {
+        /* Ambiguous face: separate the inside corners, independently of
+         * the face starting node so that neighbor cells agree */
+        if( (mask >> after[0]) & 1 ) {
+          segments.push_back(std::make_pair(cut[0], cut[1]));
+          segments.push_back(std::make_pair(cut[2], cut[3]));
+        } else {
+          segments.push_back(std::make_pair(cut[1], cut[2]));
+          segments.push_back(std::make_pair(cut[3], cut[0]));
+        }
+      }
+    }
+
+    std::vector<int8_t>& polys = t.cases[mask];
+    std::vector<char> used(segments.size(), 0);
+    for( size_t s=0; s<segments.size(); ++s ) {
+      if( used[s] )
+        continue;
+      used[s] = 1;
+      std::vector<int32_t> poly(1, segments[s].first);
+      int32_t current = segments[s].second;
+      while( current != poly[0] ) {
+        poly.push_back(current);
+        size_t k;
+        for( k=0; k<segments.size(); ++k ) {
+          if( used[k] )
+            continue;
+          if( segments[k].first == current || segments[k].second == current )
+            break;
+        }
+        if( k == segments.size() )
+          throw std::runtime_error("Open cut polygon");
+        used[k] = 1;
+        current = (segments[k].first == current) ? segments[k].second
+                                                 : segments[k].first;
+      }
+
+      /* Newell normal of the polygon through the edge midpoints */
+      double normal[3] = { 0, 0, 0 };
+      for( size_t i=0; i<poly.size(); ++i ) {
+        double p[2][3];
+        for( int32_t j=0; j<2; ++j ) {
+          std::pair<int32_t, int32_t> e = t.edges[poly[(i+j)%poly.size()]];
+          for( int32_t d=0; d<3; ++d )
+            p[j][d] = 0.5*(shape.xyz[e.first][d] + shape.xyz[e.second][d]);
+        }
+        normal[0] += (p[0][1]-p[1][1])*(p[0][2]+p[1][2]);
+        normal[1] += (p[0][2]-p[1][2])*(p[0][0]+p[1][0]);
+        normal[2] += (p[0][0]-p[1][0])*(p[0][1]+p[1][1]);
+      }
+      /* Inside to outside direction along the cut edges */
+      double dir[3] = { 0, 0, 0 };
+      for( size_t i=0; i<poly.size(); ++i ) {
+        std::pair<int32_t, int32_t> e = t.edges[poly[i]];
+        double sign = ((mask >> e.first) & 1) ? 1.0 : -1.0;
+        for( int32_t d=0; d<3; ++d )
+          dir[d] += sign*(shape.xyz[e.second][d] - shape.xyz[e.first][d]);
+      }
+      if( normal[0]*dir[0] + normal[1]*dir[1] + normal[2]*dir[2] < 0.0 )
+        std::reverse(poly.begin()+1, poly.end());
+
+      polys.push_back((int8_t)poly.size());
+      polys.insert(polys.end(), poly.begin(), poly.end());
+    }
+    polys.push_back(0);
+  }
+  return t;
+}
+
+const CellTable& table(int32_t celltype)
+{
+  static const CellTable tet = generate(TET);
+  static const CellTable pyr = generate(PYR);
+  static const CellTable wedge = generate(WEDGE);
+  static const CellTable hex = generate(HEX);
+
+  switch( celltype ) {
+    case KB_CELLTYPE_TET:   return tet;
+    case KB_CELLTYPE_PYR:   return pyr;
+    case KB_CELLTYPE_WEDGE: return wedge;
+    case KB_CELLTYPE_HEX:   return hex;
+  }
+  throw std::runtime_error("Unsupported cell type for cutting");
+}
+
+} // namespace
+
+
+Cutter::Cutter(UMesh& mesh) : m_mesh(mesh)
+{
+  const int32_t* conn = mesh.cellConnects();
+  int64_t c = 0, i = 0;
+  for( ; i<mesh.cellConnectsSize(); ++c ) {
+    if( 0 == c%CELL_BLOCK ) {
+      m_block_cell.push_back(c);
+      m_block_conn.push_back(i);
+    }
+    i += Extract::nodesPerCell(conn[i]) + 1;
+  }
+  m_block_cell.push_back(c);
+  m_block_conn.push_back(i);
+}
+
+void Cutter::blockRanges(const double* s, std::vector<double>& lo,
+                         std::vector<double>& hi) const
+{
+  const int32_t* conn = m_mesh.cellConnects();
+
+  lo.assign(nBlocks(), DBL_MAX);
+  hi.assign(nBlocks(), -DBL_MAX);
+  for( int64_t b=0; b<nBlocks(); ++b ) {
+    double l = DBL_MAX, h = -DBL_MAX;
+    for( int64_t i=m_block_conn[b]; i<m_block_conn[b+1]; ) {
+      int32_t n = Extract::nodesPerCell(conn[i++]);
+      for( int32_t j=0; j<n; ++j, ++i ) {
+        double v = s[conn[i]];
+        l = std::min(l, v);
+        h = std::max(h, v);
+      }
+    }
+    lo[b] = l;
+    hi[b] = h;
+  }
+}
+
+std::vector<int64_t> Cutter::candidates(const std::vector<double>& lo,
+                                        const std::vector<double>& hi,
+                                        double value)
+{
+  std::vector<int64_t> blocks;
+  for( size_t b=0; b<lo.size(); ++b )
+    if( lo[b] < value && value <= hi[b] )
+      blocks.push_back(b);
+  return blocks;
+}
+
+void Cutter::cut(const double* s, double value,
+                 const std::vector<int64_t>& blocks,
+                 const NodalFields& fields, Extract& piece,
+                 int32_t nthreads) const
+{
+  std::vector<int64_t> keys;
+
+  nthreads = std::max(1, std::min<int32_t>(nthreads, blocks.size()));
+  if( 1 == nthreads ) {
+    cutBlocks(s, value, blocks.data(), blocks.data()+blocks.size(), fields,
+              piece, keys);
+    return;
+  }
+
+  /* Blocks dealt round-robin, neighbor blocks cut similar cell counts */
+  std::vector<std::vector<int64_t> > work(nthreads);
+  for( size_t b=0; b<blocks.size(); ++b )
+    work[b%nthreads].push_back(blocks[b]);
+
+  std::vector<Extract> parts(nthreads);
+  std::vector<std::vector<int64_t> > part_keys(nthreads);
+  std::vector<std::thread> threads;
+  std::vector<std::exception_ptr> errors(nthreads);
+  for( int32_t t=0; t<nthreads; ++t ) {
+    threads.push_back(std::thread([&, t]() {
+      try {
+        cutBlocks(s, value, work[t].data(), work[t].data()+work[t].size(),
+                  fields, parts[t], part_keys[t]);
+      } catch(...) {
+        errors[t] = std::current_exception();
+      }
+    }));
+  }
+  for( int32_t t=0; t<nthreads; ++t )
+    threads[t].join();
+  for( int32_t t=0; t<nthreads; ++t )
+    if( errors[t] )
+      std::rethrow_exception(errors[t]);
+
+  /* Merge the vertices shared by the blocks of different threads */
+  size_t nfields = fields.size();
+  for( size_t f=0; f<nfields; ++f )
+    piece.addField(fields[f].first);
+  std::vector<std::vector<double> >& values = piece.fieldValues();
+
+  std::unordered_map<int64_t, int32_t> vertices;
+  for( int32_t t=0; t<nthreads; ++t ) {
+    const Extract& part = parts[t];
+    std::vector<int32_t> ids(part.nPoints());
+    for( int64_t i=0; i<part.nPoints(); ++i ) {
+      std::unordered_map<int64_t, int32_t>::iterator v;
+      v = vertices.find(part_keys[t][i]);
+      if( v == vertices.end() ) {
+        ids[i] = (int32_t)piece.addPoint(part.x()[i], part.y()[i],
+                                         part.z()[i]);
+        for( size_t f=0; f<nfields; ++f )
+          values[f].push_back(part.fieldValues()[f][i]);
+        vertices.insert(std::make_pair(part_keys[t][i], ids[i]));
+      } else {
+        ids[i] = v->second;
+      }
+    }
+
+    const std::vector<int32_t>& conn = part.connectivity();
+    for( size_t i=0; i<conn.size(); i+=4 ) {
+      int32_t tri[3] = { ids[conn[i+1]], ids[conn[i+2]], ids[conn[i+3]] };
+      piece.addCell(KB_CELLTYPE_TRI, tri, 3);
+    }
+  }
+}
+
+/*
+ * Cut a range of blocks, keys receives the mesh edge of each vertex.
+ */
+void Cutter::cutBlocks(const double* s, double value, const int64_t* begin,
+                       const int64_t* end, const NodalFields& fields,
+                       Extract& piece, std::vector<int64_t>& keys) const
+{
+  const int32_t* conn = m_mesh.cellConnects();
+  const int32_t* owned = m_mesh.activeCells();
+  const double* x = m_mesh.x();
+  const double* y = m_mesh.y();
+  const double* z = m_mesh.z();
+
+  size_t nfields = fields.size();
+  for( size_t f=0; f<nfields; ++f )
+    piece.addField(fields[f].first);
+  std::vector<std::vector<double> >& values = piece.fieldValues();
+
+  /* Contour vertices by mesh edge */
+  std::unordered_map<int64_t, int32_t> vertices;
+  int64_t nnodes = m_mesh.nNodes01();
+
+  std::vector<int32_t> poly;
+  const int64_t* b;
+  for( b = begin; b != end; ++b ) {
+    int64_t c = m_block_cell[*b];
+    for( int64_t i=m_block_conn[*b]; i<m_block_conn[*b+1]; ++c ) {
+      int32_t celltype = conn[i++];
+      const int32_t* nodes = conn+i;
+      i += Extract::nodesPerCell(celltype);
+      if( !owned[c] )
+        continue;
+
+      const CellTable& t = table(celltype);
+      int32_t mask = 0;
+      for( int32_t j=0; j<t.nnodes; ++j )
+        mask |= (s[nodes[j]] < value) << j;
+
+      const int8_t* p = t.cases[mask].data();
+      while( int32_t n = *p++ ) {
+        poly.resize(n);
+        for( int32_t k=0; k<n; ++k ) {
+          int32_t a = nodes[t.edges[p[k]].first];
+          int32_t e = nodes[t.edges[p[k]].second];
+          if( a > e )
+            std::swap(a, e);
+          int64_t key = (int64_t)a*nnodes + e;
+          std::unordered_map<int64_t, int32_t>::iterator v;
+          v = vertices.find(key);
+          if( v == vertices.end() ) {
+            double w = (value - s[a])/(s[e] - s[a]);
+            int32_t id = (int32_t)piece.addPoint(x[a] + w*(x[e]-x[a]),
+                                                 y[a] + w*(y[e]-y[a]),
+                                                 z[a] + w*(z[e]-z[a]));
+            for( size_t f=0; f<nfields; ++f ) {
+              const double* u = fields[f].second;
+              values[f].push_back(u[a] + w*(u[e]-u[a]));
+            }
+            v = vertices.insert(std::make_pair(key, id)).first;
+            keys.push_back(key);
+          }
+          poly[k] = v->second;
+        }
+        p += n;
+
+        for( int32_t k=1; k+1<n; ++k ) {
+          int32_t tri[3] = { poly[0], poly[k], poly[k+1] };
+          piece.addCell(KB_CELLTYPE_TRI, tri, 3);
+        }
+      }
+    }
+  }
+}
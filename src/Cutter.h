@@ -0,0 +1,108 @@
+#pragma once
+
+/*
+ *  Notices:
+ *  Copyright 2023 United States Government as represented by the
+ *  Administrator of the National Aeronautics and Space Administration.
+ *  No copyright is claimed in the United States under Title 17,
+ *  U.S. Code. All Other Rights Reserved.
+ *
+ *  Disclaimers No Warranty: THE SUBJECT SOFTWARE IS PROVIDED "AS
+ *  IS" WITHOUT ANY WARRANTY OF ANY KIND, EITHER EXPRESSED, IMPLIED,
+ *  OR STATUTORY, INCLUDING, BUT NOT LIMITED TO, ANY WARRANTY THAT
+ *  THE SUBJECT SOFTWARE WILL CONFORM TO SPECIFICATIONS, ANY IMPLIED
+ *  WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE,
+ *  OR FREEDOM FROM INFRINGEMENT, ANY WARRANTY THAT THE SUBJECT
+ *  SOFTWARE WILL BE ERROR FREE, OR ANY WARRANTY THAT DOCUMENTATION,
+ *  IF PROVIDED, WILL CONFORM TO THE SUBJECT SOFTWARE. THIS AGREEMENT
+ *  DOES NOT, IN ANY MANNER, CONSTITUTE AN ENDORSEMENT BY GOVERNMENT
+ *  AGENCY OR ANY PRIOR RECIPIENT OF ANY RESULTS, RESULTING DESIGNS,
+ *  HARDWARE, SOFTWARE PRODUCTS OR ANY OTHER APPLICATIONS RESULTING
+ *  FROM USE OF THE SUBJECT SOFTWARE.  FURTHER, GOVERNMENT AGENCY
+ *  DISCLAIMS ALL WARRANTIES AND LIABILITIES REGARDING THIRD-PARTY
+ *  SOFTWARE, IF PRESENT IN THE ORIGINAL SOFTWARE, AND DISTRIBUTES
+ *  IT "AS IS." 
+ *
+ *  Waiver and Indemnity:  RECIPIENT AGREES TO WAIVE ANY AND ALL
+ *  CLAIMS AGAINST THE UNITED STATES GOVERNMENT, ITS CONTRACTORS
+ *  AND SUBCONTRACTORS, AS WELL AS ANY PRIOR RECIPIENT.  IF RECIPIENT'S
+ *  USE OF THE SUBJECT SOFTWARE RESULTS IN ANY LIABILITIES, DEMANDS,
+ *  DAMAGES, EXPENSES OR LOSSES ARISING FROM SUCH USE, INCLUDING
+ *  ANY DAMAGES FROM PRODUCTS BASED ON, OR RESULTING FROM, RECIPIENT'S
+ *  USE OF THE SUBJECT SOFTWARE, RECIPIENT SHALL INDEMNIFY AND HOLD
+ *  HARMLESS THE UNITED STATES GOVERNMENT, ITS CONTRACTORS AND
+ *  SUBCONTRACTORS, AS WELL AS ANY PRIOR RECIPIENT, TO THE EXTENT
+ *  PERMITTED BY LAW.  RECIPIENT'S SOLE REMEDY FOR ANY SUCH MATTER
+ *  SHALL BE THE IMMEDIATE, UNILATERAL TERMINATION OF THIS AGREEMENT.
+ */
+
+#include <vector>
+#include <cstdint>
+
+#include "UMesh.h"
+#include "Extract.h"
+
+namespace VisKombyne
+{
+
+/**
+ * Contouring of the owned volume cells of a UMesh at a value of a nodal
+ * scalar (a signed distance for slices, a field for isosurfaces).
+ *
+ * The cells are grouped in blocks of CELL_BLOCK consecutive cells whose
+ * scalar ranges let the callers skip the blocks the contour cannot cross.
+ * Cells are cut with case tables generated once from the faces of each
+ * cell type, the contour vertices are merged by mesh edge and the contour
+ * polygons are output as triangles with all nodal fields interpolated.
+ * The blocks may be cut by several threads, the vertices they share are
+ * merged by mesh edge afterwards.
+ */
+class Cutter
+{
+  public:
+    Cutter(UMesh& mesh);
+
+    inline int64_t nBlocks() const { return m_block_cell.size()-1; }
+
+    /**
+     * Range of a nodal scalar over the nodes of each cell block.
+     */
+    void blockRanges(const double* s, std::vector<double>& lo,
+                     std::vector<double>& hi) const;
+
+    /**
+     * Blocks whose range contains a value.
+     */
+    static std::vector<int64_t> candidates(const std::vector<double>& lo,
+                                           const std::vector<double>& hi,
+                                           double value);
+
+    /**
+     * Cut the owned cells of the given blocks at s == value.
+     *
+     * @param s  Nodal scalar
+     * @param value  Contour value
+     * @param blocks  Cell blocks to cut
+     * @param fields  Nodal fields interpolated to the contour
+     * @param piece  Empty piece receiving the triangles
+     * @param nthreads  Number of threads cutting the blocks
+     */
+    void cut(const double* s, double value, const std::vector<int64_t>& blocks,
+             const NodalFields& fields, Extract& piece,
+             int32_t nthreads=1) const;
+
+    static const int64_t CELL_BLOCK = 1024;
+
+  private:
+    void cutBlocks(const double* s, double value, const int64_t* begin,
+                   const int64_t* end, const NodalFields& fields,
+                   Extract& piece, std::vector<int64_t>& keys) const;
+
+  private:
+    UMesh& m_mesh;
+    /** First cell and connectivity entry of each block */
+    std::vector<int64_t> m_block_cell;
+    std::vector<int64_t> m_block_conn;
+};
+
+} // namespace VisKombyne
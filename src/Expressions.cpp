@@ -0,0 +1,442 @@
+/*
+ *  Notices:
+ *  Copyright 2023 United States Government as represented by the
+ *  Administrator of the National Aeronautics and Space Administration.
+ *  No copyright is claimed in the United States under Title 17,
+ *  U.S. Code. All Other Rights Reserved.
+ *
+ *  Disclaimers No Warranty: THE SUBJECT SOFTWARE IS PROVIDED "AS
+ *  IS" WITHOUT ANY WARRANTY OF ANY KIND, EITHER EXPRESSED, IMPLIED,
+ *  OR STATUTORY, INCLUDING, BUT NOT LIMITED TO, ANY WARRANTY THAT
+ *  THE SUBJECT SOFTWARE WILL CONFORM TO SPECIFICATIONS, ANY IMPLIED
+ *  WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE,
+ *  OR FREEDOM FROM INFRINGEMENT, ANY WARRANTY THAT THE SUBJECT
+ *  SOFTWARE WILL BE ERROR FREE, OR ANY WARRANTY THAT DOCUMENTATION,
+ *  IF PROVIDED, WILL CONFORM TO THE SUBJECT SOFTWARE. THIS AGREEMENT
+ *  DOES NOT, IN ANY MANNER, CONSTITUTE AN ENDORSEMENT BY GOVERNMENT
+ *  AGENCY OR ANY PRIOR RECIPIENT OF ANY RESULTS, RESULTING DESIGNS,
+ *  HARDWARE, SOFTWARE PRODUCTS OR ANY OTHER APPLICATIONS RESULTING
+ *  FROM USE OF THE SUBJECT SOFTWARE.  FURTHER, GOVERNMENT AGENCY
+ *  DISCLAIMS ALL WARRANTIES AND LIABILITIES REGARDING THIRD-PARTY
+ *  SOFTWARE, IF PRESENT IN THE ORIGINAL SOFTWARE, AND DISTRIBUTES
+ *  IT "AS IS." 
+ *
+ *  Waiver and Indemnity:  RECIPIENT AGREES TO WAIVE ANY AND ALL
+ *  CLAIMS AGAINST THE UNITED STATES GOVERNMENT, ITS CONTRACTORS
+ *  AND SUBCONTRACTORS, AS WELL AS ANY PRIOR RECIPIENT.  IF RECIPIENT'S
+ *  USE OF THE SUBJECT SOFTWARE RESULTS IN ANY LIABILITIES, DEMANDS,
+ *  DAMAGES, EXPENSES OR LOSSES ARISING FROM SUCH USE, INCLUDING
+ *  ANY DAMAGES FROM PRODUCTS BASED ON, OR RESULTING FROM, RECIPIENT'S
+ *  USE OF THE SUBJECT SOFTWARE, RECIPIENT SHALL INDEMNIFY AND HOLD
+ *  HARMLESS THE UNITED STATES GOVERNMENT, ITS CONTRACTORS AND
+ *  SUBCONTRACTORS, AS WELL AS ANY PRIOR RECIPIENT, TO THE EXTENT
+ *  PERMITTED BY LAW.  RECIPIENT'S SOLE REMEDY FOR ANY SUCH MATTER
+ *  SHALL BE THE IMMEDIATE, UNILATERAL TERMINATION OF THIS AGREEMENT.
+ */
+
+#ifdef __GNUG__
+  #pragma implementation "Expressions.h"
+#endif
+
+#include <exception>
+#include <stdexcept>
+#include <algorithm>
+#include <cstring>
+#include <cctype>
+#include <cstdlib>
+#include <cmath>
+
+#include "Expressions.h"
+
+using namespace VisKombyne;
+
+const int64_t Expressions::BLOCK;
+
+/*
+ * Recursive descent parser of one expression:
+ *
+ *   sum     := product (('+' | '-') product)*
+ *   product := unary (('*' | '/') unary)*
+ *   unary   := '-' unary | power
+ *   power   := primary ('^' unary)?
+ *   primary := number | name | name '(' sum (',' sum)* ')' | '(' sum ')'
+ */
+class Expressions::Parser
+{
+  public:
+    Parser(Expressions& e, const std::string& text) :
+      m_e(e), m_text(text), m_pos(0) {}
+
+    int32_t parse()
+    {
+      int32_t n = sum();
+      skip();
+      if( m_pos != m_text.size() )
+        error("unexpected character");
+      return n;
+    }
+
+  private:
+    void skip()
+    {
+      while( m_pos < m_text.size() && isspace(m_text[m_pos]) )
+        ++m_pos;
+    }
+
+    bool accept(char c)
+    {
+      skip();
+      if( m_pos < m_text.size() && m_text[m_pos] == c ) {
+        ++m_pos;
+        return true;
+      }
+      return false;
+    }
+
+    void expect(char c)
+    {
+      if( !accept(c) )
+        error(std::string("expected '") + c + "'");
+    }
+
+    void error(const std::string& msg)
+    {
+      throw std::runtime_error("Bad expression \"" + m_text + "\": " + msg);
+    }
+
+    int32_t sum()
+    {
+      int32_t n = product();
+      for( ;; ) {
+        if( accept('+') )
+          n = m_e.node(ADD, n, product());
+        else if( accept('-') )
+          n = m_e.node(SUB, n, product());
+        else
+          return n;
+      }
+    }
+
+    int32_t product()
+    {
+      int32_t n = unary();
+      for( ;; ) {
+        if( accept('*') )
+          n = m_e.node(MUL, n, unary());
+        else if( accept('/') )
+          n = m_e.node(DIV, n, unary());
+        else
+          return n;
+      }
+    }
+
+    int32_t unary()
+    {
+      if( accept('-') )
+        return m_e.node(NEG, unary());
+      return power();
+    }
+
+    int32_t power()
+    {
+      int32_t n = primary();
+      if( accept('^') )
+        n = m_e.node(POW, n, unary());
+      return n;
+    }
+
+    int32_t primary()
+    {
+      skip();
+      if( m_pos == m_text.size() )
+        error("unexpected end");
+
+      if( accept('(') ) {
+        int32_t n = sum();
+        expect(')');
+        return n;
+      }
+
+      char c = m_text[m_pos];
+      if( isdigit(c) || '.' == c ) {
+        const char* begin = m_text.c_str() + m_pos;
+        char* end;
+        double value = strtod(begin, &end);
+        m_pos += end - begin;
+        return m_e.node(CONST, -1, -1, value);
+      }
+
+      std::string name;
+      if( '"' == c ) {
+        size_t close = m_text.find('"', m_pos+1);
+        if( std::string::npos == close )
+          error("unterminated name");
+        name = m_text.substr(m_pos+1, close-m_pos-1);
+        m_pos = close+1;
+      } else if( isalpha(c) || '_' == c ) {
+        size_t begin = m_pos;
+        while( m_pos < m_text.size() &&
+               (isalnum(m_text[m_pos]) || '_' == m_text[m_pos]) )
+          ++m_pos;
+        name = m_text.substr(begin, m_pos-begin);
+        if( accept('(') )
+          return call(name);
+      } else {
+        error("unexpected character");
+      }
+
+      return m_e.input(name);
+    }
+
+    int32_t call(const std::string& name)
+    {
+      std::vector<int32_t> args(1, sum());
+      while( accept(',') )
+        args.push_back(sum());
+      expect(')');
+
+      static const struct { const char* name; Op op; size_t nargs; }
+        functions[] = {{"sqrt", SQRT, 1}, {"abs", ABS, 1}, {"exp", EXP, 1},
+                       {"log", LOG, 1}, {"sin", SIN, 1}, {"cos", COS, 1},
+                       {"tan", TAN, 1}, {"pow", POW, 2}, {"min", MIN, 2},
+                       {"max", MAX, 2}};
+      for( size_t f=0; f<sizeof(functions)/sizeof(functions[0]); ++f ) {
+        if( name != functions[f].name )
+          continue;
+        if( args.size() != functions[f].nargs )
+          error("wrong number of arguments to " + name);
+        return m_e.node(functions[f].op, args[0],
+                        args.size() > 1 ? args[1] : -1);
+      }
+      error("unknown function " + name);
+      return -1;
+    }
+
+  private:
+    Expressions& m_e;
+    std::string m_text;
+    size_t m_pos;
+};
+
+Expressions::Expressions(const std::vector<std::string>& definitions) :
+  m_nregisters(0)
+{
+  std::vector<int32_t> outputs;
+
+  std::vector<std::string>::const_iterator it;
+  for(it = definitions.begin(); it != definitions.end(); ++it) {
+    size_t eq = it->find('=');
+    if( std::string::npos == eq )
+      throw std::runtime_error("Derived field needs name = expression: " +
+                               *it);
+
+    std::string name = it->substr(0, eq);
+    name.erase(0, name.find_first_not_of(" \t"));
+    name.erase(name.find_last_not_of(" \t")+1);
+    if( name.empty() || m_defined.count(name) )
+      throw std::runtime_error("Bad derived field name: " + *it);
+
+    Parser parser(*this, it->substr(eq+1));
+    int32_t n = parser.parse();
+
+    m_names.push_back(name);
+    m_defined[name] = n;
+    outputs.push_back(n);
+  }
+
+  compile(outputs);
+}
+
+/*
+ * Scalar operation, used to fold constants.
+ */
+double Expressions::apply(Op op, double a, double b)
+{
+  switch( op ) {
+    case NEG:  return -a;
+    case ADD:  return a + b;
+    case SUB:  return a - b;
+    case MUL:  return a * b;
+    case DIV:  return a / b;
+    case POW:  return std::pow(a, b);
+    case SQRT: return std::sqrt(a);
+    case ABS:  return std::fabs(a);
+    case EXP:  return std::exp(a);
+    case LOG:  return std::log(a);
+    case SIN:  return std::sin(a);
+    case COS:  return std::cos(a);
+    case TAN:  return std::tan(a);
+    case MIN:  return std::min(a, b);
+    case MAX:  return std::max(a, b);
+    default:   break;
+  }
+  return a;
+}
+
+/*
+ * Unique node of the graph, constant operands are folded.
+ */
+int32_t Expressions::node(Op op, int32_t a, int32_t b, double value)
+{
+  bool unary = (NEG == op) || (op >= SQRT && op <= TAN);
+  bool binary = (op >= ADD && op <= POW) || MIN == op || MAX == op;
+
+  if( (unary && CONST == m_nodes[a].op) ||
+      (binary && CONST == m_nodes[a].op && CONST == m_nodes[b].op) ) {
+    value = apply(op, m_nodes[a].value, binary ? m_nodes[b].value : 0.0);
+    op = CONST;
+    a = b = -1;
+  }
+
+  /* Commutative operations are shared regardless of the operand order */
+  if( (ADD == op || MUL == op || MIN == op || MAX == op) && a > b )
+    std::swap(a, b);
+
+  for( size_t i=0; i<m_nodes.size(); ++i ) {
+    const Node& n = m_nodes[i];
+    if( n.op == op && n.a == a && n.b == b &&
+        (CONST != op || 0 == memcmp(&n.value, &value, sizeof(value))) &&
+        (LOAD != op || n.value == value) )
+      return i;
+  }
+
+  Node n = {op, a, b, value};
+  m_nodes.push_back(n);
+  return m_nodes.size()-1;
+}
+
+/*
+ * A previously defined field or an input field.
+ */
+int32_t Expressions::input(const std::string& name)
+{
+  std::map<std::string, int32_t>::iterator d = m_defined.find(name);
+  if( d != m_defined.end() )
+    return d->second;
+
+  std::vector<std::string>::iterator it;
+  it = std::find(m_inputs.begin(), m_inputs.end(), name);
+  if( it == m_inputs.end() ) {
+    m_inputs.push_back(name);
+    it = m_inputs.end()-1;
+  }
+  return node(LOAD, -1, -1, std::distance(m_inputs.begin(), it));
+}
+
+/*
+ * Instructions of the nodes the outputs depend on, in graph order, with
+ * the registers of operands reused after their last use.
+ */
+void Expressions::compile(const std::vector<int32_t>& outputs)
+{
+  int32_t nnodes = m_nodes.size();
+  int32_t end = nnodes;
+
+  std::vector<char> used(nnodes, 0);
+  std::vector<int32_t> last(nnodes, -1);
+  for( size_t o=0; o<outputs.size(); ++o ) {
+    used[outputs[o]] = 1;
+    last[outputs[o]] = end;
+  }
+  for( int32_t i=nnodes-1; i>=0; --i ) {
+    if( !used[i] )
+      continue;
+    if( m_nodes[i].a >= 0 ) {
+      used[m_nodes[i].a] = 1;
+      last[m_nodes[i].a] = std::max(last[m_nodes[i].a], i);
+    }
+    if( m_nodes[i].b >= 0 ) {
+      used[m_nodes[i].b] = 1;
+      last[m_nodes[i].b] = std::max(last[m_nodes[i].b], i);
+    }
+  }
+
+  std::vector<int32_t> reg(nnodes, -1);
+  std::vector<int32_t> free;
+  for( int32_t i=0; i<nnodes; ++i ) {
+    if( !used[i] )
+      continue;
+    const Node& n = m_nodes[i];
+
+    /* Operations are element wise, the result may overwrite an operand */
+    if( n.a >= 0 && last[n.a] == i )
+      free.push_back(reg[n.a]);
+    if( n.b >= 0 && n.b != n.a && last[n.b] == i )
+      free.push_back(reg[n.b]);
+
+    if( free.empty() ) {
+      reg[i] = m_nregisters++;
+    } else {
+      reg[i] = free.back();
+      free.pop_back();
+    }
+
+    Instruction inst = {n.op, reg[i], n.a >= 0 ? reg[n.a] : -1,
+                        n.b >= 0 ? reg[n.b] : -1, n.value};
+    m_code.push_back(inst);
+  }
+
+  for( size_t o=0; o<outputs.size(); ++o ) {
+    Instruction inst = {STORE, -1, reg[outputs[o]], -1, (double)o};
+    m_code.push_back(inst);
+  }
+}
+
+void Expressions::evaluate(int64_t n, const std::vector<const double*>& inputs,
+                           const std::vector<double*>& outputs) const
+{
+  if( inputs.size() != m_inputs.size() || outputs.size() != m_names.size() )
+    throw std::runtime_error("Derived fields evaluated with wrong fields");
+
+  std::vector<double> scratch(m_nregisters*BLOCK);
+  std::vector<const double*> reg(m_nregisters);
+
+  for( int64_t offset=0; offset<n; offset+=BLOCK ) {
+    int64_t len = std::min(BLOCK, n-offset);
+
+    std::vector<Instruction>::const_iterator it;
+    for(it = m_code.begin(); it != m_code.end(); ++it) {
+      if( LOAD == it->op ) {
+        reg[it->dst] = inputs[(size_t)it->value] + offset;
+        continue;
+      }
+      if( STORE == it->op ) {
+        memcpy(outputs[(size_t)it->value] + offset, reg[it->a],
+               len*sizeof(double));
+        continue;
+      }
+
+      double* d = &scratch[it->dst*BLOCK];
+      const double* a = it->a >= 0 ? reg[it->a] : NULL;
+      const double* b = it->b >= 0 ? reg[it->b] : NULL;
+      int64_t i;
+      switch( it->op ) {
+        case CONST:
+          std::fill(d, d+len, it->value);
+          break;
+        case NEG:  for( i=0; i<len; ++i ) d[i] = -a[i]; break;
+        case ADD:  for( i=0; i<len; ++i ) d[i] = a[i] + b[i]; break;
+        case SUB:  for( i=0; i<len; ++i ) d[i] = a[i] - b[i]; break;
+        case MUL:  for( i=0; i<len; ++i ) d[i] = a[i] * b[i]; break;
+        case DIV:  for( i=0; i<len; ++i ) d[i] = a[i] / b[i]; break;
+        case POW:  for( i=0; i<len; ++i ) d[i] = std::pow(a[i], b[i]); break;
+        case SQRT: for( i=0; i<len; ++i ) d[i] = std::sqrt(a[i]); break;
+        case ABS:  for( i=0; i<len; ++i ) d[i] = std::fabs(a[i]); break;
+        case EXP:  for( i=0; i<len; ++i ) d[i] = std::exp(a[i]); break;
+        case LOG:  for( i=0; i<len; ++i ) d[i] = std::log(a[i]); break;
+        case SIN:  for( i=0; i<len; ++i ) d[i] = std::sin(a[i]); break;
+        case COS:  for( i=0; i<len; ++i ) d[i] = std::cos(a[i]); break;
+        case TAN:  for( i=0; i<len; ++i ) d[i] = std::tan(a[i]); break;
+        case MIN:
+          for( i=0; i<len; ++i ) d[i] = std::min(a[i], b[i]);
+          break;
+        case MAX:
+          for( i=0; i<len; ++i ) d[i] = std::max(a[i], b[i]);
+          break;
+        default:
+          break;
+      }
+      reg[it->dst] = d;
+    }
+  }
+}
@@ -0,0 +1,127 @@
+#pragma once
+
+/*
+ *  Notices:
+ *  Copyright 2023 United States Government as represented by the
+ *  Administrator of the National Aeronautics and Space Administration.
+ *  No copyright is claimed in the United States under Title 17,
+ *  U.S. Code. All Other Rights Reserved.
+ *
+ *  Disclaimers No Warranty: THE SUBJECT SOFTWARE IS PROVIDED "AS
+ *  IS" WITHOUT ANY WARRANTY OF ANY KIND, EITHER EXPRESSED, IMPLIED,
+ *  OR STATUTORY, INCLUDING, BUT NOT LIMITED TO, ANY WARRANTY THAT
+ *  THE SUBJECT SOFTWARE WILL CONFORM TO SPECIFICATIONS, ANY IMPLIED
+ *  WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE,
+ *  OR FREEDOM FROM INFRINGEMENT, ANY WARRANTY THAT THE SUBJECT
+ *  SOFTWARE WILL BE ERROR FREE, OR ANY WARRANTY THAT DOCUMENTATION,
+ *  IF PROVIDED, WILL CONFORM TO THE SUBJECT SOFTWARE. THIS AGREEMENT
+ *  DOES NOT, IN ANY MANNER, CONSTITUTE AN ENDORSEMENT BY GOVERNMENT
+ *  AGENCY OR ANY PRIOR RECIPIENT OF ANY RESULTS, RESULTING DESIGNS,
+ *  HARDWARE, SOFTWARE PRODUCTS OR ANY OTHER APPLICATIONS RESULTING
+ *  FROM USE OF THE SUBJECT SOFTWARE.  FURTHER, GOVERNMENT AGENCY
+ *  DISCLAIMS ALL WARRANTIES AND LIABILITIES REGARDING THIRD-PARTY
+ *  SOFTWARE, IF PRESENT IN THE ORIGINAL SOFTWARE, AND DISTRIBUTES
+ *  IT "AS IS." 
+ *
+ *  Waiver and Indemnity:  RECIPIENT AGREES TO WAIVE ANY AND ALL
+ *  CLAIMS AGAINST THE UNITED STATES GOVERNMENT, ITS CONTRACTORS
+ *  AND SUBCONTRACTORS, AS WELL AS ANY PRIOR RECIPIENT.  IF RECIPIENT'S
+ *  USE OF THE SUBJECT SOFTWARE RESULTS IN ANY LIABILITIES, DEMANDS,
+ *  DAMAGES, EXPENSES OR LOSSES ARISING FROM SUCH USE, INCLUDING
+ *  ANY DAMAGES FROM PRODUCTS BASED ON, OR RESULTING FROM, RECIPIENT'S
+ *  USE OF THE SUBJECT SOFTWARE, RECIPIENT SHALL INDEMNIFY AND HOLD
+ *  HARMLESS THE UNITED STATES GOVERNMENT, ITS CONTRACTORS AND
+ *  SUBCONTRACTORS, AS WELL AS ANY PRIOR RECIPIENT, TO THE EXTENT
+ *  PERMITTED BY LAW.  RECIPIENT'S SOLE REMEDY FOR ANY SUCH MATTER
+ *  SHALL BE THE IMMEDIATE, UNILATERAL TERMINATION OF THIS AGREEMENT.
+ */
+
+#include <string>
+#include <vector>
+#include <map>
+#include <cstdint>
+
+namespace VisKombyne
+{
+
+/**
+ * Derived nodal fields defined by arithmetic expressions of other fields.
+ *
+ * Definitions such as "vmag = sqrt(u*u + v*v + w*w)" are parsed once into
+ * a single expression graph where identical subexpressions, across all
+ * definitions, are shared and constant subexpressions are folded.  The
+ * graph is compiled into a register bytecode evaluated over blocks of
+ * BLOCK nodes, every instruction being a tight loop over a block.
+ *
+ * Operators: + - * / ^ and unary minus.  Functions: sqrt, abs, exp, log,
+ * sin, cos, tan, pow, min, max.  A name refers to an input field or to a
+ * previously defined field; names with other characters may be quoted
+ * with double quotes.
+ */
+class Expressions
+{
+  public:
+    Expressions(const std::vector<std::string>& definitions);
+
+    /** Names of the defined fields */
+    inline const std::vector<std::string>& names() const { return m_names; }
+
+    /** Names of the input fields the definitions refer to */
+    inline const std::vector<std::string>& inputs() const { return m_inputs; }
+
+    /** Number of bytecode instructions */
+    inline size_t size() const { return m_code.size(); }
+
+    /**
+     * Evaluate the defined fields.
+     *
+     * @param n  Number of nodes
+     * @param inputs  Input values, in the order of inputs()
+     * @param outputs  Defined values, in the order of names()
+     */
+    void evaluate(int64_t n, const std::vector<const double*>& inputs,
+                  const std::vector<double*>& outputs) const;
+
+    static const int64_t BLOCK = 256;
+
+  private:
+    enum Op { CONST, LOAD, NEG, ADD, SUB, MUL, DIV, POW, SQRT, ABS, EXP, LOG,
+              SIN, COS, TAN, MIN, MAX, STORE };
+
+    struct Node
+    {
+      Op op;
+      int32_t a;
+      int32_t b;
+      double value;
+    };
+
+    struct Instruction
+    {
+      Op op;
+      int32_t dst;
+      int32_t a;
+      int32_t b;
+      double value;
+    };
+
+    class Parser;
+
+    static double apply(Op op, double a, double b);
+    int32_t node(Op op, int32_t a=-1, int32_t b=-1, double value=0.0);
+    int32_t input(const std::string& name);
+    void compile(const std::vector<int32_t>& outputs);
+
+  private:
+    std::vector<std::string> m_names;
+    std::vector<std::string> m_inputs;
+
+    /** Expression graph, nodes are unique */
+    std::vector<Node> m_nodes;
+    std::map<std::string, int32_t> m_defined;
+
+    std::vector<Instruction> m_code;
+    int32_t m_nregisters;
+};
+
+} // namespace VisKombyne
@@ -0,0 +1,215 @@
+/*
+ *  Notices:
+ *  Copyright 2023 United States Government as represented by the
+ *  Administrator of the National Aeronautics and Space Administration.
+ *  No copyright is claimed in the United States under Title 17,
+ *  U.S. Code. All Other Rights Reserved.
+ *
+ *  Disclaimers No Warranty: THE SUBJECT SOFTWARE IS PROVIDED "AS
+ *  IS" WITHOUT ANY WARRANTY OF ANY KIND, EITHER EXPRESSED, IMPLIED,
+ *  OR STATUTORY, INCLUDING, BUT NOT LIMITED TO, ANY WARRANTY THAT
+ *  THE SUBJECT SOFTWARE WILL CONFORM TO SPECIFICATIONS, ANY IMPLIED
+ *  WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE,
+ *  OR FREEDOM FROM INFRINGEMENT, ANY WARRANTY THAT THE SUBJECT
+ *  SOFTWARE WILL BE ERROR FREE, OR ANY WARRANTY THAT DOCUMENTATION,
+ *  IF PROVIDED, WILL CONFORM TO THE SUBJECT SOFTWARE. THIS AGREEMENT
+ *  DOES NOT, IN ANY MANNER, CONSTITUTE AN ENDORSEMENT BY GOVERNMENT
+ *  AGENCY OR ANY PRIOR RECIPIENT OF ANY RESULTS, RESULTING DESIGNS,
+ *  HARDWARE, SOFTWARE PRODUCTS OR ANY OTHER APPLICATIONS RESULTING
+ *  FROM USE OF THE SUBJECT SOFTWARE.  FURTHER, GOVERNMENT AGENCY
+ *  DISCLAIMS ALL WARRANTIES AND LIABILITIES REGARDING THIRD-PARTY
+ *  SOFTWARE, IF PRESENT IN THE ORIGINAL SOFTWARE, AND DISTRIBUTES
+ *  IT "AS IS." 
+ *
+ *  Waiver and Indemnity:  RECIPIENT AGREES TO WAIVE ANY AND ALL
+ *  CLAIMS AGAINST THE UNITED STATES GOVERNMENT, ITS CONTRACTORS
+ *  AND SUBCONTRACTORS, AS WELL AS ANY PRIOR RECIPIENT.  IF RECIPIENT'S
+ *  USE OF THE SUBJECT SOFTWARE RESULTS IN ANY LIABILITIES, DEMANDS,
+ *  DAMAGES, EXPENSES OR LOSSES ARISING FROM SUCH USE, INCLUDING
+ *  ANY DAMAGES FROM PRODUCTS BASED ON, OR RESULTING FROM, RECIPIENT'S
+ *  USE OF THE SUBJECT SOFTWARE, RECIPIENT SHALL INDEMNIFY AND HOLD
+ *  HARMLESS THE UNITED STATES GOVERNMENT, ITS CONTRACTORS AND
+ *  SUBCONTRACTORS, AS WELL AS ANY PRIOR RECIPIENT, TO THE EXTENT
+ *  PERMITTED BY LAW.  RECIPIENT'S SOLE REMEDY FOR ANY SUCH MATTER
+ *  SHALL BE THE IMMEDIATE, UNILATERAL TERMINATION OF THIS AGREEMENT.
+ */
+
+#ifdef __GNUG__
+  #pragma implementation "Extract.h"
+#endif
+
+#include <exception>
+#include <stdexcept>
+#include <algorithm>
+#include <cstring>
+
+#include "Extract.h"
+#include "kombyne_data_celltype.h"
+
+using namespace VisKombyne;
+
+std::vector<double>& Extract::addField(const std::string& name)
+{
+  m_names.push_back(name);
+  m_values.push_back(std::vector<double>(nPoints(), 0.0));
+  return m_values.back();
+}
+
+void Extract::append(const Extract& piece)
+{
+  if( 0 == nPoints() && m_names.empty() ) {
+    *this = piece;
+    return;
+  }
+
+  if( 0 == piece.nPoints() )
+    return;
+
+  if( m_names != piece.m_names )
+    throw std::runtime_error("Cannot append pieces with different fields");
+
+  for( size_t p=0; p<piece.m_part_names.size(); ++p ) {
+    m_part_names.push_back(piece.m_part_names[p]);
+    m_part_cells.push_back(piece.m_part_cells[p] + m_ncells);
+    m_part_conn.push_back(piece.m_part_conn[p] + m_conn.size());
+  }
+
+  int32_t offset = (int32_t)nPoints();
+
+  m_x.insert(m_x.end(), piece.m_x.begin(), piece.m_x.end());
+  m_y.insert(m_y.end(), piece.m_y.begin(), piece.m_y.end());
+  m_z.insert(m_z.end(), piece.m_z.begin(), piece.m_z.end());
+
+  const std::vector<int32_t>& conn = piece.m_conn;
+  for( size_t i=0; i<conn.size(); ) {
+    int32_t n = nodesPerCell(conn[i]);
+    m_conn.push_back(conn[i++]);
+    for( int32_t j=0; j<n; ++j )
+      m_conn.push_back(conn[i++] + offset);
+  }
+  m_ncells += piece.m_ncells;
+
+  for( size_t f=0; f<m_values.size(); ++f )
+    m_values[f].insert(m_values[f].end(), piece.m_values[f].begin(),
+                       piece.m_values[f].end());
+}
+
+void Extract::clear()
+{
+  m_x.clear();
+  m_y.clear();
+  m_z.clear();
+  m_ncells = 0;
+  m_conn.clear();
+  m_part_names.clear();
+  m_part_cells.clear();
+  m_part_conn.clear();
+  m_names.clear();
+  m_values.clear();
+}
+
+size_t Extract::bytes() const
+{
+  return (3 + m_values.size())*nPoints()*sizeof(double) +
+         m_conn.size()*sizeof(int32_t);
+}
+
+template <typename T>
+static inline void packArray(std::vector<char>& buffer, const T* data,
+                             int64_t n)
+{
+  const char* c = (const char*)&n;
+  buffer.insert(buffer.end(), c, c+sizeof(n));
+  c = (const char*)data;
+  buffer.insert(buffer.end(), c, c+n*sizeof(T));
+}
+
+template <typename T>
+static inline const char* unpackArray(const char* p, const char* end,
+                                      std::vector<T>& v)
+{
+  int64_t n;
+  if( p+sizeof(n) > end )
+    throw std::runtime_error("Truncated extract buffer");
+  memcpy(&n, p, sizeof(n));
+  p += sizeof(n);
+  if( n < 0 || p+n*sizeof(T) > end )
+    throw std::runtime_error("Truncated extract buffer");
+  v.resize(n);
+  memcpy(v.data(), p, n*sizeof(T));
+  return p + n*sizeof(T);
+}
+
+void Extract::pack(std::vector<char>& buffer) const
+{
+  buffer.reserve(buffer.size() + bytes() + 1024);
+
+  packArray(buffer, m_x.data(), m_x.size());
+  packArray(buffer, m_y.data(), m_y.size());
+  packArray(buffer, m_z.data(), m_z.size());
+  packArray(buffer, &m_ncells, 1);
+  packArray(buffer, m_conn.data(), m_conn.size());
+
+  int64_t nparts = m_part_names.size();
+  packArray(buffer, &nparts, 1);
+  for( int64_t i=0; i<nparts; ++i )
+    packArray(buffer, m_part_names[i].data(), m_part_names[i].size());
+  packArray(buffer, m_part_cells.data(), m_part_cells.size());
+  packArray(buffer, m_part_conn.data(), m_part_conn.size());
+
+  int64_t nfields = m_names.size();
+  packArray(buffer, &nfields, 1);
+  for( int64_t f=0; f<nfields; ++f ) {
+    packArray(buffer, m_names[f].data(), m_names[f].size());
+    packArray(buffer, m_values[f].data(), m_values[f].size());
+  }
+}
+
+void Extract::unpack(const char* buffer, size_t size)
+{
+  const char* p = buffer;
+  const char* end = buffer+size;
+  std::vector<int64_t> scalar;
+
+  p = unpackArray(p, end, m_x);
+  p = unpackArray(p, end, m_y);
+  p = unpackArray(p, end, m_z);
+  p = unpackArray(p, end, scalar);
+  m_ncells = scalar.at(0);
+  p = unpackArray(p, end, m_conn);
+
+  p = unpackArray(p, end, scalar);
+  int64_t nparts = scalar.at(0);
+  m_part_names.resize(nparts);
+  for( int64_t i=0; i<nparts; ++i ) {
+    std::vector<char> name;
+    p = unpackArray(p, end, name);
+    m_part_names[i].assign(name.begin(), name.end());
+  }
+  p = unpackArray(p, end, m_part_cells);
+  p = unpackArray(p, end, m_part_conn);
+
+  p = unpackArray(p, end, scalar);
+  int64_t nfields = scalar.at(0);
+  m_names.resize(nfields);
+  m_values.resize(nfields);
+  for( int64_t f=0; f<nfields; ++f ) {
+    std::vector<char> name;
+    p = unpackArray(p, end, name);
+    m_names[f].assign(name.begin(), name.end());
+    p = unpackArray(p, end, m_values[f]);
+  }
+}
+
+int32_t Extract::nodesPerCell(int32_t celltype)
+{
+  switch( celltype ) {
+    case KB_CELLTYPE_TRI:   return 3;
+    case KB_CELLTYPE_QUAD:  return 4;
+    case KB_CELLTYPE_TET:   return 4;
+    case KB_CELLTYPE_PYR:   return 5;
+    case KB_CELLTYPE_WEDGE: return 6;
+    case KB_CELLTYPE_HEX:   return 8;
+  }
+  throw std::runtime_error("Unsupported cell type");
+}
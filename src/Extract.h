@@ -0,0 +1,134 @@
+#pragma once
+
+/*
+ *  Notices:
+ *  Copyright 2023 United States Government as represented by the
+ *  Administrator of the National Aeronautics and Space Administration.
+ *  No copyright is claimed in the United States under Title 17,
+ *  U.S. Code. All Other Rights Reserved.
+ *
+ *  Disclaimers No Warranty: THE SUBJECT SOFTWARE IS PROVIDED "AS
+ *  IS" WITHOUT ANY WARRANTY OF ANY KIND, EITHER EXPRESSED, IMPLIED,
+ *  OR STATUTORY, INCLUDING, BUT NOT LIMITED TO, ANY WARRANTY THAT
+ *  THE SUBJECT SOFTWARE WILL CONFORM TO SPECIFICATIONS, ANY IMPLIED
+ *  WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE,
+ *  OR FREEDOM FROM INFRINGEMENT, ANY WARRANTY THAT THE SUBJECT
+ *  SOFTWARE WILL BE ERROR FREE, OR ANY WARRANTY THAT DOCUMENTATION,
+ *  IF PROVIDED, WILL CONFORM TO THE SUBJECT SOFTWARE. THIS AGREEMENT
+ *  DOES NOT, IN ANY MANNER, CONSTITUTE AN ENDORSEMENT BY GOVERNMENT
+ *  AGENCY OR ANY PRIOR RECIPIENT OF ANY RESULTS, RESULTING DESIGNS,
+ *  HARDWARE, SOFTWARE PRODUCTS OR ANY OTHER APPLICATIONS RESULTING
+ *  FROM USE OF THE SUBJECT SOFTWARE.  FURTHER, GOVERNMENT AGENCY
+ *  DISCLAIMS ALL WARRANTIES AND LIABILITIES REGARDING THIRD-PARTY
+ *  SOFTWARE, IF PRESENT IN THE ORIGINAL SOFTWARE, AND DISTRIBUTES
+ *  IT "AS IS." 
+ *
+ *  Waiver and Indemnity:  RECIPIENT AGREES TO WAIVE ANY AND ALL
+ *  CLAIMS AGAINST THE UNITED STATES GOVERNMENT, ITS CONTRACTORS
+ *  AND SUBCONTRACTORS, AS WELL AS ANY PRIOR RECIPIENT.  IF RECIPIENT'S
+ *  USE OF THE SUBJECT SOFTWARE RESULTS IN ANY LIABILITIES, DEMANDS,
+ *  DAMAGES, EXPENSES OR LOSSES ARISING FROM SUCH USE, INCLUDING
+ *  ANY DAMAGES FROM PRODUCTS BASED ON, OR RESULTING FROM, RECIPIENT'S
+ *  USE OF THE SUBJECT SOFTWARE, RECIPIENT SHALL INDEMNIFY AND HOLD
+ *  HARMLESS THE UNITED STATES GOVERNMENT, ITS CONTRACTORS AND
+ *  SUBCONTRACTORS, AS WELL AS ANY PRIOR RECIPIENT, TO THE EXTENT
+ *  PERMITTED BY LAW.  RECIPIENT'S SOLE REMEDY FOR ANY SUCH MATTER
+ *  SHALL BE THE IMMEDIATE, UNILATERAL TERMINATION OF THIS AGREEMENT.
+ */
+
+#include <string>
+#include <vector>
+#include <utility>
+#include <cstdint>
+
+namespace VisKombyne
+{
+
+/** Named nodal arrays handed to the native pipelines */
+typedef std::vector<std::pair<std::string, const double*> > NodalFields;
+
+/**
+ * Piece of unstructured data extracted on a rank by a native pipeline.
+ *
+ * Cells use the same interleaved connectivity as UMesh (Kombyne cell type
+ * followed by the cell nodes) with nodes local to the piece.  Cells may be
+ * grouped in named parts (e.g. boundaries), a part extends from its first
+ * cell to the first cell of the next part.
+ */
+class Extract
+{
+  public:
+    Extract() : m_ncells(0) {}
+
+    inline int64_t nPoints() const { return m_x.size(); }
+    inline int64_t nCells() const { return m_ncells; }
+    inline std::vector<double>& x() { return m_x; }
+    inline std::vector<double>& y() { return m_y; }
+    inline std::vector<double>& z() { return m_z; }
+    inline const std::vector<double>& x() const { return m_x; }
+    inline const std::vector<double>& y() const { return m_y; }
+    inline const std::vector<double>& z() const { return m_z; }
+    inline const std::vector<int32_t>& connectivity() const { return m_conn; }
+    inline const std::vector<std::string>& fieldNames() const
+      { return m_names; }
+    inline const std::vector<std::string>& partNames() const
+      { return m_part_names; }
+    /** First cell and first connectivity entry of each part */
+    inline const std::vector<int64_t>& partCells() const
+      { return m_part_cells; }
+    inline const std::vector<int64_t>& partConnectivity() const
+      { return m_part_conn; }
+    inline const std::vector<std::vector<double> >& fieldValues() const
+      { return m_values; }
+    inline std::vector<std::vector<double> >& fieldValues() { return m_values; }
+
+    inline int64_t addPoint(double x, double y, double z)
+    {
+      m_x.push_back(x);
+      m_y.push_back(y);
+      m_z.push_back(z);
+      return m_x.size()-1;
+    }
+
+    inline void addCell(int32_t celltype, const int32_t* nodes, int32_t n)
+    {
+      m_conn.push_back(celltype);
+      m_conn.insert(m_conn.end(), nodes, nodes+n);
+      ++m_ncells;
+    }
+
+    /** Start a part, the following cells belong to it */
+    inline void beginPart(const std::string& name)
+    {
+      m_part_names.push_back(name);
+      m_part_cells.push_back(m_ncells);
+      m_part_conn.push_back(m_conn.size());
+    }
+
+    std::vector<double>& addField(const std::string& name);
+    void append(const Extract& piece);
+    void clear();
+    size_t bytes() const;
+
+    void pack(std::vector<char>& buffer) const;
+    void unpack(const char* buffer, size_t size);
+
+    /**
+     * Number of nodes of a Kombyne cell type.
+     */
+    static int32_t nodesPerCell(int32_t celltype);
+
+  private:
+    std::vector<double> m_x;
+    std::vector<double> m_y;
+    std::vector<double> m_z;
+    int64_t m_ncells;
+    std::vector<int32_t> m_conn;
+    std::vector<std::string> m_part_names;
+    std::vector<int64_t> m_part_cells;
+    std::vector<int64_t> m_part_conn;
+    std::vector<std::string> m_names;
+    std::vector<std::vector<double> > m_values;
+};
+
+} // namespace VisKombyne
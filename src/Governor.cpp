@@ -0,0 +1,106 @@
+/*
+ *  Notices:
+ *  Copyright 2023 United States Government as represented by the
+ *  Administrator of the National Aeronautics and Space Administration.
+ *  No copyright is claimed in the United States under Title 17,
+ *  U.S. Code. All Other Rights Reserved.
+ *
+ *  Disclaimers No Warranty: THE SUBJECT SOFTWARE IS PROVIDED "AS
+ *  IS" WITHOUT ANY WARRANTY OF ANY KIND, EITHER EXPRESSED, IMPLIED,
+ *  OR STATUTORY, INCLUDING, BUT NOT LIMITED TO, ANY WARRANTY THAT
+ *  THE SUBJECT SOFTWARE WILL CONFORM TO SPECIFICATIONS, ANY IMPLIED
+ *  WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE,
+ *  OR FREEDOM FROM INFRINGEMENT, ANY WARRANTY THAT THE SUBJECT
+ *  SOFTWARE WILL BE ERROR FREE, OR ANY WARRANTY THAT DOCUMENTATION,
+ *  IF PROVIDED, WILL CONFORM TO THE SUBJECT SOFTWARE. THIS AGREEMENT
+ *  DOES NOT, IN ANY MANNER, CONSTITUTE AN ENDORSEMENT BY GOVERNMENT
+ *  AGENCY OR ANY PRIOR RECIPIENT OF ANY RESULTS, RESULTING DESIGNS,
+ *  HARDWARE, SOFTWARE PRODUCTS OR ANY OTHER APPLICATIONS RESULTING
+ *  FROM USE OF THE SUBJECT SOFTWARE.  FURTHER, GOVERNMENT AGENCY
+ *  DISCLAIMS ALL WARRANTIES AND LIABILITIES REGARDING THIRD-PARTY
+ *  SOFTWARE, IF PRESENT IN THE ORIGINAL SOFTWARE, AND DISTRIBUTES
+ *  IT "AS IS." 
+ *
+ *  Waiver and Indemnity:  RECIPIENT AGREES TO WAIVE ANY AND ALL
+ *  CLAIMS AGAINST THE UNITED STATES GOVERNMENT, ITS CONTRACTORS
+ *  AND SUBCONTRACTORS, AS WELL AS ANY PRIOR RECIPIENT.  IF RECIPIENT'S
+ *  USE OF THE SUBJECT SOFTWARE RESULTS IN ANY LIABILITIES, DEMANDS,
+ *  DAMAGES, EXPENSES OR LOSSES ARISING FROM SUCH USE, INCLUDING
+ *  ANY DAMAGES FROM PRODUCTS BASED ON, OR RESULTING FROM, RECIPIENT'S
+ *  USE OF THE SUBJECT SOFTWARE, RECIPIENT SHALL INDEMNIFY AND HOLD
+ *  HARMLESS THE UNITED STATES GOVERNMENT, ITS CONTRACTORS AND
+ *  SUBCONTRACTORS, AS WELL AS ANY PRIOR RECIPIENT, TO THE EXTENT
+ *  PERMITTED BY LAW.  RECIPIENT'S SOLE REMEDY FOR ANY SUCH MATTER
+ *  SHALL BE THE IMMEDIATE, UNILATERAL TERMINATION OF THIS AGREEMENT.
+ */
+
+#ifdef __GNUG__
+  #pragma implementation "Governor.h"
+#endif
+
+#include <exception>
+#include <stdexcept>
+#include <string>
+#include <sstream>
+#include <iostream>
+
+#include "Governor.h"
+#include "tinf_iris.h"
+#include "TinfCheck.h"
+
+using namespace VisKombyne;
+
+bool Governor::admit(int64_t step)
+{
+  int error;
+
+  if( !enabled() )
+    return true;
+
+  /* The back-off is adjusted once per executed output, on the first
+   * triggered step after it, from the fraction of the wall time spent
+   * visualizing since that output; the most loaded rank decides for all.
+   * The following triggered steps only count the skips. */
+  if( m_measure ) {
+    double local = 0.0;
+    if( m_vis + m_solver > 0.0 )
+      local = m_vis/(m_vis + m_solver);
+
+    m_fraction = local;
+    size_t dims[TINF_DATA_MAX_RANK] = {1, 1};
+    error = tinf_iris_max(m_comm, TINF_DOUBLE, 0, dims, &local, &m_fraction);
+    TINF_CHECK_SUCCESS(error, "Could not reduce visualization time fraction");
+    m_measure = false;
+
+    if( m_fraction > m_budget && m_backoff < MAX_BACKOFF ) {
+      m_backoff *= 2;
+      log(step, "increase back-off", m_fraction);
+    } else if( m_fraction < 0.5*m_budget && m_backoff > 1 ) {
+      m_backoff /= 2;
+      log(step, "decrease back-off", m_fraction);
+    }
+  }
+
+  if( m_skipped+1 < m_backoff ) {
+    ++m_skipped;
+    log(step, "skip output", m_fraction);
+    return false;
+  }
+
+  m_skipped = 0;
+  m_solver = 0.0;
+  m_vis = 0.0;
+  m_measure = true;
+
+  return true;
+}
+
+void Governor::log(int64_t step, const char* decision, double fraction)
+{
+  int error;
+
+  if( 0 == tinf_iris_rank(m_comm, &error) )
+    std::cerr << "Visualization budget: step=" << step << ", " << decision
+              << ", back-off=" << m_backoff << ", fraction=" << fraction
+              << ", budget=" << m_budget << std::endl;
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+/*
+ *  Notices:
+ *  Copyright 2023 United States Government as represented by the
+ *  Administrator of the National Aeronautics and Space Administration.
+ *  No copyright is claimed in the United States under Title 17,
+ *  U.S. Code. All Other Rights Reserved.
+ *
+ *  Disclaimers No Warranty: THE SUBJECT SOFTWARE IS PROVIDED "AS
+ *  IS" WITHOUT ANY WARRANTY OF ANY KIND, EITHER EXPRESSED, IMPLIED,
+ *  OR STATUTORY, INCLUDING, BUT NOT LIMITED TO, ANY WARRANTY THAT
+ *  THE SUBJECT SOFTWARE WILL CONFORM TO SPECIFICATIONS, ANY IMPLIED
+ *  WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE,
+ *  OR FREEDOM FROM INFRINGEMENT, ANY WARRANTY THAT THE SUBJECT
+ *  SOFTWARE WILL BE ERROR FREE, OR ANY WARRANTY THAT DOCUMENTATION,
+ *  IF PROVIDED, WILL CONFORM TO THE SUBJECT SOFTWARE. THIS AGREEMENT
+ *  DOES NOT, IN ANY MANNER, CONSTITUTE AN ENDORSEMENT BY GOVERNMENT
+ *  AGENCY OR ANY PRIOR RECIPIENT OF ANY RESULTS, RESULTING DESIGNS,
+ *  HARDWARE, SOFTWARE PRODUCTS OR ANY OTHER APPLICATIONS RESULTING
+ *  FROM USE OF THE SUBJECT SOFTWARE.  FURTHER, GOVERNMENT AGENCY
+ *  DISCLAIMS ALL WARRANTIES AND LIABILITIES REGARDING THIRD-PARTY
+ *  SOFTWARE, IF PRESENT IN THE ORIGINAL SOFTWARE, AND DISTRIBUTES
+ *  IT "AS IS." 
+ *
+ *  Waiver and Indemnity:  RECIPIENT AGREES TO WAIVE ANY AND ALL
+ *  CLAIMS AGAINST THE UNITED STATES GOVERNMENT, ITS CONTRACTORS
+ *  AND SUBCONTRACTORS, AS WELL AS ANY PRIOR RECIPIENT.  IF RECIPIENT'S
+ *  USE OF THE SUBJECT SOFTWARE RESULTS IN ANY LIABILITIES, DEMANDS,
+ *  DAMAGES, EXPENSES OR LOSSES ARISING FROM SUCH USE, INCLUDING
+ *  ANY DAMAGES FROM PRODUCTS BASED ON, OR RESULTING FROM, RECIPIENT'S
+ *  USE OF THE SUBJECT SOFTWARE, RECIPIENT SHALL INDEMNIFY AND HOLD
+ *  HARMLESS THE UNITED STATES GOVERNMENT, ITS CONTRACTORS AND
+ *  SUBCONTRACTORS, AS WELL AS ANY PRIOR RECIPIENT, TO THE EXTENT
+ *  PERMITTED BY LAW.  RECIPIENT'S SOLE REMEDY FOR ANY SUCH MATTER
+ *  SHALL BE THE IMMEDIATE, UNILATERAL TERMINATION OF THIS AGREEMENT.
+ */
+
+#include <cstdint>
+
+namespace VisKombyne
+{
+
+/**
+ * Visualization time budget governor.
+ *
+ * Keeps the time spent in the outputs under a fraction of the wall time by
+ * backing off the output frequency.  The solver and output times are
+ * accumulated between executed outputs and the decision is reduced over
+ * all ranks so that they execute the pipeline consistently.
+ */
+class Governor
+{
+  public:
+    /**
+     * Constructor.
+     *
+     * @param comm  Communications object
+     * @param budget  Fraction of the wall time allowed (0 disables)
+     */
+    Governor(void* comm, double budget) :
+      m_comm(comm), m_budget(budget), m_backoff(1), m_skipped(0),
+      m_solver(0.0), m_vis(0.0), m_fraction(0.0), m_measure(true) {}
+
+    inline bool enabled() const { return m_budget > 0.0; }
+    inline void solver(double seconds) { m_solver += seconds; }
+    inline void visualization(double seconds) { m_vis += seconds; }
+    inline int32_t backoff() const { return m_backoff; }
+
+    /**
+     * Decide whether a triggered output is executed.
+     *
+     * @param step  Solver step of the output
+     * @returns true if the output fits in the budget.
+     */
+    bool admit(int64_t step);
+
+    /** Largest frequency back-off factor */
+    static const int32_t MAX_BACKOFF = 1024;
+
+  private:
+    inline void log(int64_t step, const char* decision, double fraction);
+
+  private:
+    void* m_comm;
+    double m_budget;
+    int32_t m_backoff;
+    int32_t m_skipped;
+    double m_solver;
+    double m_vis;
+    double m_fraction;
+    bool m_measure;
+};
+
+} // namespace VisKombyne
@@ -0,0 +1,299 @@
+/*
+ *  Notices:
+ *  Copyright 2023 United States Government as represented by the
+ *  Administrator of the National Aeronautics and Space Administration.
+ *  No copyright is claimed in the United States under Title 17,
+ *  U.S. Code. All Other Rights Reserved.
+ *
+ *  Disclaimers No Warranty: THE SUBJECT SOFTWARE IS PROVIDED "AS
+ *  IS" WITHOUT ANY WARRANTY OF ANY KIND, EITHER EXPRESSED, IMPLIED,
+ *  OR STATUTORY, INCLUDING, BUT NOT LIMITED TO, ANY WARRANTY THAT
+ *  THE SUBJECT SOFTWARE WILL CONFORM TO SPECIFICATIONS, ANY IMPLIED
+ *  WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE,
+ *  OR FREEDOM FROM INFRINGEMENT, ANY WARRANTY THAT THE SUBJECT
+ *  SOFTWARE WILL BE ERROR FREE, OR ANY WARRANTY THAT DOCUMENTATION,
+ *  IF PROVIDED, WILL CONFORM TO THE SUBJECT SOFTWARE. THIS AGREEMENT
+ *  DOES NOT, IN ANY MANNER, CONSTITUTE AN ENDORSEMENT BY GOVERNMENT
+ *  AGENCY OR ANY PRIOR RECIPIENT OF ANY RESULTS, RESULTING DESIGNS,
+ *  HARDWARE, SOFTWARE PRODUCTS OR ANY OTHER APPLICATIONS RESULTING
+ *  FROM USE OF THE SUBJECT SOFTWARE.  FURTHER, GOVERNMENT AGENCY
+ *  DISCLAIMS ALL WARRANTIES AND LIABILITIES REGARDING THIRD-PARTY
+ *  SOFTWARE, IF PRESENT IN THE ORIGINAL SOFTWARE, AND DISTRIBUTES
+ *  IT "AS IS." 
+ *
+ *  Waiver and Indemnity:  RECIPIENT AGREES TO WAIVE ANY AND ALL
+ *  CLAIMS AGAINST THE UNITED STATES GOVERNMENT, ITS CONTRACTORS
+ *  AND SUBCONTRACTORS, AS WELL AS ANY PRIOR RECIPIENT.  IF RECIPIENT'S
+ *  USE OF THE SUBJECT SOFTWARE RESULTS IN ANY LIABILITIES, DEMANDS,
+ *  DAMAGES, EXPENSES OR LOSSES ARISING FROM SUCH USE, INCLUDING
+ *  ANY DAMAGES FROM PRODUCTS BASED ON, OR RESULTING FROM, RECIPIENT'S
+ *  USE OF THE SUBJECT SOFTWARE, RECIPIENT SHALL INDEMNIFY AND HOLD
+ *  HARMLESS THE UNITED STATES GOVERNMENT, ITS CONTRACTORS AND
+ *  SUBCONTRACTORS, AS WELL AS ANY PRIOR RECIPIENT, TO THE EXTENT
+ *  PERMITTED BY LAW.  RECIPIENT'S SOLE REMEDY FOR ANY SUCH MATTER
+ *  SHALL BE THE IMMEDIATE, UNILATERAL TERMINATION OF THIS AGREEMENT.
+ */
+
+#ifdef __GNUG__
+  #pragma implementation "Gradient.h"
+#endif
+
+#include <exception>
+#include <stdexcept>
+#include <algorithm>
+#include <thread>
+#include <cmath>
+
+#include "Gradient.h"
+#include "Extract.h"
+#include "kombyne_data_celltype.h"
+
+using namespace VisKombyne;
+
+namespace
+{
+
+/**
+ * Edges of the cell types, pairs of cell nodes.
+ */
+const int32_t TET_EDGES[]   = {0,1, 1,2, 2,0, 0,3, 1,3, 2,3};
+const int32_t PYR_EDGES[]   = {0,1, 1,2, 2,3, 3,0, 0,4, 1,4, 2,4, 3,4};
+const int32_t WEDGE_EDGES[] = {0,1, 1,2, 2,0, 3,4, 4,5, 5,3, 0,3, 1,4, 2,5};
+const int32_t HEX_EDGES[]   = {0,1, 1,2, 2,3, 3,0, 4,5, 5,6, 6,7, 7,4,
+                               0,4, 1,5, 2,6, 3,7};
+
+int32_t edges(int32_t celltype, const int32_t** e)
+{
+  switch( celltype ) {
+    case KB_CELLTYPE_TET:   *e = TET_EDGES;   return 6;
+    case KB_CELLTYPE_PYR:   *e = PYR_EDGES;   return 8;
+    case KB_CELLTYPE_WEDGE: *e = WEDGE_EDGES; return 9;
+    case KB_CELLTYPE_HEX:   *e = HEX_EDGES;   return 12;
+  }
+  throw std::runtime_error("Unsupported cell type for gradients");
+}
+
+/*
+ * Middle eigenvalue of a symmetric 3x3 matrix (a00, a11, a22, a01, a02,
+ * a12), closed form of the characteristic cubic.
+ */
+double middleEigenvalue(double a00, double a11, double a22, double a01,
+                        double a02, double a12)
+{
+  double p1 = a01*a01 + a02*a02 + a12*a12;
+  double q = (a00 + a11 + a22)/3.0;
+  double p2 = (a00-q)*(a00-q) + (a11-q)*(a11-q) + (a22-q)*(a22-q) + 2.0*p1;
+  double p = std::sqrt(p2/6.0);
+  if( p < 1.0e-300 )
+    return q;
+
+  double b00 = (a00-q)/p, b11 = (a11-q)/p, b22 = (a22-q)/p;
+  double b01 = a01/p, b02 = a02/p, b12 = a12/p;
+  double r = 0.5*(b00*(b11*b22 - b12*b12) - b01*(b01*b22 - b12*b02) +
+                  b02*(b01*b12 - b11*b02));
+  r = std::min(1.0, std::max(-1.0, r));
+
+  double phi = std::acos(r)/3.0;
+  double largest = q + 2.0*p*std::cos(phi);
+  double smallest = q + 2.0*p*std::cos(phi + 2.0*M_PI/3.0);
+  return 3.0*q - largest - smallest;
+}
+
+} // namespace
+
+
+Gradient::Gradient(UMesh& mesh, int32_t nthreads) :
+  m_mesh(mesh), m_nthreads(std::max(nthreads, 1)), m_generation(-1)
+{
+  adjacency();
+}
+
+/*
+ * Node adjacency from the edges of all local cells.
+ */
+void Gradient::adjacency()
+{
+  const int32_t* conn = m_mesh.cellConnects();
+  int64_t nnodes = m_mesh.nNodes01();
+
+  std::vector<std::vector<int32_t> > neighbors(nnodes);
+  for( int64_t i=0; i<m_mesh.cellConnectsSize(); ) {
+    int32_t celltype = conn[i];
+    const int32_t* nodes = conn+i+1;
+    const int32_t* e;
+    int32_t nedges = edges(celltype, &e);
+    for( int32_t k=0; k<nedges; ++k ) {
+      int32_t a = nodes[e[2*k]], b = nodes[e[2*k+1]];
+      neighbors[a].push_back(b);
+      neighbors[b].push_back(a);
+    }
+    i += Extract::nodesPerCell(celltype) + 1;
+  }
+
+  m_offsets.assign(1, 0);
+  m_offsets.reserve(nnodes+1);
+  m_neighbors.clear();
+  for( int64_t n=0; n<nnodes; ++n ) {
+    std::vector<int32_t>& v = neighbors[n];
+    std::sort(v.begin(), v.end());
+    v.erase(std::unique(v.begin(), v.end()), v.end());
+    m_neighbors.insert(m_neighbors.end(), v.begin(), v.end());
+    m_offsets.push_back(m_neighbors.size());
+    std::vector<int32_t>().swap(v);
+  }
+}
+
+/*
+ * Least squares coefficients: with d the edge vectors and w = 1/|d|^2,
+ * grad(u)_n = M^-1 sum w d (u_j - u_n) where M = sum w d d^T, so each edge
+ * gets c = M^-1 w d.
+ */
+void Gradient::coefficients()
+{
+  const double* x = m_mesh.x();
+  const double* y = m_mesh.y();
+  const double* z = m_mesh.z();
+
+  for( int32_t d=0; d<3; ++d )
+    m_coef[d].resize(m_neighbors.size());
+
+  parallel([&](int64_t begin, int64_t end) {
+    for( int64_t n=begin; n<end; ++n ) {
+      double m[6] = {0.0, 0.0, 0.0, 0.0, 0.0, 0.0};
+      for( int64_t k=m_offsets[n]; k<m_offsets[n+1]; ++k ) {
+        int32_t j = m_neighbors[k];
+        double d[3] = {x[j]-x[n], y[j]-y[n], z[j]-z[n]};
+        double w = 1.0/std::max(d[0]*d[0] + d[1]*d[1] + d[2]*d[2], 1.0e-300);
+        m[0] += w*d[0]*d[0]; m[1] += w*d[1]*d[1]; m[2] += w*d[2]*d[2];
+        m[3] += w*d[0]*d[1]; m[4] += w*d[0]*d[2]; m[5] += w*d[1]*d[2];
+      }
+
+      /* Inverse of the symmetric normal matrix by cofactors */
+      double c00 = m[1]*m[2] - m[5]*m[5];
+      double c01 = m[4]*m[5] - m[3]*m[2];
+      double c02 = m[3]*m[5] - m[4]*m[1];
+      double c11 = m[0]*m[2] - m[4]*m[4];
+      double c12 = m[3]*m[4] - m[0]*m[5];
+      double c22 = m[0]*m[1] - m[3]*m[3];
+      double det = m[0]*c00 + m[3]*c01 + m[4]*c02;
+      double scale = m[0] + m[1] + m[2];
+      double inv = std::fabs(det) > 1.0e-12*scale*scale*scale ? 1.0/det : 0.0;
+
+      for( int64_t k=m_offsets[n]; k<m_offsets[n+1]; ++k ) {
+        int32_t j = m_neighbors[k];
+        double d[3] = {x[j]-x[n], y[j]-y[n], z[j]-z[n]};
+        double w = inv/std::max(d[0]*d[0] + d[1]*d[1] + d[2]*d[2], 1.0e-300);
+        m_coef[0][k] = w*(c00*d[0] + c01*d[1] + c02*d[2]);
+        m_coef[1][k] = w*(c01*d[0] + c11*d[1] + c12*d[2]);
+        m_coef[2][k] = w*(c02*d[0] + c12*d[1] + c22*d[2]);
+      }
+    }
+  });
+
+  m_generation = m_mesh.generation();
+}
+
+/*
+ * Run f(begin, end) over contiguous node ranges on the threads.
+ */
+template<class F> void Gradient::parallel(F f)
+{
+  int64_t nnodes = m_mesh.nNodes01();
+  int64_t chunk = (nnodes + m_nthreads - 1)/m_nthreads;
+
+  std::vector<std::thread> threads;
+  for( int32_t t=1; t<m_nthreads; ++t ) {
+    int64_t begin = std::min(t*chunk, nnodes);
+    int64_t end = std::min(begin + chunk, nnodes);
+    threads.push_back(std::thread(f, begin, end));
+  }
+  f(0, std::min(chunk, nnodes));
+
+  std::vector<std::thread>::iterator it;
+  for(it = threads.begin(); it != threads.end(); ++it)
+    it->join();
+}
+
+void Gradient::gradient(const double* u, double* const g[3])
+{
+  if( m_mesh.generation() != m_generation )
+    coefficients();
+
+  const int64_t* offsets = m_offsets.data();
+  const int32_t* neighbors = m_neighbors.data();
+  const double* cx = m_coef[0].data();
+  const double* cy = m_coef[1].data();
+  const double* cz = m_coef[2].data();
+
+  parallel([&](int64_t begin, int64_t end) {
+    for( int64_t n=begin; n<end; ++n ) {
+      double gx = 0.0, gy = 0.0, gz = 0.0;
+      for( int64_t k=offsets[n]; k<offsets[n+1]; ++k ) {
+        double du = u[neighbors[k]] - u[n];
+        gx += cx[k]*du;
+        gy += cy[k]*du;
+        gz += cz[k]*du;
+      }
+      g[0][n] = gx;
+      g[1][n] = gy;
+      g[2][n] = gz;
+    }
+  });
+
+  for( int32_t d=0; d<3; ++d )
+    m_mesh.syncNodes(g[d]);
+}
+
+void Gradient::velocityGradient(const double* const u[3],
+                                double* const grad[9])
+{
+  for( int32_t i=0; i<3; ++i )
+    gradient(u[i], &grad[3*i]);
+}
+
+void Gradient::vortex(const double* const grad[9],
+                      double* const vorticity[3], double* magnitude,
+                      double* q, double* lambda2)
+{
+  parallel([&](int64_t begin, int64_t end) {
+    for( int64_t n=begin; n<end; ++n ) {
+      double g[9];
+      for( int32_t k=0; k<9; ++k )
+        g[k] = grad[k][n];
+
+      /* Strain rate S and rotation W */
+      double s00 = g[0], s11 = g[4], s22 = g[8];
+      double s01 = 0.5*(g[1]+g[3]), s02 = 0.5*(g[2]+g[6]);
+      double s12 = 0.5*(g[5]+g[7]);
+      double w01 = 0.5*(g[1]-g[3]), w02 = 0.5*(g[2]-g[6]);
+      double w12 = 0.5*(g[5]-g[7]);
+
+      double wx = g[7] - g[5], wy = g[2] - g[6], wz = g[3] - g[1];
+      if( vorticity ) {
+        vorticity[0][n] = wx;
+        vorticity[1][n] = wy;
+        vorticity[2][n] = wz;
+      }
+      if( magnitude )
+        magnitude[n] = std::sqrt(wx*wx + wy*wy + wz*wz);
+
+      if( q ) {
+        double w2 = 2.0*(w01*w01 + w02*w02 + w12*w12);
+        double s2 = s00*s00 + s11*s11 + s22*s22 +
+                    2.0*(s01*s01 + s02*s02 + s12*s12);
+        q[n] = 0.5*(w2 - s2);
+      }
+
+      if( lambda2 ) {
+        /* S^2 + W^2, W antisymmetric with w10 = -w01 */
+        double a00 = s00*s00 + s01*s01 + s02*s02 - w01*w01 - w02*w02;
+        double a11 = s01*s01 + s11*s11 + s12*s12 - w01*w01 - w12*w12;
+        double a22 = s02*s02 + s12*s12 + s22*s22 - w02*w02 - w12*w12;
+        double a01 = s00*s01 + s01*s11 + s02*s12 - w02*w12;
+        double a02 = s00*s02 + s01*s12 + s02*s22 + w01*w12;
+        double a12 = s01*s02 + s11*s12 + s12*s22 - w01*w02;
+        lambda2[n] = middleEigenvalue(a00, a11, a22, a01, a02, a12);
+      }
+    }
+  });
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+/*
+ *  Notices:
+ *  Copyright 2023 United States Government as represented by the
+ *  Administrator of the National Aeronautics and Space Administration.
+ *  No copyright is claimed in the United States under Title 17,
+ *  U.S. Code. All Other Rights Reserved.
+ *
+ *  Disclaimers No Warranty: THE SUBJECT SOFTWARE IS PROVIDED "AS
+ *  IS" WITHOUT ANY WARRANTY OF ANY KIND, EITHER EXPRESSED, IMPLIED,
+ *  OR STATUTORY, INCLUDING, BUT NOT LIMITED TO, ANY WARRANTY THAT
+ *  THE SUBJECT SOFTWARE WILL CONFORM TO SPECIFICATIONS, ANY IMPLIED
+ *  WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE,
+ *  OR FREEDOM FROM INFRINGEMENT, ANY WARRANTY THAT THE SUBJECT
+ *  SOFTWARE WILL BE ERROR FREE, OR ANY WARRANTY THAT DOCUMENTATION,
+ *  IF PROVIDED, WILL CONFORM TO THE SUBJECT SOFTWARE. THIS AGREEMENT
+ *  DOES NOT, IN ANY MANNER, CONSTITUTE AN ENDORSEMENT BY GOVERNMENT
+ *  AGENCY OR ANY PRIOR RECIPIENT OF ANY RESULTS, RESULTING DESIGNS,
+ *  HARDWARE, SOFTWARE PRODUCTS OR ANY OTHER APPLICATIONS RESULTING
+ *  FROM USE OF THE SUBJECT SOFTWARE.  FURTHER, GOVERNMENT AGENCY
+ *  DISCLAIMS ALL WARRANTIES AND LIABILITIES REGARDING THIRD-PARTY
+ *  SOFTWARE, IF PRESENT IN THE ORIGINAL SOFTWARE, AND DISTRIBUTES
+ *  IT "AS IS." 
+ *
+ *  Waiver and Indemnity:  RECIPIENT AGREES TO WAIVE ANY AND ALL
+ *  CLAIMS AGAINST THE UNITED STATES GOVERNMENT, ITS CONTRACTORS
+ *  AND SUBCONTRACTORS, AS WELL AS ANY PRIOR RECIPIENT.  IF RECIPIENT'S
+ *  USE OF THE SUBJECT SOFTWARE RESULTS IN ANY LIABILITIES, DEMANDS,
+ *  DAMAGES, EXPENSES OR LOSSES ARISING FROM SUCH USE, INCLUDING
+ *  ANY DAMAGES FROM PRODUCTS BASED ON, OR RESULTING FROM, RECIPIENT'S
+ *  USE OF THE SUBJECT SOFTWARE, RECIPIENT SHALL INDEMNIFY AND HOLD
+ *  HARMLESS THE UNITED STATES GOVERNMENT, ITS CONTRACTORS AND
+ *  SUBCONTRACTORS, AS WELL AS ANY PRIOR RECIPIENT, TO THE EXTENT
+ *  PERMITTED BY LAW.  RECIPIENT'S SOLE REMEDY FOR ANY SUCH MATTER
+ *  SHALL BE THE IMMEDIATE, UNILATERAL TERMINATION OF THIS AGREEMENT.
+ */
+
+#include <vector>
+#include <cstdint>
+
+#include "UMesh.h"
+
+namespace VisKombyne
+{
+
+/**
+ * Nodal gradients by weighted least squares over the node adjacency of a
+ * UMesh, and the vortex quantities derived from the velocity gradient.
+ *
+ * The adjacency is built once from the cell edges.  The least squares
+ * weights of every edge (inverse distance squared) are folded with the
+ * inverse of the nodal normal matrix into one coefficient vector per edge,
+ * cached while the mesh does not move, so a gradient is a single sweep
+ * over the edges.  The nodes are split over threads, ghost node values
+ * are synced from their owners afterwards since their stencils are
+ * incomplete.
+ */
+class Gradient
+{
+  public:
+    Gradient(UMesh& mesh, int32_t nthreads=1);
+
+    /**
+     * Gradient of a nodal scalar.
+     *
+     * @param u  Nodal values
+     * @param g  Components (x, y, z) of the gradient
+     */
+    void gradient(const double* u, double* const g[3]);
+
+    /**
+     * Velocity gradient tensor, grad[3*i+j] holds d(u_i)/dx_j.
+     */
+    void velocityGradient(const double* const u[3], double* const grad[9]);
+
+    /**
+     * Vortex quantities from the velocity gradient tensor, NULL outputs
+     * are skipped.
+     *
+     * @param vorticity  Vorticity components
+     * @param magnitude  Vorticity magnitude
+     * @param q  Q-criterion, 0.5*(|W|^2 - |S|^2)
+     * @param lambda2  Second eigenvalue of S^2 + W^2
+     */
+    void vortex(const double* const grad[9], double* const vorticity[3],
+                double* magnitude, double* q, double* lambda2);
+
+  private:
+    void adjacency();
+    void coefficients();
+    template<class F> void parallel(F f);
+
+  private:
+    UMesh& m_mesh;
+    int32_t m_nthreads;
+
+    /** Node adjacency (CSR) and the coefficients of each entry */
+    std::vector<int64_t> m_offsets;
+    std::vector<int32_t> m_neighbors;
+    std::vector<double> m_coef[3];
+    int64_t m_generation;
+};
+
+} // namespace VisKombyne
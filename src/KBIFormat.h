@@ -0,0 +1,155 @@
+#pragma once
+
+/*
+ *  Notices:
+ *  Copyright 2023 United States Government as represented by the
+ *  Administrator of the National Aeronautics and Space Administration.
+ *  No copyright is claimed in the United States under Title 17,
+ *  U.S. Code. All Other Rights Reserved.
+ *
+ *  Disclaimers No Warranty: THE SUBJECT SOFTWARE IS PROVIDED "AS
+ *  IS" WITHOUT ANY WARRANTY OF ANY KIND, EITHER EXPRESSED, IMPLIED,
+ *  OR STATUTORY, INCLUDING, BUT NOT LIMITED TO, ANY WARRANTY THAT
+ *  THE SUBJECT SOFTWARE WILL CONFORM TO SPECIFICATIONS, ANY IMPLIED
+ *  WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE,
+ *  OR FREEDOM FROM INFRINGEMENT, ANY WARRANTY THAT THE SUBJECT
+ *  SOFTWARE WILL BE ERROR FREE, OR ANY WARRANTY THAT DOCUMENTATION,
+ *  IF PROVIDED, WILL CONFORM TO THE SUBJECT SOFTWARE. THIS AGREEMENT
+ *  DOES NOT, IN ANY MANNER, CONSTITUTE AN ENDORSEMENT BY GOVERNMENT
+ *  AGENCY OR ANY PRIOR RECIPIENT OF ANY RESULTS, RESULTING DESIGNS,
+ *  HARDWARE, SOFTWARE PRODUCTS OR ANY OTHER APPLICATIONS RESULTING
+ *  FROM USE OF THE SUBJECT SOFTWARE.  FURTHER, GOVERNMENT AGENCY
+ *  DISCLAIMS ALL WARRANTIES AND LIABILITIES REGARDING THIRD-PARTY
+ *  SOFTWARE, IF PRESENT IN THE ORIGINAL SOFTWARE, AND DISTRIBUTES
+ *  IT "AS IS." 
+ *
+ *  Waiver and Indemnity:  RECIPIENT AGREES TO WAIVE ANY AND ALL
+ *  CLAIMS AGAINST THE UNITED STATES GOVERNMENT, ITS CONTRACTORS
+ *  AND SUBCONTRACTORS, AS WELL AS ANY PRIOR RECIPIENT.  IF RECIPIENT'S
+ *  USE OF THE SUBJECT SOFTWARE RESULTS IN ANY LIABILITIES, DEMANDS,
+ *  DAMAGES, EXPENSES OR LOSSES ARISING FROM SUCH USE, INCLUDING
+ *  ANY DAMAGES FROM PRODUCTS BASED ON, OR RESULTING FROM, RECIPIENT'S
+ *  USE OF THE SUBJECT SOFTWARE, RECIPIENT SHALL INDEMNIFY AND HOLD
+ *  HARMLESS THE UNITED STATES GOVERNMENT, ITS CONTRACTORS AND
+ *  SUBCONTRACTORS, AS WELL AS ANY PRIOR RECIPIENT, TO THE EXTENT
+ *  PERMITTED BY LAW.  RECIPIENT'S SOLE REMEDY FOR ANY SUCH MATTER
+ *  SHALL BE THE IMMEDIATE, UNILATERAL TERMINATION OF THIS AGREEMENT.
+ */
+
+#include <cstdint>
+
+namespace VisKombyne
+{
+
+/**
+ * Kombyne indexed binary (kbi) file layout.
+ *
+ * A kbi file holds one unstructured piece per writing rank (a block) in
+ * native byte order:
+ *
+ *   Header
+ *   char names[nparts+nfields][NAME_LENGTH]   part names, then field names
+ *   Block blocks[nblocks+1]                   prefix offsets of each block
+ *   Range ranges[nranges]                     cells of the parts per block
+ *   int64_t sections[SECTION_FIELDS+nfields]  byte offsets of the arrays
+ *   Chunk chunks[nfields][nblocks]            encoding of the field blocks
+ *
+ * followed by the arrays, each starting on an ALIGNMENT boundary: the x,
+ * y and z coordinates (double), the interleaved connectivity (int32,
+ * Kombyne cell type followed by the file-global point ids of the cell) and
+ * one array per nodal field.  The blocks are contiguous in every array, so
+ * one field or one block is a single contiguous read.
+ *
+ * Field blocks are raw doubles or compressed (see Codec).  CODEC_PREDICTIVE
+ * stores the quantized values predicted by the previous node, CODEC_DELTA
+ * the quantized change since the same block of the previous output, so
+ * decoding it requires the previous outputs back to the last keyframe (a
+ * raw or predictive block).
+ */
+namespace KBI
+{
+
+static const char MAGIC[8] = { 'K', 'B', 'I', 'N', 'D', 'E', 'X', '\0' };
+static const uint32_t VERSION = 2;
+static const uint32_t ENDIAN = 0x01020304;
+static const int64_t ALIGNMENT = 64;
+static const int64_t NAME_LENGTH = 64;
+
+enum Section
+{
+  SECTION_X = 0,
+  SECTION_Y,
+  SECTION_Z,
+  SECTION_CONNECTIVITY,
+  SECTION_FIELDS
+};
+
+struct Header
+{
+  char magic[8];
+  uint32_t version;
+  uint32_t endian;
+  int64_t nblocks;
+  int64_t nparts;
+  int64_t nfields;
+  int64_t nranges;
+  int64_t npoints;
+  int64_t ncells;
+  int64_t nconn;
+  int64_t reserved[7];
+};
+
+enum Encoding
+{
+  CODEC_RAW = 0,
+  CODEC_DELTA,
+  CODEC_PREDICTIVE
+};
+
+/** Start of a block (block nblocks is the end of the data) */
+struct Block
+{
+  int64_t point;
+  int64_t cell;
+  int64_t conn;
+};
+
+/** Cells and connectivity of a part in a block, file-global ranges */
+struct Range
+{
+  int64_t part;
+  int64_t block;
+  int64_t cell_begin;
+  int64_t cell_end;
+  int64_t conn_begin;
+  int64_t conn_end;
+};
+
+/** Encoded field block */
+struct Chunk
+{
+  int64_t offset;
+  int64_t bytes;
+  int64_t codec;
+  int64_t reserved;
+  double step;
+  double max_error;
+};
+
+inline int64_t align(int64_t offset)
+{
+  return (offset + ALIGNMENT-1)/ALIGNMENT*ALIGNMENT;
+}
+
+/** Size of the header and index */
+inline int64_t indexBytes(const Header& h)
+{
+  return sizeof(Header) + (h.nparts + h.nfields)*NAME_LENGTH +
+         (h.nblocks+1)*sizeof(Block) + h.nranges*sizeof(Range) +
+         (SECTION_FIELDS + h.nfields)*sizeof(int64_t) +
+         h.nfields*h.nblocks*sizeof(Chunk);
+}
+
+} // namespace KBI
+
+} // namespace VisKombyne
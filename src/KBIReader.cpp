@@ -0,0 +1,235 @@
+/*
+ *  Notices:
+ *  Copyright 2023 United States Government as represented by the
+ *  Administrator of the National Aeronautics and Space Administration.
+ *  No copyright is claimed in the United States under Title 17,
+ *  U.S. Code. All Other Rights Reserved.
+ *
+ *  Disclaimers No Warranty: THE SUBJECT SOFTWARE IS PROVIDED "AS
+ *  IS" WITHOUT ANY WARRANTY OF ANY KIND, EITHER EXPRESSED, IMPLIED,
+ *  OR STATUTORY, INCLUDING, BUT NOT LIMITED TO, ANY WARRANTY THAT
+ *  THE SUBJECT SOFTWARE WILL CONFORM TO SPECIFICATIONS, ANY IMPLIED
+ *  WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE,
+ *  OR FREEDOM FROM INFRINGEMENT, ANY WARRANTY THAT THE SUBJECT
+ *  SOFTWARE WILL BE ERROR FREE, OR ANY WARRANTY THAT DOCUMENTATION,
+ *  IF PROVIDED, WILL CONFORM TO THE SUBJECT SOFTWARE. THIS AGREEMENT
+ *  DOES NOT, IN ANY MANNER, CONSTITUTE AN ENDORSEMENT BY GOVERNMENT
+ *  AGENCY OR ANY PRIOR RECIPIENT OF ANY RESULTS, RESULTING DESIGNS,
+ *  HARDWARE, SOFTWARE PRODUCTS OR ANY OTHER APPLICATIONS RESULTING
+ *  FROM USE OF THE SUBJECT SOFTWARE.  FURTHER, GOVERNMENT AGENCY
+ *  DISCLAIMS ALL WARRANTIES AND LIABILITIES REGARDING THIRD-PARTY
+ *  SOFTWARE, IF PRESENT IN THE ORIGINAL SOFTWARE, AND DISTRIBUTES
+ *  IT "AS IS." 
+ *
+ *  Waiver and Indemnity:  RECIPIENT AGREES TO WAIVE ANY AND ALL
+ *  CLAIMS AGAINST THE UNITED STATES GOVERNMENT, ITS CONTRACTORS
+ *  AND SUBCONTRACTORS, AS WELL AS ANY PRIOR RECIPIENT.  IF RECIPIENT'S
+ *  USE OF THE SUBJECT SOFTWARE RESULTS IN ANY LIABILITIES, DEMANDS,
+ *  DAMAGES, EXPENSES OR LOSSES ARISING FROM SUCH USE, INCLUDING
+ *  ANY DAMAGES FROM PRODUCTS BASED ON, OR RESULTING FROM, RECIPIENT'S
+ *  USE OF THE SUBJECT SOFTWARE, RECIPIENT SHALL INDEMNIFY AND HOLD
+ *  HARMLESS THE UNITED STATES GOVERNMENT, ITS CONTRACTORS AND
+ *  SUBCONTRACTORS, AS WELL AS ANY PRIOR RECIPIENT, TO THE EXTENT
+ *  PERMITTED BY LAW.  RECIPIENT'S SOLE REMEDY FOR ANY SUCH MATTER
+ *  SHALL BE THE IMMEDIATE, UNILATERAL TERMINATION OF THIS AGREEMENT.
+ */
+
+#ifdef __GNUG__
+  #pragma implementation "KBIReader.h"
+#endif
+
+#include <exception>
+#include <stdexcept>
+#include <cstring>
+#include <string>
+#include <algorithm>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "KBIReader.h"
+#include "Codec.h"
+
+using namespace VisKombyne;
+
+KBIReader::KBIReader(const std::string& filename) :
+  m_data(NULL), m_size(0), m_header(NULL), m_blocks(NULL), m_ranges(NULL),
+  m_sections(NULL), m_chunks(NULL)
+{
+  int fd = open(filename.c_str(), O_RDONLY);
+  if( fd < 0 )
+    throw std::runtime_error("Could not open kbi file: " + filename);
+
+  struct stat st;
+  if( 0 != fstat(fd, &st) || st.st_size < (off_t)sizeof(KBI::Header) ) {
+    close(fd);
+    throw std::runtime_error("Not a kbi file: " + filename);
+  }
+
+  m_size = st.st_size;
+  void* p = mmap(NULL, m_size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if( MAP_FAILED == p )
+    throw std::runtime_error("Could not map kbi file: " + filename);
+  m_data = (char*)p;
+
+  m_header = (const KBI::Header*)m_data;
+  if( 0 != memcmp(m_header->magic, KBI::MAGIC, sizeof(KBI::MAGIC)) ||
+      KBI::VERSION != m_header->version ||
+      KBI::ENDIAN != m_header->endian ||
+      (size_t)KBI::indexBytes(*m_header) > m_size ) {
+    munmap(m_data, m_size);
+    throw std::runtime_error("Unsupported kbi file: " + filename);
+  }
+
+  const char* names = m_data + sizeof(KBI::Header);
+  for( int64_t i=0; i<m_header->nparts+m_header->nfields; ++i ) {
+    const char* name = names + i*KBI::NAME_LENGTH;
+    std::string s(name, strnlen(name, KBI::NAME_LENGTH));
+    if( i < m_header->nparts )
+      m_parts.push_back(s);
+    else
+      m_fields.push_back(s);
+  }
+
+  const char* at = names + (m_header->nparts+m_header->nfields)*KBI::NAME_LENGTH;
+  m_blocks = (const KBI::Block*)at;
+  at += (m_header->nblocks+1)*sizeof(KBI::Block);
+  m_ranges = (const KBI::Range*)at;
+  at += m_header->nranges*sizeof(KBI::Range);
+  m_sections = (const int64_t*)at;
+  at += (KBI::SECTION_FIELDS+m_header->nfields)*sizeof(int64_t);
+  m_chunks = (const KBI::Chunk*)at;
+}
+
+KBIReader::~KBIReader()
+{
+  munmap(m_data, m_size);
+}
+
+int64_t KBIReader::field(const std::string& name) const
+{
+  std::vector<std::string>::const_iterator it;
+  it = std::find(m_fields.begin(), m_fields.end(), name);
+  return (it == m_fields.end()) ? -1 : it - m_fields.begin();
+}
+
+int64_t KBIReader::part(const std::string& name) const
+{
+  std::vector<std::string>::const_iterator it;
+  it = std::find(m_parts.begin(), m_parts.end(), name);
+  return (it == m_parts.end()) ? -1 : it - m_parts.begin();
+}
+
+KBIReader::View<double> KBIReader::x(int64_t block) const
+{
+  return points(KBI::SECTION_X, block);
+}
+
+KBIReader::View<double> KBIReader::y(int64_t block) const
+{
+  return points(KBI::SECTION_Y, block);
+}
+
+KBIReader::View<double> KBIReader::z(int64_t block) const
+{
+  return points(KBI::SECTION_Z, block);
+}
+
+KBIReader::View<double> KBIReader::field(int64_t index, int64_t block) const
+{
+  if( index < 0 || index >= m_header->nfields )
+    throw std::runtime_error("Bad kbi field index");
+
+  int64_t begin = (block < 0) ? 0 : block;
+  int64_t end = (block < 0) ? m_header->nblocks : block+1;
+  for( int64_t b=begin; b<end; ++b )
+    if( KBI::CODEC_RAW != chunk(index, b).codec )
+      throw std::runtime_error("Compressed kbi field has no view: " +
+                               m_fields[index]);
+
+  return points(KBI::SECTION_FIELDS+index, block);
+}
+
+void KBIReader::read(int64_t index, int64_t block,
+                     std::vector<double>& values) const
+{
+  if( index < 0 || index >= m_header->nfields ||
+      block < 0 || block >= m_header->nblocks )
+    throw std::runtime_error("Bad kbi field block");
+
+  const KBI::Chunk& c = chunk(index, block);
+  int64_t n = m_blocks[block+1].point - m_blocks[block].point;
+  const char* data = m_data + c.offset;
+  if( (size_t)(c.offset + c.bytes) > m_size )
+    throw std::runtime_error("Truncated kbi file");
+
+  if( KBI::CODEC_RAW == c.codec ) {
+    values.resize(n);
+    memcpy(values.data(), data, n*sizeof(double));
+    return;
+  }
+
+  if( KBI::CODEC_PREDICTIVE == c.codec ) {
+    std::vector<int64_t> q(n);
+    Codec::decode(data, c.bytes, n, q.data());
+    Codec::unpredict(q.data(), n);
+    values.resize(n);
+    for( int64_t i=0; i<n; ++i )
+      values[i] = (double)q[i]*c.step;
+    return;
+  }
+
+  if( KBI::CODEC_DELTA != c.codec )
+    throw std::runtime_error("Unsupported kbi field encoding");
+  if( (int64_t)values.size() != n )
+    throw std::runtime_error("Delta kbi field without previous values");
+
+  std::vector<int64_t> q(n), delta(n);
+  if( !Codec::quantize(values.data(), n, c.step, q.data()) )
+    throw std::runtime_error("Bad previous values of a delta kbi field");
+  Codec::decode(data, c.bytes, n, delta.data());
+  for( int64_t i=0; i<n; ++i )
+    values[i] = (double)(q[i] + delta[i])*c.step;
+}
+
+KBIReader::View<int32_t> KBIReader::connectivity(int64_t block) const
+{
+  if( block >= m_header->nblocks )
+    throw std::runtime_error("Bad kbi block");
+
+  int64_t begin = (block < 0) ? 0 : m_blocks[block].conn;
+  int64_t end = (block < 0) ? m_header->nconn : m_blocks[block+1].conn;
+  const int32_t* conn = (const int32_t*)section(KBI::SECTION_CONNECTIVITY);
+  View<int32_t> v = { conn+begin, end-begin };
+  return v;
+}
+
+std::vector<KBIReader::View<int32_t> >
+KBIReader::connectivity(const std::string& name) const
+{
+  std::vector<View<int32_t> > views;
+
+  int64_t p = part(name);
+  const int32_t* conn = (const int32_t*)section(KBI::SECTION_CONNECTIVITY);
+  for( int64_t r=0; r<m_header->nranges; ++r ) {
+    if( p == m_ranges[r].part ) {
+      View<int32_t> v = { conn+m_ranges[r].conn_begin,
+                          m_ranges[r].conn_end-m_ranges[r].conn_begin };
+      views.push_back(v);
+    }
+  }
+  return views;
+}
+
+KBIReader::View<double> KBIReader::points(int64_t s, int64_t block) const
+{
+  if( block >= m_header->nblocks )
+    throw std::runtime_error("Bad kbi block");
+
+  int64_t begin = (block < 0) ? 0 : m_blocks[block].point;
+  int64_t end = (block < 0) ? m_header->npoints : m_blocks[block+1].point;
+  View<double> v = { (const double*)section(s)+begin, end-begin };
+  return v;
+}
@@ -0,0 +1,141 @@
+#pragma once
+
+/*
+ *  Notices:
+ *  Copyright 2023 United States Government as represented by the
+ *  Administrator of the National Aeronautics and Space Administration.
+ *  No copyright is claimed in the United States under Title 17,
+ *  U.S. Code. All Other Rights Reserved.
+ *
+ *  Disclaimers No Warranty: THE SUBJECT SOFTWARE IS PROVIDED "AS
+ *  IS" WITHOUT ANY WARRANTY OF ANY KIND, EITHER EXPRESSED, IMPLIED,
+ *  OR STATUTORY, INCLUDING, BUT NOT LIMITED TO, ANY WARRANTY THAT
+ *  THE SUBJECT SOFTWARE WILL CONFORM TO SPECIFICATIONS, ANY IMPLIED
+ *  WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE,
+ *  OR FREEDOM FROM INFRINGEMENT, ANY WARRANTY THAT THE SUBJECT
+ *  SOFTWARE WILL BE ERROR FREE, OR ANY WARRANTY THAT DOCUMENTATION,
+ *  IF PROVIDED, WILL CONFORM TO THE SUBJECT SOFTWARE. THIS AGREEMENT
+ *  DOES NOT, IN ANY MANNER, CONSTITUTE AN ENDORSEMENT BY GOVERNMENT
+ *  AGENCY OR ANY PRIOR RECIPIENT OF ANY RESULTS, RESULTING DESIGNS,
+ *  HARDWARE, SOFTWARE PRODUCTS OR ANY OTHER APPLICATIONS RESULTING
+ *  FROM USE OF THE SUBJECT SOFTWARE.  FURTHER, GOVERNMENT AGENCY
+ *  DISCLAIMS ALL WARRANTIES AND LIABILITIES REGARDING THIRD-PARTY
+ *  SOFTWARE, IF PRESENT IN THE ORIGINAL SOFTWARE, AND DISTRIBUTES
+ *  IT "AS IS." 
+ *
+ *  Waiver and Indemnity:  RECIPIENT AGREES TO WAIVE ANY AND ALL
+ *  CLAIMS AGAINST THE UNITED STATES GOVERNMENT, ITS CONTRACTORS
+ *  AND SUBCONTRACTORS, AS WELL AS ANY PRIOR RECIPIENT.  IF RECIPIENT'S
+ *  USE OF THE SUBJECT SOFTWARE RESULTS IN ANY LIABILITIES, DEMANDS,
+ *  DAMAGES, EXPENSES OR LOSSES ARISING FROM SUCH USE, INCLUDING
+ *  ANY DAMAGES FROM PRODUCTS BASED ON, OR RESULTING FROM, RECIPIENT'S
+ *  USE OF THE SUBJECT SOFTWARE, RECIPIENT SHALL INDEMNIFY AND HOLD
+ *  HARMLESS THE UNITED STATES GOVERNMENT, ITS CONTRACTORS AND
+ *  SUBCONTRACTORS, AS WELL AS ANY PRIOR RECIPIENT, TO THE EXTENT
+ *  PERMITTED BY LAW.  RECIPIENT'S SOLE REMEDY FOR ANY SUCH MATTER
+ *  SHALL BE THE IMMEDIATE, UNILATERAL TERMINATION OF THIS AGREEMENT.
+ */
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include "KBIFormat.h"
+
+namespace VisKombyne
+{
+
+/**
+ * Memory-mapped reader of Kombyne indexed binary (kbi) files.
+ *
+ * The arrays are returned as views into the mapping, nothing is read until
+ * the view is accessed, so reading one field or one block of a file only
+ * touches the pages holding it.  The views are valid for the lifetime of
+ * the reader.  Compressed field blocks have no view and are decoded with
+ * read().
+ */
+class KBIReader
+{
+  public:
+    template <typename T>
+    struct View
+    {
+      const T* data;
+      int64_t size;
+
+      inline const T& operator[](int64_t i) const { return data[i]; }
+      inline const T* begin() const { return data; }
+      inline const T* end() const { return data+size; }
+    };
+
+    /**
+     * Map a kbi file.
+     *
+     * @param filename  File name
+     */
+    KBIReader(const std::string& filename);
+    ~KBIReader();
+
+    inline int64_t nBlocks() const { return m_header->nblocks; }
+    inline int64_t nPoints() const { return m_header->npoints; }
+    inline int64_t nCells() const { return m_header->ncells; }
+    inline const std::vector<std::string>& partNames() const
+      { return m_parts; }
+    inline const std::vector<std::string>& fieldNames() const
+      { return m_fields; }
+
+    /** Index of a field or part by name, -1 if absent */
+    int64_t field(const std::string& name) const;
+    int64_t part(const std::string& name) const;
+
+    /**
+     * Coordinates and nodal fields of a block, or of the whole file for a
+     * block of -1.
+     */
+    View<double> x(int64_t block=-1) const;
+    View<double> y(int64_t block=-1) const;
+    View<double> z(int64_t block=-1) const;
+    View<double> field(int64_t index, int64_t block=-1) const;
+
+    /**
+     * Decode a field block.  For a CODEC_DELTA block the values must hold
+     * the same block of the previous output on entry.
+     */
+    void read(int64_t index, int64_t block, std::vector<double>& values) const;
+
+    inline const KBI::Chunk& chunk(int64_t index, int64_t block) const
+      { return m_chunks[index*m_header->nblocks + block]; }
+
+    /**
+     * Interleaved connectivity (cell type followed by the file-global point
+     * ids of the cell) of a block, or of the whole file for a block of -1.
+     */
+    View<int32_t> connectivity(int64_t block=-1) const;
+
+    /**
+     * Connectivity ranges of a part, one per block holding it.
+     */
+    std::vector<View<int32_t> > connectivity(const std::string& part) const;
+
+    /** Part ranges, sorted by part and block */
+    inline View<KBI::Range> ranges() const
+      { View<KBI::Range> v = { m_ranges, m_header->nranges }; return v; }
+
+  private:
+    inline View<double> points(int64_t section, int64_t block) const;
+    inline const char* section(int64_t s) const
+      { return m_data + m_sections[s]; }
+
+  private:
+    char* m_data;
+    size_t m_size;
+    const KBI::Header* m_header;
+    const KBI::Block* m_blocks;
+    const KBI::Range* m_ranges;
+    const int64_t* m_sections;
+    const KBI::Chunk* m_chunks;
+    std::vector<std::string> m_parts;
+    std::vector<std::string> m_fields;
+};
+
+} // namespace VisKombyne
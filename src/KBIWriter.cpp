@@ -0,0 +1,502 @@
+/*
+ *  Notices:
+ *  Copyright 2023 United States Government as represented by the
+ *  Administrator of the National Aeronautics and Space Administration.
+ *  No copyright is claimed in the United States under Title 17,
+ *  U.S. Code. All Other Rights Reserved.
+ *
+ *  Disclaimers No Warranty: THE SUBJECT SOFTWARE IS PROVIDED "AS
+ *  IS" WITHOUT ANY WARRANTY OF ANY KIND, EITHER EXPRESSED, IMPLIED,
+ *  OR STATUTORY, INCLUDING, BUT NOT LIMITED TO, ANY WARRANTY THAT
+ *  THE SUBJECT SOFTWARE WILL CONFORM TO SPECIFICATIONS, ANY IMPLIED
+ *  WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE,
+ *  OR FREEDOM FROM INFRINGEMENT, ANY WARRANTY THAT THE SUBJECT
+ *  SOFTWARE WILL BE ERROR FREE, OR ANY WARRANTY THAT DOCUMENTATION,
+ *  IF PROVIDED, WILL CONFORM TO THE SUBJECT SOFTWARE. THIS AGREEMENT
+ *  DOES NOT, IN ANY MANNER, CONSTITUTE AN ENDORSEMENT BY GOVERNMENT
+ *  AGENCY OR ANY PRIOR RECIPIENT OF ANY RESULTS, RESULTING DESIGNS,
+ *  HARDWARE, SOFTWARE PRODUCTS OR ANY OTHER APPLICATIONS RESULTING
+ *  FROM USE OF THE SUBJECT SOFTWARE.  FURTHER, GOVERNMENT AGENCY
+ *  DISCLAIMS ALL WARRANTIES AND LIABILITIES REGARDING THIRD-PARTY
+ *  SOFTWARE, IF PRESENT IN THE ORIGINAL SOFTWARE, AND DISTRIBUTES
+ *  IT "AS IS." 
+ *
+ *  Waiver and Indemnity:  RECIPIENT AGREES TO WAIVE ANY AND ALL
+ *  CLAIMS AGAINST THE UNITED STATES GOVERNMENT, ITS CONTRACTORS
+ *  AND SUBCONTRACTORS, AS WELL AS ANY PRIOR RECIPIENT.  IF RECIPIENT'S
+ *  USE OF THE SUBJECT SOFTWARE RESULTS IN ANY LIABILITIES, DEMANDS,
+ *  DAMAGES, EXPENSES OR LOSSES ARISING FROM SUCH USE, INCLUDING
+ *  ANY DAMAGES FROM PRODUCTS BASED ON, OR RESULTING FROM, RECIPIENT'S
+ *  USE OF THE SUBJECT SOFTWARE, RECIPIENT SHALL INDEMNIFY AND HOLD
+ *  HARMLESS THE UNITED STATES GOVERNMENT, ITS CONTRACTORS AND
+ *  SUBCONTRACTORS, AS WELL AS ANY PRIOR RECIPIENT, TO THE EXTENT
+ *  PERMITTED BY LAW.  RECIPIENT'S SOLE REMEDY FOR ANY SUCH MATTER
+ *  SHALL BE THE IMMEDIATE, UNILATERAL TERMINATION OF THIS AGREEMENT.
+ */
+
+#ifdef __GNUG__
+  #pragma implementation "KBIWriter.h"
+#endif
+
+#include <exception>
+#include <stdexcept>
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <cfloat>
+#include <iostream>
+#include <string>
+#include <sstream>
+#include <algorithm>
+
+#include "KBIWriter.h"
+#include "Codec.h"
+#include "tinf_iris.h"
+#include "TinfCheck.h"
+
+using namespace VisKombyne;
+
+template <typename T>
+static inline void put(std::vector<char>& buf, const T* data, size_t n)
+{
+  const char* c = (const char*)data;
+  buf.insert(buf.end(), c, c+n*sizeof(T));
+}
+
+static inline void putName(std::vector<char>& buf, const std::string& name)
+{
+  char s[KBI::NAME_LENGTH];
+  memset(s, 0, sizeof(s));
+  strncpy(s, name.c_str(), sizeof(s)-1);
+  buf.insert(buf.end(), s, s+sizeof(s));
+}
+
+
+static inline std::string option(const WriterOptions& options,
+                                 const std::string& key,
+                                 const std::string& value)
+{
+  WriterOptions::const_iterator it = options.find(key);
+  return (it == options.end()) ? value : it->second;
+}
+
+
+KBIWriter::KBIWriter(void* comm, const WriterOptions& options) :
+  m_comm(comm), m_compression(COMPRESSION_NONE), m_keyframe(10),
+  m_outputs(0)
+{
+  int32_t error;
+
+  std::string compression = option(options, "compression", "none");
+  if( "lossy" == compression )
+    m_compression = COMPRESSION_LOSSY;
+  else if( "delta" == compression )
+    m_compression = COMPRESSION_DELTA;
+  else if( "none" != compression )
+    throw std::runtime_error("Unknown kbi compression: " + compression);
+
+  m_keyframe = atoi(option(options, "keyframe", "10").c_str());
+  if( m_keyframe < 1 )
+    throw std::runtime_error("Bad kbi keyframe interval");
+
+  m_tolerance = parseTolerance(option(options, "tolerance", "0"));
+  WriterOptions::const_iterator it;
+  for( it = options.begin(); it != options.end(); ++it )
+    if( 0 == it->first.compare(0, 10, "tolerance.") )
+      m_tolerances[it->first.substr(10)] = parseTolerance(it->second);
+
+  m_mpi_comm = MPI_Comm_f2c(tinf_iris_get_mpi_fcomm(m_comm, &error));
+  TINF_CHECK_SUCCESS(error, "Could not get writer communicator");
+  m_rank = tinf_iris_rank(m_comm, &error);
+  TINF_CHECK_SUCCESS(error, "Could not get writer rank");
+  m_nprocs = tinf_iris_number_of_processes(m_comm, &error);
+  TINF_CHECK_SUCCESS(error, "Could not get number of writers");
+}
+
+void KBIWriter::write(const std::string& filename, const Extract& piece)
+{
+  int32_t error;
+
+  std::vector<std::string> parts = partNames(piece);
+
+  /* File-global ranges of the non-empty local parts */
+  const std::vector<std::string>& pnames = piece.partNames();
+  const std::vector<int64_t>& pcells = piece.partCells();
+  const std::vector<int64_t>& pconn = piece.partConnectivity();
+  std::vector<KBI::Range> ranges;
+  for( size_t p=0; p<pnames.size(); ++p ) {
+    KBI::Range r;
+    r.part = std::find(parts.begin(), parts.end(), pnames[p]) - parts.begin();
+    r.block = m_rank;
+    r.cell_begin = pcells[p];
+    r.cell_end = (p+1 < pnames.size()) ? pcells[p+1] : piece.nCells();
+    r.conn_begin = pconn[p];
+    r.conn_end = (p+1 < pnames.size()) ? pconn[p+1]
+                                       : piece.connectivity().size();
+    if( r.cell_end > r.cell_begin )
+      ranges.push_back(r);
+  }
+
+  const std::vector<std::string>& names = piece.fieldNames();
+  const std::vector<std::vector<double> >& values = piece.fieldValues();
+  size_t nfields = names.size();
+
+  /* Encoded field blocks, raw fields are written from the piece */
+  std::vector<double> step = steps(piece);
+  std::vector<KBI::Chunk> chunks(nfields);
+  std::vector<std::vector<char> > encoded(nfields);
+  for( size_t f=0; f<nfields; ++f )
+    encodeField(f, values[f], step[f], chunks[f], encoded[f]);
+  ++m_outputs;
+
+  /* Block sizes: points, cells, connectivity, part ranges and field bytes */
+  int64_t nsizes = 4 + nfields;
+  std::vector<int64_t> local(nsizes), offset(nsizes, 0), total(nsizes, 0);
+  local[0] = piece.nPoints();
+  local[1] = piece.nCells();
+  local[2] = piece.connectivity().size();
+  local[3] = ranges.size();
+  for( size_t f=0; f<nfields; ++f )
+    local[4+f] = chunks[f].bytes;
+
+  MPI_Exscan(local.data(), offset.data(), nsizes, MPI_INT64_T, MPI_SUM,
+             m_mpi_comm);
+  if( 0 == m_rank )
+    std::fill(offset.begin(), offset.end(), 0);
+  MPI_Allreduce(local.data(), total.data(), nsizes, MPI_INT64_T, MPI_SUM,
+                m_mpi_comm);
+
+  std::vector<KBI::Range>::iterator r;
+  for( r = ranges.begin(); r != ranges.end(); ++r ) {
+    r->cell_begin += offset[1];
+    r->cell_end += offset[1];
+    r->conn_begin += offset[2];
+    r->conn_end += offset[2];
+  }
+
+  KBI::Header header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, KBI::MAGIC, sizeof(header.magic));
+  header.version = KBI::VERSION;
+  header.endian = KBI::ENDIAN;
+  header.nblocks = m_nprocs;
+  header.nparts = parts.size();
+  header.nfields = names.size();
+  header.nranges = total[3];
+  header.npoints = total[0];
+  header.ncells = total[1];
+  header.nconn = total[2];
+
+  /* Array layout */
+  int64_t nsections = KBI::SECTION_FIELDS + nfields;
+  std::vector<int64_t> sections(nsections);
+  int64_t at = KBI::align(KBI::indexBytes(header));
+  for( int64_t s=0; s<nsections; ++s ) {
+    sections[s] = at;
+    int64_t bytes = total[0]*sizeof(double);
+    if( KBI::SECTION_CONNECTIVITY == s )
+      bytes = total[2]*sizeof(int32_t);
+    else if( s >= KBI::SECTION_FIELDS )
+      bytes = total[4+s-KBI::SECTION_FIELDS];
+    at = KBI::align(at + bytes);
+  }
+
+  for( size_t f=0; f<nfields; ++f )
+    chunks[f].offset = sections[KBI::SECTION_FIELDS+f] + offset[4+f];
+
+  /* Index on rank 0 */
+  std::vector<KBI::Block> blocks(0 == m_rank ? m_nprocs+1 : 0);
+  MPI_Gather(local.data(), 3, MPI_INT64_T, blocks.data(), 3, MPI_INT64_T, 0,
+             m_mpi_comm);
+
+  std::vector<KBI::Chunk> all_chunks(0 == m_rank ? m_nprocs*nfields : 0);
+  MPI_Gather(chunks.data(), nfields*sizeof(KBI::Chunk), MPI_BYTE,
+             all_chunks.data(), nfields*sizeof(KBI::Chunk), MPI_BYTE, 0,
+             m_mpi_comm);
+
+  int32_t nbytes = ranges.size()*sizeof(KBI::Range);
+  std::vector<int32_t> counts(0 == m_rank ? m_nprocs : 0);
+  MPI_Gather(&nbytes, 1, MPI_INT32_T, counts.data(), 1, MPI_INT32_T, 0,
+             m_mpi_comm);
+  std::vector<int32_t> displs(counts.size(), 0);
+  for( size_t i=1; i<counts.size(); ++i )
+    displs[i] = displs[i-1] + counts[i-1];
+  std::vector<KBI::Range> all(0 == m_rank ? total[3] : 0);
+  MPI_Gatherv(ranges.data(), nbytes, MPI_BYTE, all.data(), counts.data(),
+              displs.data(), MPI_BYTE, 0, m_mpi_comm);
+
+  std::vector<char> index;
+  if( 0 == m_rank ) {
+    /* Block sizes to prefix offsets */
+    KBI::Block sum = { 0, 0, 0 };
+    for( int32_t b=0; b<=m_nprocs; ++b ) {
+      KBI::Block size = blocks[b];
+      blocks[b] = sum;
+      sum.point += size.point;
+      sum.cell += size.cell;
+      sum.conn += size.conn;
+    }
+
+    /* Ranges sorted by part, then block */
+    std::stable_sort(all.begin(), all.end(),
+                     [](const KBI::Range& a, const KBI::Range& b)
+                     { return a.part < b.part; });
+
+    index.reserve(sections[0]);
+    put(index, &header, 1);
+    std::vector<std::string>::const_iterator it;
+    for( it = parts.begin(); it != parts.end(); ++it )
+      putName(index, *it);
+    for( it = names.begin(); it != names.end(); ++it )
+      putName(index, *it);
+    put(index, blocks.data(), blocks.size());
+    put(index, all.data(), all.size());
+    put(index, sections.data(), sections.size());
+    for( size_t f=0; f<nfields; ++f )
+      for( int32_t b=0; b<m_nprocs; ++b )
+        put(index, &all_chunks[b*nfields+f], 1);
+  }
+
+  if( 0 == m_rank )
+    std::remove(filename.c_str());
+  tinf_iris_barrier(m_comm);
+
+  int32_t fd;
+  error = tinf_iris_file_open(m_comm, filename.c_str(), filename.size(),
+                              MPI_MODE_CREATE|MPI_MODE_WRONLY, NULL, &fd);
+  TINF_CHECK_SUCCESS(error, "Could not open kbi file");
+
+  writeAt(fd, 0, index.data(), index.size());
+
+  /* The arrays are written as they are, only the connectivity is shifted to
+   * file-global point ids */
+  const double* xyz[3] = { piece.x().data(), piece.y().data(),
+                           piece.z().data() };
+  for( int32_t d=0; d<3; ++d )
+    writeAt(fd, sections[d] + offset[0]*sizeof(double), xyz[d],
+            local[0]*sizeof(double));
+
+  std::vector<int32_t> conn(piece.connectivity());
+  for( size_t i=0; i<conn.size(); ) {
+    int32_t n = Extract::nodesPerCell(conn[i++]);
+    for( int32_t j=0; j<n; ++j )
+      conn[i++] += (int32_t)offset[0];
+  }
+  writeAt(fd, sections[KBI::SECTION_CONNECTIVITY] + offset[2]*sizeof(int32_t),
+          conn.data(), conn.size()*sizeof(int32_t));
+
+  for( size_t f=0; f<nfields; ++f ) {
+    if( KBI::CODEC_RAW == chunks[f].codec )
+      writeAt(fd, chunks[f].offset, values[f].data(), chunks[f].bytes);
+    else
+      writeAt(fd, chunks[f].offset, encoded[f].data(), chunks[f].bytes);
+  }
+
+  error = tinf_iris_file_close(m_comm, fd);
+  TINF_CHECK_SUCCESS(error, "Could not close kbi file");
+
+  if( COMPRESSION_NONE != m_compression )
+    report(filename, piece, chunks);
+}
+
+KBIWriter::Tolerance KBIWriter::parseTolerance(const std::string& s)
+{
+  Tolerance t = { 0.0, false };
+  std::string value = s;
+  if( 0 == s.compare(0, 4, "rel:") ) {
+    t.relative = true;
+    value = s.substr(4);
+  } else if( 0 == s.compare(0, 4, "abs:") ) {
+    value = s.substr(4);
+  }
+  t.value = atof(value.c_str());
+  if( t.value < 0.0 )
+    throw std::runtime_error("Bad kbi tolerance: " + s);
+  return t;
+}
+
+/*
+ * Quantization steps of the fields (twice the absolute error bound, 0 for
+ * raw fields), relative tolerances use the global range of the field.
+ */
+std::vector<double> KBIWriter::steps(const Extract& piece)
+{
+  const std::vector<std::string>& names = piece.fieldNames();
+  const std::vector<std::vector<double> >& values = piece.fieldValues();
+  size_t nfields = names.size();
+
+  std::vector<Tolerance> tolerance(nfields, m_tolerance);
+  bool relative = false;
+  for( size_t f=0; f<nfields; ++f ) {
+    std::map<std::string, Tolerance>::const_iterator it;
+    it = m_tolerances.find(names[f]);
+    if( it != m_tolerances.end() )
+      tolerance[f] = it->second;
+    relative |= tolerance[f].relative;
+  }
+
+  std::vector<double> step(nfields, 0.0);
+  if( COMPRESSION_NONE == m_compression )
+    return step;
+
+  /* Ranges as maxima of (-min, max) */
+  std::vector<double> range(2*nfields, -DBL_MAX);
+  if( relative ) {
+    for( size_t f=0; f<nfields; ++f ) {
+      const std::vector<double>& v = values[f];
+      for( size_t i=0; i<v.size(); ++i ) {
+        range[2*f] = std::max(range[2*f], -v[i]);
+        range[2*f+1] = std::max(range[2*f+1], v[i]);
+      }
+    }
+    MPI_Allreduce(MPI_IN_PLACE, range.data(), 2*nfields, MPI_DOUBLE, MPI_MAX,
+                  m_mpi_comm);
+  }
+
+  for( size_t f=0; f<nfields; ++f ) {
+    double bound = tolerance[f].value;
+    if( tolerance[f].relative )
+      bound *= std::max(0.0, range[2*f] + range[2*f+1]);
+    step[f] = 2.0*bound;
+  }
+  return step;
+}
+
+/*
+ * Encode a field block: raw, the quantized values predicted along the node
+ * order (lossy compression and delta keyframes) or the quantized change
+ * since the previous output.
+ */
+void KBIWriter::encodeField(size_t f, const std::vector<double>& values,
+                            double step, KBI::Chunk& chunk,
+                            std::vector<char>& data)
+{
+  int64_t n = values.size();
+
+  memset(&chunk, 0, sizeof(chunk));
+  chunk.codec = KBI::CODEC_RAW;
+  chunk.bytes = n*sizeof(double);
+
+  if( m_previous.size() <= f ) {
+    m_previous.resize(f+1);
+    m_steps.resize(f+1, 0.0);
+  }
+  std::vector<int64_t>& previous = m_previous[f];
+
+  /* A delta series keeps the step of its keyframe */
+  bool delta = COMPRESSION_DELTA == m_compression &&
+               0 != m_outputs%m_keyframe &&
+               (int64_t)previous.size() == n && m_steps[f] > 0.0;
+  if( delta )
+    step = m_steps[f];
+
+  if( step <= 0.0 ) {
+    previous.clear();
+    return;
+  }
+
+  std::vector<int64_t> q(n), residuals(n);
+  if( !Codec::quantize(values.data(), n, step, q.data()) ) {
+    /* Out of range values are stored raw, the next output is a keyframe */
+    previous.clear();
+    return;
+  }
+
+  if( delta ) {
+    for( int64_t i=0; i<n; ++i )
+      residuals[i] = q[i] - previous[i];
+    chunk.codec = KBI::CODEC_DELTA;
+  } else {
+    Codec::predict(q.data(), n, residuals.data());
+    chunk.codec = KBI::CODEC_PREDICTIVE;
+  }
+
+  Codec::encode(residuals.data(), n, data);
+  chunk.bytes = data.size();
+  chunk.step = step;
+  chunk.max_error = Codec::maxError(values.data(), q.data(), n, step);
+
+  if( COMPRESSION_DELTA == m_compression ) {
+    previous.swap(q);
+    m_steps[f] = step;
+  }
+}
+
+/*
+ * Log the compression ratio and the largest error of each field.
+ */
+void KBIWriter::report(const std::string& filename, const Extract& piece,
+                       const std::vector<KBI::Chunk>& chunks)
+{
+  size_t nfields = chunks.size();
+
+  std::vector<double> local(nfields+2, 0.0), global(nfields+2, 0.0);
+  for( size_t f=0; f<nfields; ++f ) {
+    local[f] = chunks[f].max_error;
+    local[nfields] += piece.nPoints()*sizeof(double);
+    local[nfields+1] += chunks[f].bytes;
+  }
+
+  MPI_Reduce(local.data(), global.data(), nfields, MPI_DOUBLE, MPI_MAX, 0,
+             m_mpi_comm);
+  MPI_Reduce(local.data()+nfields, global.data()+nfields, 2, MPI_DOUBLE,
+             MPI_SUM, 0, m_mpi_comm);
+
+  if( 0 == m_rank ) {
+    const std::vector<std::string>& names = piece.fieldNames();
+    double ratio = (global[nfields+1] > 0.0) ?
+                   global[nfields]/global[nfields+1] : 1.0;
+    std::cerr << "kbi compression: " << filename << ", ratio=" << ratio
+              << ", max error:";
+    for( size_t f=0; f<nfields; ++f )
+      std::cerr << " " << names[f] << "=" << global[f];
+    std::cerr << std::endl;
+  }
+}
+
+/*
+ * Names of the parts of all ranks, in order of first appearance by rank.
+ */
+std::vector<std::string> KBIWriter::partNames(const Extract& piece)
+{
+  std::string local;
+  const std::vector<std::string>& pnames = piece.partNames();
+  for( size_t p=0; p<pnames.size(); ++p )
+    if( std::find(pnames.begin(), pnames.begin()+p, pnames[p]) ==
+        pnames.begin()+p )
+      local += pnames[p] + '\0';
+
+  int32_t length = local.size();
+  std::vector<int32_t> lengths(m_nprocs);
+  MPI_Allgather(&length, 1, MPI_INT32_T, lengths.data(), 1, MPI_INT32_T,
+                m_mpi_comm);
+  std::vector<int32_t> displs(m_nprocs, 0);
+  for( int32_t i=1; i<m_nprocs; ++i )
+    displs[i] = displs[i-1] + lengths[i-1];
+  std::vector<char> all(displs.back() + lengths.back() + 1);
+  MPI_Allgatherv(local.data(), length, MPI_CHAR, all.data(), lengths.data(),
+                 displs.data(), MPI_CHAR, m_mpi_comm);
+
+  std::vector<std::string> names;
+  for( size_t i=0; i+1<all.size(); ) {
+    std::string name(&all[i]);
+    if( std::find(names.begin(), names.end(), name) == names.end() )
+      names.push_back(name);
+    i += name.size()+1;
+  }
+  return names;
+}
+
+/*
+ * Collective write of raw bytes, the offset is in bytes from the start of
+ * the file.
+ */
+void KBIWriter::writeAt(int32_t fd, size_t offset, const void* data,
+                        size_t bytes)
+{
+  int32_t error;
+
+  error = tinf_iris_file_write_at_all(m_comm, TINF_CHAR, fd, offset,
+                                      const_cast<void*>(data), bytes);
+  TINF_CHECK_SUCCESS(error, "Could not write kbi file");
+}
@@ -0,0 +1,121 @@
+#pragma once
+
+/*
+ *  Notices:
+ *  Copyright 2023 United States Government as represented by the
+ *  Administrator of the National Aeronautics and Space Administration.
+ *  No copyright is claimed in the United States under Title 17,
+ *  U.S. Code. All Other Rights Reserved.
+ *
+ *  Disclaimers No Warranty: THE SUBJECT SOFTWARE IS PROVIDED "AS
+ *  IS" WITHOUT ANY WARRANTY OF ANY KIND, EITHER EXPRESSED, IMPLIED,
+ *  OR STATUTORY, INCLUDING, BUT NOT LIMITED TO, ANY WARRANTY THAT
+ *  THE SUBJECT SOFTWARE WILL CONFORM TO SPECIFICATIONS, ANY IMPLIED
+ *  WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE,
+ *  OR FREEDOM FROM INFRINGEMENT, ANY WARRANTY THAT THE SUBJECT
+ *  SOFTWARE WILL BE ERROR FREE, OR ANY WARRANTY THAT DOCUMENTATION,
+ *  IF PROVIDED, WILL CONFORM TO THE SUBJECT SOFTWARE. THIS AGREEMENT
+ *  DOES NOT, IN ANY MANNER, CONSTITUTE AN ENDORSEMENT BY GOVERNMENT
+ *  AGENCY OR ANY PRIOR RECIPIENT OF ANY RESULTS, RESULTING DESIGNS,
+ *  HARDWARE, SOFTWARE PRODUCTS OR ANY OTHER APPLICATIONS RESULTING
+ *  FROM USE OF THE SUBJECT SOFTWARE.  FURTHER, GOVERNMENT AGENCY
+ *  DISCLAIMS ALL WARRANTIES AND LIABILITIES REGARDING THIRD-PARTY
+ *  SOFTWARE, IF PRESENT IN THE ORIGINAL SOFTWARE, AND DISTRIBUTES
+ *  IT "AS IS." 
+ *
+ *  Waiver and Indemnity:  RECIPIENT AGREES TO WAIVE ANY AND ALL
+ *  CLAIMS AGAINST THE UNITED STATES GOVERNMENT, ITS CONTRACTORS
+ *  AND SUBCONTRACTORS, AS WELL AS ANY PRIOR RECIPIENT.  IF RECIPIENT'S
+ *  USE OF THE SUBJECT SOFTWARE RESULTS IN ANY LIABILITIES, DEMANDS,
+ *  DAMAGES, EXPENSES OR LOSSES ARISING FROM SUCH USE, INCLUDING
+ *  ANY DAMAGES FROM PRODUCTS BASED ON, OR RESULTING FROM, RECIPIENT'S
+ *  USE OF THE SUBJECT SOFTWARE, RECIPIENT SHALL INDEMNIFY AND HOLD
+ *  HARMLESS THE UNITED STATES GOVERNMENT, ITS CONTRACTORS AND
+ *  SUBCONTRACTORS, AS WELL AS ANY PRIOR RECIPIENT, TO THE EXTENT
+ *  PERMITTED BY LAW.  RECIPIENT'S SOLE REMEDY FOR ANY SUCH MATTER
+ *  SHALL BE THE IMMEDIATE, UNILATERAL TERMINATION OF THIS AGREEMENT.
+ */
+
+#include <string>
+#include <vector>
+#include <map>
+#include <mpi.h>
+
+#include "Writer.h"
+#include "KBIFormat.h"
+
+namespace VisKombyne
+{
+
+/**
+ * Kombyne indexed binary (kbi) writer, see KBIFormat.h.
+ *
+ * The pieces of all ranks are written as the blocks of a single shared file
+ * with collective MPI-IO, rank 0 writing the header and index.
+ *
+ * Fields are compressed with an error bound given by the "tolerance"
+ * option, overridden per field by "tolerance.<field>": an absolute error
+ * ("1e-6" or "abs:1e-6") or an error relative to the range of the field
+ * ("rel:1e-4"), fields without tolerance are stored raw.  The option
+ * compression=lossy stores the quantized fields predicted along the node
+ * order, compression=delta stores the quantized changes since the previous
+ * output with a lossy keyframe every "keyframe" outputs (default 10) or
+ * whenever the block changes size.  The achieved ratio and largest error
+ * are logged for each file.
+ */
+class KBIWriter : public Writer
+{
+  public:
+    /**
+     * Constructor.
+     *
+     * @param comm  Communications object of the writing ranks
+     * @param options  Writer options
+     */
+    KBIWriter(void* comm, const WriterOptions& options);
+    virtual ~KBIWriter() {}
+
+    virtual void write(const std::string& filename, const Extract& piece);
+
+  private:
+    inline std::vector<std::string> partNames(const Extract& piece);
+    inline std::vector<double> steps(const Extract& piece);
+    inline void encodeField(size_t f, const std::vector<double>& values,
+                            double step, KBI::Chunk& chunk,
+                            std::vector<char>& data);
+    inline void report(const std::string& filename, const Extract& piece,
+                       const std::vector<KBI::Chunk>& chunks);
+
+    struct Tolerance
+    {
+      double value;
+      bool relative;
+    };
+    static Tolerance parseTolerance(const std::string& s);
+
+    enum Compression
+    {
+      COMPRESSION_NONE,
+      COMPRESSION_LOSSY,
+      COMPRESSION_DELTA
+    };
+    inline void writeAt(int32_t fd, size_t offset, const void* data,
+                        size_t bytes);
+
+  private:
+    void* m_comm;
+    MPI_Comm m_mpi_comm;
+    int32_t m_rank;
+    int32_t m_nprocs;
+
+    Compression m_compression;
+    int32_t m_keyframe;
+    Tolerance m_tolerance;
+    std::map<std::string, Tolerance> m_tolerances;
+    int64_t m_outputs;
+    /** Quantized fields of the previous output and their steps */
+    std::vector<std::vector<int64_t> > m_previous;
+    std::vector<double> m_steps;
+};
+
+} // namespace VisKombyne
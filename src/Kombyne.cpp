@@ -41,14 +41,22 @@
 #include <exception>
 #include <cstdlib>
 #include <cstring>
+#include <cmath>
 #include <string>
 #include <iostream>
 #include <sstream>
+#include <fstream>
 #include <algorithm>
+#include <sys/stat.h>
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
 
 #include "Kombyne.h"
 #include "tinf_iris.h"
 #include "tinf_solution.h"
+#include "TinfCheck.h"
 
 using namespace VisKombyne;
 
@@ -61,25 +69,36 @@ using namespace VisKombyne;
   } \
 })
 
-#define TINF_CHECK_SUCCESS(error, msg) ({ \
-  if( TINF_SUCCESS != error ) { \
-    std::stringstream ss; \
-    ss << error; \
-    std::string message = std::string(msg) + ": " + ss.str(); \
-    throw std::runtime_error(message.c_str()); \
-  } \
-})
-
 
 Kombyne::Kombyne(void* problem, void* mesh, void* soln, void* comm,
                  int32_t anals) : m_problem(problem),
                                   m_mesh(problem, mesh,comm),
-                                  m_soln(soln), m_comm(comm), m_timestep(0)
+                                  m_soln(soln), m_comm(comm), m_timestep(0),
+                                  m_time(0.0), m_stats_start(0),
+                                  m_stats_step(-1),
+                                  m_adaptive_threshold(0.0),
+                                  m_adaptive_min(1), m_adaptive_max(0),
+                                  m_last_output(-1),
+                                  m_governor(comm, 0.0), m_queue(NULL),
+                                  m_probes(NULL), m_probe_freq(1),
+                                  m_loads(NULL), m_loads_freq(1),
+                                  m_gradient(NULL), m_expressions(NULL),
+                                  m_cell_fields(NULL), m_region(NULL),
+                                  m_overset(NULL), m_pipeline_reload(true),
+                                  m_pipeline_reloaded(false),
+                                  m_pipeline_step(-1), m_pipeline_mtime(-1),
+                                  m_pipeline_size(-1), m_mesh_step(-1),
+                                  m_kb_generation(-1)
 {
   int32_t error;
   MPI_Comm mpi_comm;
   kb_role role;
 
+  /* Keys read at every solver iteration */
+  m_step_key = m_problem.key<int64_t>("info:step");
+  m_time_key = m_problem.key<double>("info:timestep");
+  m_freq_key = m_problem.key<int32_t>("global:visualization_freq");
+
   mpi_comm = MPI_Comm_f2c(tinf_iris_get_mpi_fcomm(m_comm,&error));
   int32_t nprocs = tinf_iris_number_of_processes(m_comm, &error);
   int32_t sims;
@@ -105,6 +124,17 @@ Kombyne::Kombyne(void* problem, void* mesh, void* soln, void* comm,
 
   m_mesh.moving(moving_grid || grid_motion_attribute);
 
+  m_problem.value("kombyne:adaptive_threshold",&m_adaptive_threshold);
+  m_problem.value("kombyne:adaptive_min_interval",&m_adaptive_min);
+  m_problem.value("kombyne:adaptive_max_interval",&m_adaptive_max);
+
+  double budget = 0.0;
+  m_problem.value("kombyne:time_budget",&budget);
+  m_governor = Governor(m_comm, budget);
+
+  /* With kombyne:mesh_threads > 1 the mesh is being ingested on worker
+   * threads (see UMesh), overlap it with the Kombyne initialization and the
+   * pipeline parsing. */
   createFields();
 
   kb_initialize(mpi_comm,
@@ -118,56 +148,656 @@ Kombyne::Kombyne(void* problem, void* mesh, void* soln, void* comm,
 
   addPipelineCollection();
 
+  m_mesh.join();
+
+  bool blanking = false;
+  m_problem.value("kombyne:overset_blanking", &blanking);
+  if( blanking ) {
+    std::vector<int32_t> status;
+    if( !m_problem.value("kombyne:overset_blank_status", status) )
+      status.push_back(0);
+    m_overset = new Overset(mesh, m_comm, m_mesh, status);
+  }
+
+  sizeFields();
+  createStatistics();
+  createNativePipelines();
+  createProbes();
+  createLoads();
+  createGradients();
+  createDerivedFields();
+
+  std::vector<std::string> cell_fields;
+  m_problem.value("kombyne:cell_fields", cell_fields);
+  if( !cell_fields.empty() )
+    m_cell_fields = new CellFields(m_soln, m_mesh, cell_fields);
+
+  createRegion();
+
+  if( m_mesh.moving() ) {
+    double time=0.0;
+    m_problem.value("info:timestep",&time);
+    m_mesh.rigidMotion(problem, m_soln, time);
+  }
+
   bool initial = false;
   m_problem.value("volume_output:output_initial_state",&initial);
   if( initial )
     execute();
+
+  m_timer.reset();
 }
 
 Kombyne::~Kombyne()
 {
+  /* Pending outputs reference the pipeline writers, drain them before the
+   * pipelines go, the queue itself goes after them since their aggregators
+   * flush it on destruction */
+  try {
+    if( m_queue )
+      m_queue->flush();
+  } catch( std::exception& e ) {
+    std::cerr << "Native output failed: " << e.what() << std::endl;
+  }
+  delete m_probes;
+  delete m_loads;
+  delete m_gradient;
+  m_gradient_fields.clear();
+  delete m_expressions;
+  m_derived_fields.clear();
+  delete m_cell_fields;
+  delete m_region;
+  delete m_overset;
+
+  std::vector<NativePipeline*>::iterator it;
+  for(it = m_native.begin(); it != m_native.end(); ++it)
+    delete *it;
+  delete m_queue;
+
   m_fields.clear();
 
   kb_pipeline_collection_free(m_hp);
   kb_finalize();
 }
 
+void Kombyne::visualize()
+{
+  m_governor.solver(m_timer.elapsed());
+
+  /* The governor can only skip outputs, the per-step statistics, probes
+   * and loads are left out of the governed time on both sides */
+  accumulate();
+  probe();
+  integrateLoads();
+
+  pancake::ExecutionTimer timer;
+
+  if( processTimestep() && m_governor.admit(m_timestep) ) {
+    execute();
+    if( m_adaptive_threshold > 0.0 ) {
+      m_last_norms.swap(m_pending_norms);
+      m_last_output = m_timestep;
+    }
+  }
+
+  m_governor.visualization(timer.elapsed());
+  m_timer.reset();
+}
+
 bool Kombyne::processTimestep()
 {
   int error;
 
   int32_t freq = 0;
 
-  m_problem.value("info:step",&m_timestep);
-  m_problem.value("global:visualization_freq",&freq);
+  m_problem.value(m_step_key,&m_timestep);
+  m_problem.value(m_freq_key,&freq);
 
-  if( 0 != freq && 0 == m_timestep%freq )
-    return true;
+  if( 0 == freq || 0 != m_timestep%freq )
+    return false;
 
-  return false;
+  if( m_adaptive_threshold > 0.0 )
+    return adaptiveTrigger();
+
+  return true;
+}
+
+bool Kombyne::adaptiveTrigger()
+{
+  int64_t since = m_timestep - m_last_output;
+
+  if( m_last_output >= 0 && since < m_adaptive_min )
+    return false;
+
+  std::vector<double> norms;
+  globalNorms(norms);
+
+  bool fire = (m_last_output < 0) ||
+              (m_adaptive_max > 0 && since >= m_adaptive_max);
+
+  /* Relative change of any field norm since the last output */
+  for( size_t i=0; !fire && i<norms.size(); ++i ) {
+    double ref = std::max(std::fabs(m_last_norms[i]), 1.0e-30);
+    fire = std::fabs(norms[i] - m_last_norms[i])/ref > m_adaptive_threshold;
+  }
+
+  /* The baseline moves once the output has actually executed */
+  if( fire )
+    m_pending_norms.swap(norms);
+
+  return fire;
+}
+
+void Kombyne::globalNorms(std::vector<double>& norms)
+{
+  int error;
+
+  const int32_t* owned = m_mesh.ghostNodes();
+  int64_t n01 = m_mesh.nNodes01();
+
+  /* Sum of squares of each field over the owned nodes, plus the count */
+  std::vector<double> local;
+  local.reserve(m_fields.size()+1);
+
+  std::vector<Field>::iterator it;
+  for(it = m_fields.begin(); it != m_fields.end(); ++it) {
+    if( 0 == strncmp(it->name(),"Residual",8) )
+      continue;
+    fetchField(*it);
+    const double* values = it->values();
+    double sum = 0.0;
+    for( int64_t i=0; i<n01; ++i )
+      sum += owned[i] * values[i] * values[i];
+    local.push_back(sum);
+  }
+
+  double count = 0.0;
+  for( int64_t i=0; i<n01; ++i )
+    count += owned[i];
+  local.push_back(count);
+
+  std::vector<double> global(local.size(), 0.0);
+  size_t dims[TINF_DATA_MAX_RANK] = {local.size(), 1};
+  error = tinf_iris_sum(m_comm, TINF_DOUBLE, 1, dims, local.data(),
+                        global.data());
+  TINF_CHECK_SUCCESS(error, "Could not reduce field norms");
+
+  count = std::max(global.back(), 1.0);
+  global.pop_back();
+
+  norms.resize(global.size());
+  for( size_t i=0; i<global.size(); ++i )
+    norms[i] = std::sqrt(global[i]/count);
+}
+
+void Kombyne::accumulate()
+{
+  if( m_stats.empty() )
+    return;
+
+  m_problem.value(m_step_key,&m_timestep);
+  if( m_timestep < m_stats_start || m_timestep == m_stats_step )
+    return;
+
+  std::vector<Statistics>::iterator it;
+  for(it = m_stats.begin(); it != m_stats.end(); ++it) {
+    Field& field = m_fields[it->field()];
+    fetchField(field);
+    it->update(field.values());
+  }
+
+  m_stats_step = m_timestep;
 }
 
 void Kombyne::execute()
 {
   int error;
 
+  m_time = 0.0;
+  m_problem.value(m_time_key,&m_time);
+
   if( 0 == tinf_iris_rank(m_comm, &error) ) {
-    double time=0.0;
-    m_problem.value("info:timestep",&time);
     std::cerr << "Execute pipeline: timestep=" << m_timestep
-              << ", time=" << time << std::endl;
+              << ", time=" << m_time << std::endl;
   }
 
+  if( m_pipeline_reload && pipelineChanged() )
+    reloadPipelineCollection();
+
+  /* The plugin repeats the solver's hole cutting, only afford it on outputs,
+   * probes in between keep the blanking of the last output */
+  updateMesh();
+  if( m_overset )
+    m_overset->update();
+
   kb_ugrid_handle ug = addMesh();
-  addFields(ug);
+  NodalFields fields;
+  collectFields(fields);
+  addFields(ug, fields);
   addSamples();
   kb_pipeline_data_handle hpd = addPipelineData(ug);
 
   kb_controls_handle hc = KB_HANDLE_NULL;
   error = kb_simulation_execute(m_hp, hpd, hc);
   KB_CHECK_STATUS(error, "Could not execute pipeline");
+  m_pipeline_reloaded = false;
+  m_kb_generation = m_mesh.generation();
 
   kb_pipeline_data_free(hpd);
+
+  executeNativePipelines(fields);
+}
+
+void Kombyne::createNativePipelines()
+{
+  std::vector<std::string> specs;
+  m_problem.value("kombyne:native_pipelines", specs);
+
+  if( specs.empty() )
+    return;
+
+  int32_t capacity = 2;
+  m_problem.value("kombyne:write_queue",&capacity);
+  m_queue = new WriteQueue(m_comm, capacity);
+
+  m_native.reserve(specs.size());
+
+  std::vector<std::string>::iterator it;
+  for(it = specs.begin(); it != specs.end(); ++it)
+    m_native.push_back(NativePipeline::create(*it, m_comm, m_queue));
+}
+
+void Kombyne::executeNativePipelines(const NodalFields& fields)
+{
+  bool executed = false;
+
+  std::vector<NativePipeline*>::iterator it;
+  for(it = m_native.begin(); it != m_native.end(); ++it) {
+    if( (*it)->due(m_timestep) ) {
+      (*it)->execute(m_mesh, fields, m_timestep);
+      executed = true;
+    }
+  }
+
+  if( executed )
+    m_queue->report(m_timestep);
+}
+
+void Kombyne::createProbes()
+{
+  std::vector<double> points;
+  m_problem.value("kombyne:probes", points);
+
+  /* Lines of probes: x0, y0, z0, x1, y1, z1, number of probes */
+  std::vector<double> lines;
+  m_problem.value("kombyne:probe_lines", lines);
+  if( 0 != lines.size()%7 )
+    throw std::runtime_error("Probe lines must be given as 7-tuples");
+
+  for( size_t l=0; l<lines.size(); l+=7 ) {
+    const double* line = &lines[l];
+    int64_t n = (int64_t)line[6];
+    for( int64_t i=0; i<n; ++i ) {
+      double t = n > 1 ? (double)i/(n-1) : 0.0;
+      for( int32_t d=0; d<3; ++d )
+        points.push_back(line[d] + t*(line[d+3] - line[d]));
+    }
+  }
+
+  if( points.empty() )
+    return;
+
+  std::vector<std::string> names;
+  m_problem.value("kombyne:probe_fields", names);
+  if( names.empty() ) {
+    std::vector<Field>::iterator it;
+    for(it = m_fields.begin(); it != m_fields.end(); ++it)
+      names.push_back(it->name());
+  }
+
+  std::vector<std::string>::iterator it;
+  for(it = names.begin(); it != names.end(); ++it)
+    if( NULL == findField(*it) )
+      throw std::runtime_error("Unknown probe field: " + *it);
+
+  std::string filename = "probes.csv";
+  m_problem.value("kombyne:probe_file", filename);
+
+  std::string format = "csv";
+  m_problem.value("kombyne:probe_format", format);
+  if( format != "csv" && format != "binary" )
+    throw std::runtime_error("Unknown probe format: " + format);
+
+  m_problem.value("kombyne:probe_frequency", &m_probe_freq);
+
+  m_probes = new Probes(m_comm, m_mesh, points, names, filename,
+                        format == "binary");
+}
+
+void Kombyne::probe()
+{
+  if( NULL == m_probes )
+    return;
+
+  m_problem.value(m_step_key,&m_timestep);
+  if( m_probe_freq <= 0 || 0 != m_timestep%m_probe_freq )
+    return;
+
+  double time = 0.0;
+  m_problem.value(m_time_key,&time);
+
+  updateMesh();
+
+  NodalFields fields;
+  const std::vector<std::string>& names = m_probes->fields();
+  std::vector<std::string>::const_iterator it;
+  for(it = names.begin(); it != names.end(); ++it) {
+    Field* field = findField(*it);
+    fetchField(*field);
+    fields.push_back(std::make_pair(*it, (const double*)field->values()));
+  }
+
+  m_probes->sample(m_timestep, time, fields);
+}
+
+void Kombyne::createLoads()
+{
+  std::vector<std::string> families;
+  m_problem.value("kombyne:loads_families", families);
+
+  if( families.empty() )
+    return;
+
+  m_loads_pressure = "p";
+  m_problem.value("kombyne:loads_pressure", m_loads_pressure);
+  if( NULL == findField(m_loads_pressure) )
+    throw std::runtime_error("Unknown loads pressure: " + m_loads_pressure);
+
+  m_problem.value("kombyne:loads_shear", m_loads_shear);
+  if( !m_loads_shear.empty() && 3 != m_loads_shear.size() )
+    throw std::runtime_error("Loads shear needs 3 components");
+  std::vector<std::string>::iterator it;
+  for(it = m_loads_shear.begin(); it != m_loads_shear.end(); ++it)
+    if( NULL == findField(*it) )
+      throw std::runtime_error("Unknown loads shear: " + *it);
+
+  std::vector<std::string> bc_families;
+  std::vector<int64_t> bc_tags;
+  m_problem.value("bc:family", bc_families);
+  m_problem.value("bc:tag", bc_tags);
+
+  std::string filename = "loads.csv";
+  m_problem.value("kombyne:loads_file", filename);
+
+  m_loads = new Loads(m_comm, m_mesh, families, bc_families, bc_tags,
+                      filename);
+
+  double pref = 0.0;
+  m_problem.value("kombyne:loads_reference_pressure", &pref);
+  m_loads->referencePressure(pref);
+
+  std::vector<double> center;
+  m_problem.value("kombyne:loads_moment_center", center);
+  if( !center.empty() ) {
+    if( 3 != center.size() )
+      throw std::runtime_error("Loads moment center needs 3 coordinates");
+    m_loads->center(center.data());
+  }
+
+  double scale = 1.0;
+  m_problem.value("kombyne:loads_scale", &scale);
+  m_loads->scale(scale);
+
+  m_problem.value("kombyne:loads_frequency", &m_loads_freq);
+}
+
+void Kombyne::integrateLoads()
+{
+  if( NULL == m_loads )
+    return;
+
+  m_problem.value(m_step_key,&m_timestep);
+  if( m_loads_freq <= 0 || 0 != m_timestep%m_loads_freq )
+    return;
+
+  double time = 0.0;
+  m_problem.value(m_time_key,&time);
+
+  updateMesh();
+
+  Field* pressure = findField(m_loads_pressure);
+  fetchField(*pressure);
+
+  const double* tau[3] = {NULL, NULL, NULL};
+  for( size_t d=0; d<m_loads_shear.size(); ++d ) {
+    Field* shear = findField(m_loads_shear[d]);
+    fetchField(*shear);
+    tau[d] = shear->values();
+  }
+
+  m_loads->integrate(m_timestep, time, pressure->values(),
+                     m_loads_shear.empty() ? NULL : tau);
+}
+
+void Kombyne::createGradients()
+{
+  m_problem.value("kombyne:gradient_fields", m_gradient_inputs);
+  m_problem.value("kombyne:vortex_quantities", m_vortex);
+
+  if( m_gradient_inputs.empty() && m_vortex.empty() )
+    return;
+
+  std::vector<std::string> names;
+  std::vector<std::string>::iterator it;
+  for(it = m_gradient_inputs.begin(); it != m_gradient_inputs.end(); ++it) {
+    if( NULL == findField(*it) )
+      throw std::runtime_error("Unknown gradient field: " + *it);
+    names.push_back(*it + "_grad_x");
+    names.push_back(*it + "_grad_y");
+    names.push_back(*it + "_grad_z");
+  }
+
+  /* Outputs in the order computeGradients() fills them */
+  const char* quantities[] = {"vorticity", "vorticity_magnitude",
+                              "q_criterion", "lambda2"};
+  for(it = m_vortex.begin(); it != m_vortex.end(); ++it)
+    if( std::find(quantities, quantities+4, *it) == quantities+4 )
+      throw std::runtime_error("Unknown vortex quantity: " + *it);
+  for( int32_t q=0; q<4; ++q ) {
+    if( std::find(m_vortex.begin(), m_vortex.end(), quantities[q]) ==
+        m_vortex.end() )
+      continue;
+    if( 0 == q ) {
+      names.push_back("vorticity_x");
+      names.push_back("vorticity_y");
+      names.push_back("vorticity_z");
+    } else {
+      names.push_back(quantities[q]);
+    }
+  }
+
+  if( !m_vortex.empty() ) {
+    if( !m_problem.value("kombyne:velocity_fields", m_velocity) ) {
+      m_velocity.push_back("u");
+      m_velocity.push_back("v");
+      m_velocity.push_back("w");
+    }
+    if( 3 != m_velocity.size() )
+      throw std::runtime_error("Velocity fields need 3 components");
+    for(it = m_velocity.begin(); it != m_velocity.end(); ++it)
+      if( NULL == findField(*it) )
+        throw std::runtime_error("Unknown velocity field: " + *it);
+    m_velocity_grad.resize(9*m_mesh.nNodes01());
+  }
+
+  int32_t nthreads = 1;
+  m_problem.value("kombyne:gradient_threads", &nthreads);
+  m_gradient = new Gradient(m_mesh, nthreads);
+
+  m_gradient_fields.reserve(names.size());
+  for(it = names.begin(); it != names.end(); ++it)
+    m_gradient_fields.push_back(Field(it->c_str(), TINF_DOUBLE));
+  std::vector<Field>::iterator f;
+  for(f = m_gradient_fields.begin(); f != m_gradient_fields.end(); ++f)
+    f->size(m_mesh.nNodes01());
+}
+
+void Kombyne::computeGradients()
+{
+  if( NULL == m_gradient )
+    return;
+
+  std::vector<Field>::iterator out = m_gradient_fields.begin();
+
+  std::vector<std::string>::iterator it;
+  for(it = m_gradient_inputs.begin(); it != m_gradient_inputs.end(); ++it) {
+    Field* field = findField(*it);
+    fetchField(*field);
+    double* g[3] = {out[0].values(), out[1].values(), out[2].values()};
+    m_gradient->gradient(field->values(), g);
+    out += 3;
+  }
+
+  if( m_vortex.empty() )
+    return;
+
+  const double* u[3];
+  for( int32_t i=0; i<3; ++i ) {
+    Field* field = findField(m_velocity[i]);
+    fetchField(*field);
+    u[i] = field->values();
+  }
+
+  int64_t n = m_mesh.nNodes01();
+  double* grad[9];
+  for( int32_t k=0; k<9; ++k )
+    grad[k] = &m_velocity_grad[k*n];
+  m_gradient->velocityGradient(u, grad);
+
+  /* Same order as the names of createGradients() */
+  double* vorticity[3] = {NULL, NULL, NULL};
+  double* outputs[3] = {NULL, NULL, NULL};
+  const char* quantities[] = {"vorticity_magnitude", "q_criterion",
+                              "lambda2"};
+  if( std::find(m_vortex.begin(), m_vortex.end(), "vorticity") !=
+      m_vortex.end() ) {
+    for( int32_t d=0; d<3; ++d )
+      vorticity[d] = (out++)->values();
+  }
+  for( int32_t q=0; q<3; ++q )
+    if( std::find(m_vortex.begin(), m_vortex.end(), quantities[q]) !=
+        m_vortex.end() )
+      outputs[q] = (out++)->values();
+
+  m_gradient->vortex(grad, vorticity[0] ? vorticity : NULL, outputs[0],
+                     outputs[1], outputs[2]);
+}
+
+void Kombyne::createDerivedFields()
+{
+  std::vector<std::string> definitions;
+  m_problem.value("kombyne:derived_fields", definitions);
+
+  if( definitions.empty() )
+    return;
+
+  m_expressions = new Expressions(definitions);
+
+  /* Inputs are solver outputs or gradient outputs */
+  const std::vector<std::string>& inputs = m_expressions->inputs();
+  std::vector<std::string>::const_iterator it;
+  for(it = inputs.begin(); it != inputs.end(); ++it) {
+    bool found = (NULL != findField(*it));
+    std::vector<Field>::iterator g;
+    for(g = m_gradient_fields.begin(); g != m_gradient_fields.end(); ++g)
+      found = found || (*it == g->name());
+    if( !found )
+      throw std::runtime_error("Unknown derived field input: " + *it);
+  }
+
+  bool hide = false;
+  m_problem.value("kombyne:hide_derived_inputs", &hide);
+  if( hide )
+    m_hidden = inputs;
+
+  const std::vector<std::string>& names = m_expressions->names();
+  m_derived_fields.reserve(names.size());
+  for(it = names.begin(); it != names.end(); ++it)
+    m_derived_fields.push_back(Field(it->c_str(), TINF_DOUBLE));
+  std::vector<Field>::iterator f;
+  for(f = m_derived_fields.begin(); f != m_derived_fields.end(); ++f)
+    f->size(m_mesh.nNodes01());
+}
+
+void Kombyne::evaluateDerivedFields(NodalFields& fields)
+{
+  if( NULL == m_expressions )
+    return;
+
+  std::vector<const double*> inputs;
+  const std::vector<std::string>& names = m_expressions->inputs();
+  std::vector<std::string>::const_iterator it;
+  for(it = names.begin(); it != names.end(); ++it) {
+    NodalFields::iterator f;
+    for(f = fields.begin(); f != fields.end(); ++f)
+      if( *it == f->first )
+        break;
+    if( f == fields.end() )
+      throw std::runtime_error("Derived field input not collected: " + *it);
+    inputs.push_back(f->second);
+  }
+
+  std::vector<double*> outputs;
+  std::vector<Field>::iterator f;
+  for(f = m_derived_fields.begin(); f != m_derived_fields.end(); ++f)
+    outputs.push_back(f->values());
+
+  m_expressions->evaluate(m_mesh.nNodes01(), inputs, outputs);
+
+  for(f = m_derived_fields.begin(); f != m_derived_fields.end(); ++f)
+    fields.push_back(std::make_pair(std::string(f->name()), f->values()));
+}
+
+void Kombyne::createRegion()
+{
+  Region region(m_mesh);
+
+  std::vector<double> box;
+  m_problem.value("kombyne:roi_box", box);
+  if( !box.empty() ) {
+    if( 6 != box.size() )
+      throw std::runtime_error("Region box needs 6 values");
+    region.box(box.data());
+  }
+
+  std::vector<double> sphere;
+  m_problem.value("kombyne:roi_sphere", sphere);
+  if( !sphere.empty() ) {
+    if( 4 != sphere.size() )
+      throw std::runtime_error("Region sphere needs 4 values");
+    region.sphere(sphere.data());
+  }
+
+  std::vector<int64_t> tags;
+  m_problem.value("kombyne:roi_tags", tags);
+  region.tags(tags);
+
+  int32_t layers = 0;
+  m_problem.value("kombyne:roi_layers", &layers);
+  region.layers(layers);
+
+  /* Overset blanking compacts the mesh even without a region */
+  if( region.defined() || m_overset )
+    m_region = new Region(region);
+}
+
+Field* Kombyne::findField(const std::string& name)
+{
+  std::vector<Field>::iterator it;
+  for(it = m_fields.begin(); it != m_fields.end(); ++it)
+    if( name == it->name() )
+      return &(*it);
+  return NULL;
 }
 
 void Kombyne::createFields()
@@ -185,12 +815,52 @@ void Kombyne::createFields()
   for( int i=0; i<n_outputs; ++i ) {
     m_fields.push_back(Field(names[i], datatype[i]));
   }
+}
 
+void Kombyne::sizeFields()
+{
   for(std::vector<Field>::iterator it = m_fields.begin();
       it != m_fields.end(); ++it)
     it->size(m_mesh.nNodes01());
 }
 
+void Kombyne::createStatistics()
+{
+  std::vector<std::string> names;
+  m_problem.value("kombyne:statistics_fields", names);
+  m_problem.value("kombyne:statistics_start", &m_stats_start);
+
+  m_stats.reserve(names.size());
+
+  std::vector<std::string>::iterator it;
+  for(it = names.begin(); it != names.end(); ++it) {
+    size_t i;
+    for( i=0; i<m_fields.size(); ++i )
+      if( *it == m_fields[i].name() )
+        break;
+    if( i == m_fields.size() )
+      throw std::runtime_error("Unknown statistics field: " + *it);
+
+    m_stats.push_back(Statistics(it->c_str(), i, m_mesh.nNodes01()));
+  }
+}
+
+void Kombyne::fetchField(Field& field)
+{
+  int error;
+
+  if( field.step() == m_timestep )
+    return;
+
+  const char* name = field.name();
+  error = tinf_solution_get_outputs_at_nodes(m_soln, field.type(), 0,
+                                             m_mesh.nNodes01(), 1, &name,
+                                             field.values());
+  TINF_CHECK_SUCCESS(error, "Failed to retrieve Solver output values");
+
+  field.step(m_timestep);
+}
+
 kb_ugrid_handle Kombyne::addMesh()
 {
   kb_ugrid_handle ug = kb_ugrid_alloc();
@@ -204,22 +874,48 @@ kb_ugrid_handle Kombyne::addMesh()
   return ug;
 }
 
+/*
+ * Move the mesh to the solver time once per step, on executed steps and on
+ * the steps the probes and loads sample in between.
+ */
+void Kombyne::updateMesh()
+{
+  if( m_mesh_step == m_timestep )
+    return;
+  m_mesh_step = m_timestep;
+
+  double time = 0.0;
+  m_problem.value(m_time_key,&time);
+  m_mesh.updateCoordinates(time);
+}
+
 void Kombyne::addNodes(kb_ugrid_handle ug)
 {
   int error;
 
-  m_mesh.getNodes();
+  updateMesh();
 
   int n01 = (int)m_mesh.nNodes01();
   int stride = sizeof(double);
+  double* x = m_mesh.x();
+  double* y = m_mesh.y();
+  double* z = m_mesh.z();
+
+  if( m_region ) {
+    m_region->update();
+    n01 = (int)m_region->nNodes();
+    x = m_region->x();
+    y = m_region->y();
+    z = m_region->z();
+  }
 
   kb_var_handle hc = kb_var_alloc();
 
-  error = kb_var_set_arrayd(hc, 0, KB_MEM_BORROW, n01, 0, stride, m_mesh.x());
+  error = kb_var_set_arrayd(hc, 0, KB_MEM_BORROW, n01, 0, stride, x);
   KB_CHECK_STATUS(error, "Could not set mesh x array");
-  error = kb_var_set_arrayd(hc, 1, KB_MEM_BORROW, n01, 0, stride, m_mesh.y());
+  error = kb_var_set_arrayd(hc, 1, KB_MEM_BORROW, n01, 0, stride, y);
   KB_CHECK_STATUS(error, "Could not set mesh y array");
-  error = kb_var_set_arrayd(hc, 2, KB_MEM_BORROW, n01, 0, stride, m_mesh.z());
+  error = kb_var_set_arrayd(hc, 2, KB_MEM_BORROW, n01, 0, stride, z);
   KB_CHECK_STATUS(error, "Could not set mesh z array");
 
   error = kb_ugrid_set_coords(ug, hc);
@@ -232,9 +928,14 @@ void Kombyne::addConnectivity(kb_ugrid_handle ug)
   int32_t       error;
 
   int lconn = (int)m_mesh.cellConnectsSize();
+  int32_t* conn = m_mesh.cellConnects();
+  if( m_region ) {
+    lconn = (int)m_region->cellConnects().size();
+    conn = m_region->cellConnects().data();
+  }
 
   kb_var_handle hconn = kb_var_alloc();
-  error = kb_var_seti(hconn, KB_MEM_BORROW, 1, lconn, m_mesh.cellConnects());
+  error = kb_var_seti(hconn, KB_MEM_BORROW, 1, lconn, conn);
   KB_CHECK_STATUS(error, "Could not create cell connectivity array");
 
   error = kb_ugrid_add_cells_interleaved(ug, hconn);
@@ -260,9 +961,14 @@ void Kombyne::addGhostCells(kb_ugrid_handle ug)
   int error;
 
   int lconn = (int)m_mesh.nCell01();
+  int32_t* ghost = m_mesh.ghostCells();
+  if( m_region ) {
+    lconn = (int)m_region->nCells();
+    ghost = m_region->ghostCells().data();
+  }
 
   kb_var_handle hg = kb_var_alloc();
-  error = kb_var_seti(hg, KB_MEM_BORROW, 1, lconn, m_mesh.ghostCells());
+  error = kb_var_seti(hg, KB_MEM_BORROW, 1, lconn, ghost);
   KB_CHECK_STATUS(error, "Could not create Ghost cells array");
 
   error = kb_ugrid_set_ghost_cells(ug, hg);
@@ -273,7 +979,8 @@ void Kombyne::addBoundaries(kb_ugrid_handle ug)
 {
   int error;
 
-  std::vector<Boundary>& boundaries = m_mesh.boundaries();
+  std::vector<Boundary>& boundaries = m_region ? m_region->boundaries()
+                                               : m_mesh.boundaries();
 
   kb_bnd_handle hbnd;
   hbnd = kb_bnd_alloc();
@@ -348,21 +1055,139 @@ void Kombyne::addPipelineCollection()
 {
   int error;
 
+  const char* filename = std::getenv("KOMBYNE_PIPELINE");
+  m_pipeline_file = filename ? filename : "kombyne.yaml";
+
+  m_problem.value("kombyne:pipeline_reload", &m_pipeline_reload);
+  if( m_pipeline_reload )
+    pipelineChanged();
+
   m_hp = kb_pipeline_collection_alloc();
 
-  const char* filename = std::getenv("KOMBYNE_PIPELINE");
-  if( filename ) {
-    error = kb_pipeline_collection_set_filename(m_hp, filename);
-    KB_CHECK_STATUS(error, "Could not set pipeline collection filename");
-  } else {
-    error = kb_pipeline_collection_set_filename(m_hp, "kombyne.yaml");
-    KB_CHECK_STATUS(error,"Could not set default pipeline collection filename");
-  }
+  error = setPipelines(m_hp);
+  KB_CHECK_STATUS(error, "Could not set pipeline collection");
   
   error = kb_pipeline_collection_initialize(m_hp);
   KB_CHECK_STATUS(error, "Could not initialize pipeline");
 }
 
+/*
+ * Hand the pipelines to a collection from the contents of the pipeline
+ * file read on rank 0, or from the file name when Kombyne does not accept
+ * the contents.
+ */
+int Kombyne::setPipelines(kb_pipeline_collection_handle hp)
+{
+#ifdef HAVE_KB_PIPELINE_COLLECTION_SET_YAML
+  if( readPipelineFile(m_pipeline_yaml) ) {
+    int error = kb_pipeline_collection_set_yaml(hp, m_pipeline_yaml.c_str());
+    if( KB_RETURN_ERROR != error )
+      return error;
+  }
+#endif
+
+  return kb_pipeline_collection_set_filename(hp, m_pipeline_file.c_str());
+}
+
+/*
+ * Rank 0 reads the pipeline file and broadcasts its contents, so the file
+ * system sees a single open however many ranks there are.  Returns false
+ * on every rank when the file could not be read.
+ */
+bool Kombyne::readPipelineFile(std::string& yaml)
+{
+  int error;
+
+  int64_t size = -1;
+  if( 0 == tinf_iris_rank(m_comm, &error) ) {
+    std::ifstream in(m_pipeline_file.c_str(), std::ios::binary);
+    if( in ) {
+      std::stringstream ss;
+      ss << in.rdbuf();
+      yaml = ss.str();
+      size = yaml.size();
+    }
+  }
+
+  size_t dims[TINF_DATA_MAX_RANK] = {1, 1};
+  error = tinf_iris_broadcast(m_comm, TINF_INT64, 0, dims, &size, 0);
+  TINF_CHECK_SUCCESS(error, "Could not broadcast pipeline file size");
+  if( size < 0 )
+    return false;
+
+  yaml.resize(size);
+  if( size > 0 ) {
+    dims[0] = size;
+    error = tinf_iris_broadcast(m_comm, TINF_CHAR, 1, dims, &yaml[0], 0);
+    TINF_CHECK_SUCCESS(error, "Could not broadcast pipeline file");
+  }
+
+  return true;
+}
+
+/*
+ * Rank 0 compares the modification time and size of the pipeline file with
+ * those of the last check, at most once per step, and broadcasts whether
+ * it changed.
+ */
+bool Kombyne::pipelineChanged()
+{
+  int error;
+
+  if( m_pipeline_step == m_timestep )
+    return false;
+  m_pipeline_step = m_timestep;
+
+  int32_t changed = 0;
+  if( 0 == tinf_iris_rank(m_comm, &error) ) {
+    struct stat st;
+    if( 0 == stat(m_pipeline_file.c_str(), &st) &&
+        (st.st_mtime != m_pipeline_mtime || st.st_size != m_pipeline_size) ) {
+      changed = (m_pipeline_mtime >= 0) ? 1 : 0;
+      m_pipeline_mtime = st.st_mtime;
+      m_pipeline_size = st.st_size;
+    }
+  }
+
+  size_t dims[TINF_DATA_MAX_RANK] = {1, 1};
+  error = tinf_iris_broadcast(m_comm, TINF_INT32, 0, dims, &changed, 0);
+  TINF_CHECK_SUCCESS(error, "Could not broadcast pipeline file change");
+
+  return 0 != changed;
+}
+
+/*
+ * Replace the pipeline collection by one initialized from the changed file,
+ * the mesh, fields and Kombyne session are kept.  The current collection
+ * stays in place if the new one does not initialize.
+ */
+void Kombyne::reloadPipelineCollection()
+{
+  int error;
+
+  bool root = (0 == tinf_iris_rank(m_comm, &error));
+
+  kb_pipeline_collection_handle hp = kb_pipeline_collection_alloc();
+  error = setPipelines(hp);
+  if( KB_RETURN_ERROR != error )
+    error = kb_pipeline_collection_initialize(hp);
+
+  if( KB_RETURN_ERROR == error ) {
+    kb_pipeline_collection_free(hp);
+    if( root )
+      std::cerr << "Could not reload pipelines from " << m_pipeline_file
+                << ", keeping the current ones" << std::endl;
+    return;
+  }
+
+  kb_pipeline_collection_free(m_hp);
+  m_hp = hp;
+  m_pipeline_reloaded = true;
+
+  if( root )
+    std::cerr << "Reloaded pipelines from " << m_pipeline_file << std::endl;
+}
+
 kb_pipeline_data_handle Kombyne::addPipelineData(kb_ugrid_handle ug)
 {
   int error;
@@ -370,23 +1195,35 @@ kb_pipeline_data_handle Kombyne::addPipelineData(kb_ugrid_handle ug)
   int32_t domain = tinf_iris_rank(m_comm, &error);
   int32_t ndomains = tinf_iris_number_of_processes(m_comm, &error);
 
-  double time=0.0;
-  m_problem.value("info:timestep",&time);
-
   kb_mesh_handle hmesh = (kb_mesh_handle)ug;
 
   kb_pipeline_data_handle hpd = kb_pipeline_data_alloc();
 
-  error = kb_pipeline_data_add(hpd, domain, ndomains, m_timestep, time, hmesh);
+  error = kb_pipeline_data_add(hpd, domain, ndomains, m_timestep, m_time,
+                               hmesh);
   KB_CHECK_STATUS(error, "Could not add pipeline data");
 
 #define KOMBYNE_1_1
 #ifdef KOMBYNE_1_1
   int32_t promises = KB_PROMISE_STATIC_FIELDS; 
 
-  if( !m_mesh.moving() )
+  /* A moving grid is static if it did not move anywhere since the last
+   * execution */
+  int32_t changed = 0;
+  if( m_mesh.moving() ) {
+    int32_t local = (m_mesh.generation() != m_kb_generation) ? 1 : 0;
+    size_t dims[TINF_DATA_MAX_RANK] = {1, 1};
+    error = tinf_iris_max(m_comm, TINF_INT32, 0, dims, &local, &changed);
+    TINF_CHECK_SUCCESS(error, "Could not reduce grid changes");
+  }
+
+  if( 0 == changed )
     promises |= KB_PROMISE_STATIC_GRID;
 
+  /* Reloaded pipelines have not seen the grid or the fields yet */
+  if( m_pipeline_reloaded )
+    promises = 0;
+
   error = kb_pipeline_data_set_promises(hpd, promises);
   KB_CHECK_STATUS(error, "Could not set pipeline promises");
 #else
@@ -396,31 +1233,120 @@ kb_pipeline_data_handle Kombyne::addPipelineData(kb_ugrid_handle ug)
   return hpd;
 }
 
-void Kombyne::addFields(kb_ugrid_handle ug)
+void Kombyne::collectFields(NodalFields& fields)
+{
+  /* Ranks without region cells only need the field names, unless the
+   * native pipelines or the gradient ghost exchange need every rank */
+  bool fetch = !(m_region && m_region->empty() && m_native.empty() &&
+                 NULL == m_gradient);
+
+  std::vector<Field>::iterator it;
+  for(it = m_fields.begin(); it != m_fields.end(); ++it) {
+    if( fetch )
+      fetchField(*it);
+    fields.push_back(std::make_pair(std::string(it->name()), it->values()));
+  }
+
+  computeGradients();
+  for(it = m_gradient_fields.begin(); it != m_gradient_fields.end(); ++it)
+    fields.push_back(std::make_pair(std::string(it->name()), it->values()));
+
+  if( fetch ) {
+    evaluateDerivedFields(fields);
+  } else {
+    for(it = m_derived_fields.begin(); it != m_derived_fields.end(); ++it)
+      fields.push_back(std::make_pair(std::string(it->name()), it->values()));
+  }
+
+  /* Published zero-filled before the first sample so that the field set
+     stays fixed under KB_PROMISE_STATIC_FIELDS */
+  std::vector<Statistics>::iterator st;
+  for(st = m_stats.begin(); st != m_stats.end(); ++st) {
+    fields.push_back(std::make_pair(st->name() + "_mean", st->mean()));
+    fields.push_back(std::make_pair(st->name() + "_rms", st->rms()));
+    fields.push_back(std::make_pair(st->name() + "_min", st->min()));
+    fields.push_back(std::make_pair(st->name() + "_max", st->max()));
+  }
+}
+
+void Kombyne::addFields(kb_ugrid_handle ug, const NodalFields& fields)
 {
   int error;
 
   kb_fields_handle hfield = kb_fields_alloc();
 
-  std::vector<Field>::iterator it;
-  for(it = m_fields.begin(); it != m_fields.end(); ++it) {
-    const char* name = it->name();
-    error = tinf_solution_get_outputs_at_nodes(m_soln, it->type(), 0,
-                                               m_mesh.nNodes01(), 1, &name,
-                                               it->values());
-    TINF_CHECK_SUCCESS(error, "Failed to retrieve Solver output values");
+  /* Region values are gathered into buffers that live until the next
+   * execution, Kombyne borrows them */
+  if( m_region ) {
+    size_t ncell_fields = m_cell_fields ? m_cell_fields->fields().size() : 0;
+    m_region_values.resize(fields.size() + ncell_fields);
+  }
 
-    kb_var_handle hvar = kb_var_alloc();
-    error = kb_var_setd(hvar, KB_MEM_BORROW, 1, m_mesh.nNodes01(),it->values());
-    KB_CHECK_STATUS(error, "Could not create field data variable");
-    error = kb_fields_add_var(hfield, it->name(), KB_CENTERING_POINTS, hvar);
-    KB_CHECK_STATUS(error, "Could not add field data");
+  /* Hidden derived field inputs are only left out of the Kombyne data, the
+   * native pipelines still receive every field */
+  NodalFields::const_iterator it;
+  for(it = fields.begin(); it != fields.end(); ++it) {
+    if( std::find(m_hidden.begin(), m_hidden.end(), it->first) !=
+        m_hidden.end() )
+      continue;
+    if( m_region ) {
+      std::vector<double>& values = m_region_values[it-fields.begin()];
+      values.resize(m_region->nNodes());
+      m_region->gatherNodes(it->second, values.data());
+      addField(hfield, it->first, values.data(), values.size());
+    } else {
+      addField(hfield, it->first, it->second, m_mesh.nNodes01());
+    }
+  }
+
+  if( m_cell_fields ) {
+    if( NULL == m_region || !m_region->empty() )
+      m_cell_fields->fetch(m_timestep);
+    std::vector<Field>::iterator f;
+    std::vector<Field>& cells = m_cell_fields->fields();
+    for(f = cells.begin(); f != cells.end(); ++f) {
+      if( m_region ) {
+        std::vector<double>& values =
+          m_region_values[fields.size() + (f-cells.begin())];
+        values.resize(m_region->nCells());
+        m_region->gatherCells(f->values(), values.data());
+        addCellField(hfield, f->name(), values.data(), values.size());
+      } else {
+        addCellField(hfield, f->name(), f->values(), m_mesh.nCell01());
+      }
+    }
   }
 
   error = kb_ugrid_set_fields(ug, hfield);
   KB_CHECK_STATUS(error, "Could not add fields to mesh");
 }
 
+void Kombyne::addField(kb_fields_handle hfield, const std::string& name,
+                       const double* values, int64_t npoints)
+{
+  int error;
+
+  kb_var_handle hvar = kb_var_alloc();
+  error = kb_var_setd(hvar, KB_MEM_BORROW, 1, npoints,
+                      const_cast<double*>(values));
+  KB_CHECK_STATUS(error, "Could not create field data variable");
+  error = kb_fields_add_var(hfield, name.c_str(), KB_CENTERING_POINTS, hvar);
+  KB_CHECK_STATUS(error, "Could not add field data");
+}
+
+void Kombyne::addCellField(kb_fields_handle hfield, const std::string& name,
+                           const double* values, int64_t ncells)
+{
+  int error;
+
+  kb_var_handle hvar = kb_var_alloc();
+  error = kb_var_setd(hvar, KB_MEM_BORROW, 1, ncells,
+                      const_cast<double*>(values));
+  KB_CHECK_STATUS(error, "Could not create cell data variable");
+  error = kb_fields_add_var(hfield, name.c_str(), KB_CENTERING_CELLS, hvar);
+  KB_CHECK_STATUS(error, "Could not add cell data");
+}
+
 double Kombyne::l2norm(int64_t npoints, double* values)
 {
   double l2norm = 0.0;
@@ -440,10 +1366,26 @@ void Kombyne::addSamples()
   std::vector<Field>::iterator it;
   for(it = m_fields.begin(); it != m_fields.end(); ++it) {
     if( strncmp(it->name(),"Residual",8) ) {
-      double sample = l2norm(m_mesh.nNodes01(), it->values());
+      /* Fields of ranks outside of the region were not fetched */
+      double sample = 0.0;
+      if( it->step() == m_timestep )
+        sample = l2norm(m_mesh.nNodes01(), it->values());
       error = kb_add_sample(it->name(), sample);
       KB_CHECK_STATUS(error, "Could not add sample");
     }
   }
+
+  if( NULL == m_loads )
+    return;
+
+  /* Loads of the last integration */
+  for( size_t f=0; f<m_loads->families().size(); ++f ) {
+    const double* loads = m_loads->family(f);
+    for( int32_t c=0; c<6; ++c ) {
+      std::string name = m_loads->families()[f] + ":" + Loads::COMPONENTS[c];
+      error = kb_add_sample(name.c_str(), loads[c]);
+      KB_CHECK_STATUS(error, "Could not add loads sample");
+    }
+  }
 }
 
@@ -44,37 +44,24 @@
 #include <kombyne_core_types.h>
 #include "tinf_enum_definitions.h"
 #include "pancake_cxx/Problem.h"
+#include "Field.h"
 #include "UMesh.h"
+#include "Statistics.h"
+#include "Governor.h"
+#include "NativePipeline.h"
+#include "WriteQueue.h"
+#include "Probes.h"
+#include "Loads.h"
+#include "Gradient.h"
+#include "Expressions.h"
+#include "CellFields.h"
+#include "Region.h"
+#include "Overset.h"
+#include "pancake_cxx/ExecutionTimer.h"
 
 namespace VisKombyne
 {
 
-class Field
-{
-  public:
-    Field(const char* name, TINF_DATA_TYPE datatype) :
-      m_name(name), m_datatype(datatype), m_values(NULL) {}
-
-    virtual ~Field() { if( m_values ) free(m_values); }
-
-    inline void size(int64_t npoints)
-    {
-      m_values = (double*)malloc(npoints*sizeof(double));
-      if( NULL == m_values )
-        throw std::runtime_error("Failed to allocate field values");
-    }
-
-    inline const char* name() const { return m_name.c_str(); }
-    inline enum TINF_DATA_TYPE type() const { return m_datatype; }
-    inline double* values() const { return m_values; }
-
-  private:
-    std::string m_name;
-    enum TINF_DATA_TYPE m_datatype;
-    double* m_values;
-};
-
-
 class Kombyne
 {
   public:
@@ -94,6 +81,12 @@ class Kombyne
      */
     virtual ~Kombyne();
 
+    /**
+     * Process a solver step: accumulate statistics and execute the
+     * pipeline if requested and allowed by the time budget.
+     */
+    void visualize();
+
     /**
      * Check to see if need to process this timestep.
      *
@@ -101,6 +94,12 @@ class Kombyne
      */
     bool processTimestep();
 
+    /**
+     * Accumulate the running statistics of the selected fields.  Called at
+     * every solver step, whether or not the pipeline is executed.
+     */
+    void accumulate();
+
     /**
      * Execute the Kombyne pipeline.
      */
@@ -108,7 +107,11 @@ class Kombyne
 
   private:
     inline void createFields();
+    inline void sizeFields();
+    inline void createStatistics();
+    inline void fetchField(Field& field);
     inline kb_ugrid_handle addMesh();
+    inline void updateMesh();
     inline void addNodes(kb_ugrid_handle ug);
     inline void addConnectivity(kb_ugrid_handle ug);
     inline void addGhostNodes(kb_ugrid_handle ug);
@@ -120,13 +123,39 @@ class Kombyne
     inline void addQuads(std::vector<int32_t>& quads,
                          kb_bnd_handle hbnd, std::string bc);
     inline void addPipelineCollection();
+    inline int setPipelines(kb_pipeline_collection_handle hp);
+    inline bool readPipelineFile(std::string& yaml);
+    inline bool pipelineChanged();
+    inline void reloadPipelineCollection();
     inline kb_pipeline_data_handle addPipelineData(kb_ugrid_handle ug);
-    inline void addFields(kb_ugrid_handle ug);
+    inline void createNativePipelines();
+    inline void executeNativePipelines(const NodalFields& fields);
+    inline void createProbes();
+    inline void probe();
+    inline void createLoads();
+    inline void integrateLoads();
+    inline Field* findField(const std::string& name);
+    inline void createGradients();
+    inline void computeGradients();
+    inline void createDerivedFields();
+    inline void evaluateDerivedFields(NodalFields& fields);
+    inline void collectFields(NodalFields& fields);
+    inline void addFields(kb_ugrid_handle ug, const NodalFields& fields);
+    inline void addField(kb_fields_handle hfield, const std::string& name,
+                         const double* values, int64_t npoints);
+    inline void addCellField(kb_fields_handle hfield, const std::string& name,
+                             const double* values, int64_t ncells);
+    inline void createRegion();
     inline double l2norm(int64_t npoints, double* values);
+    inline bool adaptiveTrigger();
+    inline void globalNorms(std::vector<double>& norms);
     inline void addSamples();
 
   private:
     pancake::Problem m_problem;
+    pancake::Problem::Key<int64_t> m_step_key;
+    pancake::Problem::Key<double> m_time_key;
+    pancake::Problem::Key<int32_t> m_freq_key;
     UMesh m_mesh;
     void* m_soln;
     void* m_comm;
@@ -134,10 +163,61 @@ class Kombyne
     kb_role m_newrole;
 
     int64_t m_timestep;
+    double m_time;
 
     std::vector<Field> m_fields;
+    std::vector<Statistics> m_stats;
+    int64_t m_stats_start;
+    int64_t m_stats_step;
+
+    double m_adaptive_threshold;
+    int32_t m_adaptive_min;
+    int32_t m_adaptive_max;
+    int64_t m_last_output;
+    std::vector<double> m_last_norms;
+    std::vector<double> m_pending_norms;
+
+    std::vector<NativePipeline*> m_native;
+
+    Governor m_governor;
+    WriteQueue* m_queue;
+    Probes* m_probes;
+    int32_t m_probe_freq;
+    Loads* m_loads;
+    int32_t m_loads_freq;
+    std::string m_loads_pressure;
+    std::vector<std::string> m_loads_shear;
+
+    Gradient* m_gradient;
+    std::vector<std::string> m_velocity;
+    std::vector<std::string> m_gradient_inputs;
+    std::vector<std::string> m_vortex;
+    std::vector<double> m_velocity_grad;
+    std::vector<Field> m_gradient_fields;
+
+    Expressions* m_expressions;
+    std::vector<Field> m_derived_fields;
+    std::vector<std::string> m_hidden;
+
+    CellFields* m_cell_fields;
+
+    Region* m_region;
+    std::vector<std::vector<double> > m_region_values;
+
+    Overset* m_overset;
+    pancake::ExecutionTimer m_timer;
 
     kb_pipeline_collection_handle m_hp;
+    std::string m_pipeline_file;
+    std::string m_pipeline_yaml;
+    bool m_pipeline_reload;
+    bool m_pipeline_reloaded;
+    int64_t m_pipeline_step;
+    int64_t m_pipeline_mtime;
+    int64_t m_pipeline_size;
+    /** Step of the last mesh update, mesh generation last handed to Kombyne */
+    int64_t m_mesh_step;
+    int64_t m_kb_generation;
 };
 
 } // namespace VisKombyne
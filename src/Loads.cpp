@@ -0,0 +1,302 @@
+/*
+ *  Notices:
+ *  Copyright 2023 United States Government as represented by the
+ *  Administrator of the National Aeronautics and Space Administration.
+ *  No copyright is claimed in the United States under Title 17,
+ *  U.S. Code. All Other Rights Reserved.
+ *
+ *  Disclaimers No Warranty: THE SUBJECT SOFTWARE IS PROVIDED "AS
+ *  IS" WITHOUT ANY WARRANTY OF ANY KIND, EITHER EXPRESSED, IMPLIED,
+ *  OR STATUTORY, INCLUDING, BUT NOT LIMITED TO, ANY WARRANTY THAT
+ *  THE SUBJECT SOFTWARE WILL CONFORM TO SPECIFICATIONS, ANY IMPLIED
+ *  WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE,
+ *  OR FREEDOM FROM INFRINGEMENT, ANY WARRANTY THAT THE SUBJECT
+ *  SOFTWARE WILL BE ERROR FREE, OR ANY WARRANTY THAT DOCUMENTATION,
+ *  IF PROVIDED, WILL CONFORM TO THE SUBJECT SOFTWARE. THIS AGREEMENT
+ *  DOES NOT, IN ANY MANNER, CONSTITUTE AN ENDORSEMENT BY GOVERNMENT
+ *  AGENCY OR ANY PRIOR RECIPIENT OF ANY RESULTS, RESULTING DESIGNS,
+ *  HARDWARE, SOFTWARE PRODUCTS OR ANY OTHER APPLICATIONS RESULTING
+ *  FROM USE OF THE SUBJECT SOFTWARE.  FURTHER, GOVERNMENT AGENCY
+ *  DISCLAIMS ALL WARRANTIES AND LIABILITIES REGARDING THIRD-PARTY
+ *  SOFTWARE, IF PRESENT IN THE ORIGINAL SOFTWARE, AND DISTRIBUTES
+ *  IT "AS IS." 
+ *
+ *  Waiver and Indemnity:  RECIPIENT AGREES TO WAIVE ANY AND ALL
+ *  CLAIMS AGAINST THE UNITED STATES GOVERNMENT, ITS CONTRACTORS
+ *  AND SUBCONTRACTORS, AS WELL AS ANY PRIOR RECIPIENT.  IF RECIPIENT'S
+ *  USE OF THE SUBJECT SOFTWARE RESULTS IN ANY LIABILITIES, DEMANDS,
+ *  DAMAGES, EXPENSES OR LOSSES ARISING FROM SUCH USE, INCLUDING
+ *  ANY DAMAGES FROM PRODUCTS BASED ON, OR RESULTING FROM, RECIPIENT'S
+ *  USE OF THE SUBJECT SOFTWARE, RECIPIENT SHALL INDEMNIFY AND HOLD
+ *  HARMLESS THE UNITED STATES GOVERNMENT, ITS CONTRACTORS AND
+ *  SUBCONTRACTORS, AS WELL AS ANY PRIOR RECIPIENT, TO THE EXTENT
+ *  PERMITTED BY LAW.  RECIPIENT'S SOLE REMEDY FOR ANY SUCH MATTER
+ *  SHALL BE THE IMMEDIATE, UNILATERAL TERMINATION OF THIS AGREEMENT.
+ */
+
+#ifdef __GNUG__
+  #pragma implementation "Loads.h"
+#endif
+
+#include <exception>
+#include <stdexcept>
+#include <sstream>
+#include <iostream>
+#include <algorithm>
+#include <limits>
+#include <cmath>
+
+#include "Loads.h"
+#include "tinf_iris.h"
+#include "TinfCheck.h"
+
+using namespace VisKombyne;
+
+const char* Loads::COMPONENTS[6] = {"Fx", "Fy", "Fz", "Mx", "My", "Mz"};
+
+Loads::Loads(void* comm, UMesh& mesh, const std::vector<std::string>& families,
+             const std::vector<std::string>& bc_families,
+             const std::vector<int64_t>& bc_tags,
+             const std::string& filename) :
+  m_comm(comm), m_mesh(mesh), m_families(families), m_filename(filename),
+  m_pref(0.0), m_scale(1.0), m_generation(-1)
+{
+  int32_t error;
+
+  m_center[0] = m_center[1] = m_center[2] = 0.0;
+  m_mpi_comm = MPI_Comm_f2c(tinf_iris_get_mpi_fcomm(m_comm, &error));
+
+  /* A rank only holds the boundaries it touches, gather all tags */
+  std::vector<int64_t> local;
+  std::vector<Boundary>::iterator b;
+  for(b = m_mesh.boundaries().begin(); b != m_mesh.boundaries().end(); ++b)
+    local.push_back(b->tag());
+
+  int32_t nprocs = tinf_iris_number_of_processes(m_comm, &error);
+  int32_t count = local.size();
+  std::vector<int32_t> counts(nprocs);
+  MPI_Allgather(&count, 1, MPI_INT32_T, counts.data(), 1, MPI_INT32_T,
+                m_mpi_comm);
+  std::vector<int32_t> displs(nprocs, 0);
+  for( int32_t i=1; i<nprocs; ++i )
+    displs[i] = displs[i-1] + counts[i-1];
+  std::vector<int64_t> all(displs.back() + counts.back());
+  MPI_Allgatherv(local.data(), count, MPI_INT64_T, all.data(), counts.data(),
+                 displs.data(), MPI_INT64_T, m_mpi_comm);
+
+  std::sort(all.begin(), all.end());
+  all.erase(std::unique(all.begin(), all.end()), all.end());
+
+  /* Same family naming as UMesh::addBoundaries */
+  std::vector<int64_t>::iterator it;
+  for(it = all.begin(); it != all.end(); ++it) {
+    std::string family = std::string("Tag ") + std::to_string(*it);
+    std::vector<int64_t>::const_iterator t;
+    t = std::find(bc_tags.begin(), bc_tags.end(), *it);
+    if( t != bc_tags.end() )
+      family = bc_families[std::distance(bc_tags.begin(), t)];
+
+    std::vector<std::string>::iterator f;
+    f = std::find(m_families.begin(), m_families.end(), family);
+    if( f == m_families.end() )
+      continue;
+    m_tags.push_back(*it);
+    m_tag_family.push_back(std::distance(m_families.begin(), f));
+  }
+
+  for( size_t f=0; f<m_families.size(); ++f )
+    if( std::find(m_tag_family.begin(), m_tag_family.end(), f) ==
+        m_tag_family.end() )
+      throw std::runtime_error("Unknown loads family: " + m_families[f]);
+
+  m_tag_loads.assign(6*m_tags.size(), 0.0);
+  m_family.assign(6*m_families.size(), 0.0);
+
+  if( 0 == tinf_iris_rank(m_comm, &error) )
+    open();
+}
+
+Loads::~Loads()
+{
+  if( m_file.is_open() )
+    m_file.close();
+}
+
+/*
+ * Cache the owned faces of the selected tags with their area vectors and
+ * centroids.
+ */
+void Loads::cache()
+{
+  const double* x = m_mesh.x();
+  const double* y = m_mesh.y();
+  const double* z = m_mesh.z();
+
+  m_face_conn.clear();
+  m_face_fourth.clear();
+  m_face_inverse.clear();
+  m_face_tag.clear();
+  for( int32_t d=0; d<3; ++d ) {
+    m_area[d].clear();
+    m_centroid[d].clear();
+  }
+
+  std::vector<Boundary>::iterator b;
+  for(b = m_mesh.boundaries().begin(); b != m_mesh.boundaries().end(); ++b) {
+    std::vector<int64_t>::iterator t;
+    t = std::find(m_tags.begin(), m_tags.end(), b->tag());
+    if( t == m_tags.end() )
+      continue;
+    int32_t tag = std::distance(m_tags.begin(), t);
+
+    const std::vector<int32_t>& tris = b->tris();
+    for( size_t i=0; i<b->triOwned().size(); ++i ) {
+      if( !b->triOwned()[i] )
+        continue;
+      const int32_t* n = &tris[3*i];
+      int32_t face[4] = {n[0], n[1], n[2], n[0]};
+      m_face_conn.insert(m_face_conn.end(), face, face+4);
+      m_face_fourth.push_back(0.0);
+      m_face_inverse.push_back(1.0/3.0);
+      m_face_tag.push_back(tag);
+    }
+
+    const std::vector<int32_t>& quads = b->quads();
+    for( size_t i=0; i<b->quadOwned().size(); ++i ) {
+      if( !b->quadOwned()[i] )
+        continue;
+      m_face_conn.insert(m_face_conn.end(), &quads[4*i], &quads[4*i+4]);
+      m_face_fourth.push_back(1.0);
+      m_face_inverse.push_back(0.25);
+      m_face_tag.push_back(tag);
+    }
+  }
+
+  /* Half the cross product of the diagonals, with the fourth node of a
+   * triangle being its first one this is the cross product of two edges */
+  size_t nfaces = m_face_tag.size();
+  for( int32_t d=0; d<3; ++d ) {
+    m_area[d].resize(nfaces);
+    m_centroid[d].resize(nfaces);
+  }
+  for( size_t i=0; i<nfaces; ++i ) {
+    const int32_t* n = &m_face_conn[4*i];
+    int32_t last = m_face_fourth[i] > 0.0 ? n[3] : n[0];
+    double a[3] = {x[n[2]]-x[n[0]], y[n[2]]-y[n[0]], z[n[2]]-z[n[0]]};
+    double c[3] = {x[last]-x[n[1]], y[last]-y[n[1]], z[last]-z[n[1]]};
+    m_area[0][i] = 0.5*(a[1]*c[2] - a[2]*c[1]);
+    m_area[1][i] = 0.5*(a[2]*c[0] - a[0]*c[2]);
+    m_area[2][i] = 0.5*(a[0]*c[1] - a[1]*c[0]);
+
+    double w = m_face_fourth[i], s = m_face_inverse[i];
+    m_centroid[0][i] = (x[n[0]] + x[n[1]] + x[n[2]] + w*x[n[3]])*s;
+    m_centroid[1][i] = (y[n[0]] + y[n[1]] + y[n[2]] + w*y[n[3]])*s;
+    m_centroid[2][i] = (z[n[0]] + z[n[1]] + z[n[2]] + w*z[n[3]])*s;
+  }
+
+  m_generation = m_mesh.generation();
+}
+
+void Loads::open()
+{
+  std::ifstream existing(m_filename.c_str());
+  bool append = existing.good() &&
+                existing.peek() != std::ifstream::traits_type::eof();
+  existing.close();
+
+  m_file.open(m_filename.c_str(), std::ios::out | std::ios::app);
+  if( !m_file )
+    throw std::runtime_error("Could not open loads file " + m_filename);
+
+  /* Restarted runs keep appending to the same history */
+  if( append )
+    return;
+
+  m_file << "step,time";
+  for( size_t f=0; f<m_families.size(); ++f )
+    for( int32_t c=0; c<6; ++c )
+      m_file << "," << m_families[f] << ":" << COMPONENTS[c];
+  for( size_t t=0; t<m_tags.size(); ++t )
+    for( int32_t c=0; c<6; ++c )
+      m_file << ",tag " << m_tags[t] << ":" << COMPONENTS[c];
+  m_file << std::endl;
+}
+
+void Loads::integrate(int64_t step, double time, const double* p,
+                      const double* const tau[3])
+{
+  int32_t error;
+
+  if( m_mesh.generation() != m_generation )
+    cache();
+
+  /* Traction of each face: pressure along the area vector plus the shear
+   * stress times the face area */
+  size_t nfaces = m_face_tag.size();
+  std::vector<double> f[3];
+  for( int32_t d=0; d<3; ++d )
+    f[d].resize(nfaces);
+
+  const int32_t* conn = m_face_conn.data();
+  const double* fourth = m_face_fourth.data();
+  const double* inverse = m_face_inverse.data();
+  for( size_t i=0; i<nfaces; ++i ) {
+    const int32_t* n = conn + 4*i;
+    double pf = (p[n[0]] + p[n[1]] + p[n[2]] + fourth[i]*p[n[3]])*inverse[i]
+                - m_pref;
+    for( int32_t d=0; d<3; ++d )
+      f[d][i] = pf*m_area[d][i];
+  }
+
+  if( NULL != tau ) {
+    for( size_t i=0; i<nfaces; ++i ) {
+      const int32_t* n = conn + 4*i;
+      double area = std::sqrt(m_area[0][i]*m_area[0][i] +
+                              m_area[1][i]*m_area[1][i] +
+                              m_area[2][i]*m_area[2][i]);
+      for( int32_t d=0; d<3; ++d ) {
+        const double* t = tau[d];
+        f[d][i] += (t[n[0]] + t[n[1]] + t[n[2]] + fourth[i]*t[n[3]])*
+                   inverse[i]*area;
+      }
+    }
+  }
+
+  std::vector<double> local(6*m_tags.size(), 0.0);
+  for( size_t i=0; i<nfaces; ++i ) {
+    double* l = &local[6*m_face_tag[i]];
+    double r[3] = {m_centroid[0][i] - m_center[0],
+                   m_centroid[1][i] - m_center[1],
+                   m_centroid[2][i] - m_center[2]};
+    l[0] += f[0][i];
+    l[1] += f[1][i];
+    l[2] += f[2][i];
+    l[3] += r[1]*f[2][i] - r[2]*f[1][i];
+    l[4] += r[2]*f[0][i] - r[0]*f[2][i];
+    l[5] += r[0]*f[1][i] - r[1]*f[0][i];
+  }
+  for( size_t i=0; i<local.size(); ++i )
+    local[i] *= m_scale;
+
+  size_t dims[TINF_DATA_MAX_RANK] = {local.size(), 1};
+  error = tinf_iris_sum(m_comm, TINF_DOUBLE, 1, dims, local.data(),
+                        m_tag_loads.data());
+  TINF_CHECK_SUCCESS(error, "Could not reduce the loads");
+
+  std::fill(m_family.begin(), m_family.end(), 0.0);
+  for( size_t t=0; t<m_tags.size(); ++t )
+    for( int32_t c=0; c<6; ++c )
+      m_family[6*m_tag_family[t]+c] += m_tag_loads[6*t+c];
+
+  if( !m_file.is_open() )
+    return;
+
+  m_file.precision(std::numeric_limits<double>::digits10 + 2);
+  m_file << step << "," << time;
+  for( size_t i=0; i<m_family.size(); ++i )
+    m_file << "," << m_family[i];
+  for( size_t i=0; i<m_tag_loads.size(); ++i )
+    m_file << "," << m_tag_loads[i];
+  m_file << "\n";
+  m_file.flush();
+}
@@ -0,0 +1,143 @@
+#pragma once
+
+/*
+ *  Notices:
+ *  Copyright 2023 United States Government as represented by the
+ *  Administrator of the National Aeronautics and Space Administration.
+ *  No copyright is claimed in the United States under Title 17,
+ *  U.S. Code. All Other Rights Reserved.
+ *
+ *  Disclaimers No Warranty: THE SUBJECT SOFTWARE IS PROVIDED "AS
+ *  IS" WITHOUT ANY WARRANTY OF ANY KIND, EITHER EXPRESSED, IMPLIED,
+ *  OR STATUTORY, INCLUDING, BUT NOT LIMITED TO, ANY WARRANTY THAT
+ *  THE SUBJECT SOFTWARE WILL CONFORM TO SPECIFICATIONS, ANY IMPLIED
+ *  WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE,
+ *  OR FREEDOM FROM INFRINGEMENT, ANY WARRANTY THAT THE SUBJECT
+ *  SOFTWARE WILL BE ERROR FREE, OR ANY WARRANTY THAT DOCUMENTATION,
+ *  IF PROVIDED, WILL CONFORM TO THE SUBJECT SOFTWARE. THIS AGREEMENT
+ *  DOES NOT, IN ANY MANNER, CONSTITUTE AN ENDORSEMENT BY GOVERNMENT
+ *  AGENCY OR ANY PRIOR RECIPIENT OF ANY RESULTS, RESULTING DESIGNS,
+ *  HARDWARE, SOFTWARE PRODUCTS OR ANY OTHER APPLICATIONS RESULTING
+ *  FROM USE OF THE SUBJECT SOFTWARE.  FURTHER, GOVERNMENT AGENCY
+ *  DISCLAIMS ALL WARRANTIES AND LIABILITIES REGARDING THIRD-PARTY
+ *  SOFTWARE, IF PRESENT IN THE ORIGINAL SOFTWARE, AND DISTRIBUTES
+ *  IT "AS IS." 
+ *
+ *  Waiver and Indemnity:  RECIPIENT AGREES TO WAIVE ANY AND ALL
+ *  CLAIMS AGAINST THE UNITED STATES GOVERNMENT, ITS CONTRACTORS
+ *  AND SUBCONTRACTORS, AS WELL AS ANY PRIOR RECIPIENT.  IF RECIPIENT'S
+ *  USE OF THE SUBJECT SOFTWARE RESULTS IN ANY LIABILITIES, DEMANDS,
+ *  DAMAGES, EXPENSES OR LOSSES ARISING FROM SUCH USE, INCLUDING
+ *  ANY DAMAGES FROM PRODUCTS BASED ON, OR RESULTING FROM, RECIPIENT'S
+ *  USE OF THE SUBJECT SOFTWARE, RECIPIENT SHALL INDEMNIFY AND HOLD
+ *  HARMLESS THE UNITED STATES GOVERNMENT, ITS CONTRACTORS AND
+ *  SUBCONTRACTORS, AS WELL AS ANY PRIOR RECIPIENT, TO THE EXTENT
+ *  PERMITTED BY LAW.  RECIPIENT'S SOLE REMEDY FOR ANY SUCH MATTER
+ *  SHALL BE THE IMMEDIATE, UNILATERAL TERMINATION OF THIS AGREEMENT.
+ */
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <cstdint>
+#include <mpi.h>
+
+#include "UMesh.h"
+
+namespace VisKombyne
+{
+
+/**
+ * Integrated surface loads of boundary families.
+ *
+ * The area vectors and centroids of the owned faces of the selected
+ * boundaries are cached and only recomputed when the mesh moves.  Each
+ * evaluation integrates the pressure (relative to a reference pressure)
+ * and optionally the wall shear stress over all faces in one pass, giving
+ * the force and the moment about a center for every boundary tag.  The
+ * tag loads are reduced over all ranks and summed per family, rank 0
+ * appends them to a CSV time history.
+ *
+ * The area vectors follow the node ordering of the boundary faces, i.e.
+ * they point out of the domain, so a positive pressure pushes the body
+ * along them.
+ */
+class Loads
+{
+  public:
+    /**
+     * Constructor.
+     *
+     * @param comm  Communications object
+     * @param mesh  Mesh holding the boundaries
+     * @param families  Families whose loads are integrated
+     * @param bc_families  Family of each tag in bc_tags
+     * @param bc_tags  Boundary tags with a family
+     * @param filename  CSV file the loads are appended to
+     */
+    Loads(void* comm, UMesh& mesh, const std::vector<std::string>& families,
+          const std::vector<std::string>& bc_families,
+          const std::vector<int64_t>& bc_tags, const std::string& filename);
+
+    virtual ~Loads();
+
+    inline void referencePressure(double p) { m_pref = p; }
+    inline void center(const double c[3])
+      { m_center[0] = c[0]; m_center[1] = c[1]; m_center[2] = c[2]; }
+    inline void scale(double s) { m_scale = s; }
+
+    /**
+     * Integrate the loads.
+     *
+     * @param p  Nodal pressure
+     * @param tau  Nodal wall shear stress components, or NULL
+     */
+    void integrate(int64_t step, double time, const double* p,
+                   const double* const tau[3]);
+
+    /**
+     * Family loads of the last integration (Fx, Fy, Fz, Mx, My, Mz).
+     */
+    inline const std::vector<std::string>& families() const
+      { return m_families; }
+    inline const double* family(size_t i) const { return &m_family[6*i]; }
+
+    static const char* COMPONENTS[6];
+
+  private:
+    void cache();
+    void open();
+
+  private:
+    void* m_comm;
+    MPI_Comm m_mpi_comm;
+    UMesh& m_mesh;
+    std::vector<std::string> m_families;
+    std::string m_filename;
+    std::ofstream m_file;
+
+    double m_pref;
+    double m_center[3];
+    double m_scale;
+
+    /** Global tags of the selected families and their family */
+    std::vector<int64_t> m_tags;
+    std::vector<size_t> m_tag_family;
+
+    /**
+     * Owned faces with 4 nodes each, triangles repeat their first node with
+     * a zero weight so all faces are averaged alike.
+     */
+    int64_t m_generation;
+    std::vector<int32_t> m_face_conn;
+    std::vector<double> m_face_fourth;
+    std::vector<double> m_face_inverse;
+    std::vector<int32_t> m_face_tag;
+    std::vector<double> m_area[3];
+    std::vector<double> m_centroid[3];
+
+    std::vector<double> m_tag_loads;
+    std::vector<double> m_family;
+};
+
+} // namespace VisKombyne
@@ -0,0 +1,355 @@
+/*
+ *  Notices:
+ *  Copyright 2023 United States Government as represented by the
+ *  Administrator of the National Aeronautics and Space Administration.
+ *  No copyright is claimed in the United States under Title 17,
+ *  U.S. Code. All Other Rights Reserved.
+ *
+ *  Disclaimers No Warranty: THE SUBJECT SOFTWARE IS PROVIDED "AS
+ *  IS" WITHOUT ANY WARRANTY OF ANY KIND, EITHER EXPRESSED, IMPLIED,
+ *  OR STATUTORY, INCLUDING, BUT NOT LIMITED TO, ANY WARRANTY THAT
+ *  THE SUBJECT SOFTWARE WILL CONFORM TO SPECIFICATIONS, ANY IMPLIED
+ *  WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE,
+ *  OR FREEDOM FROM INFRINGEMENT, ANY WARRANTY THAT THE SUBJECT
+ *  SOFTWARE WILL BE ERROR FREE, OR ANY WARRANTY THAT DOCUMENTATION,
+ *  IF PROVIDED, WILL CONFORM TO THE SUBJECT SOFTWARE. THIS AGREEMENT
+ *  DOES NOT, IN ANY MANNER, CONSTITUTE AN ENDORSEMENT BY GOVERNMENT
+ *  AGENCY OR ANY PRIOR RECIPIENT OF ANY RESULTS, RESULTING DESIGNS,
+ *  HARDWARE, SOFTWARE PRODUCTS OR ANY OTHER APPLICATIONS RESULTING
+ *  FROM USE OF THE SUBJECT SOFTWARE.  FURTHER, GOVERNMENT AGENCY
+ *  DISCLAIMS ALL WARRANTIES AND LIABILITIES REGARDING THIRD-PARTY
+ *  SOFTWARE, IF PRESENT IN THE ORIGINAL SOFTWARE, AND DISTRIBUTES
+ *  IT "AS IS." 
+ *
+ *  Waiver and Indemnity:  RECIPIENT AGREES TO WAIVE ANY AND ALL
+ *  CLAIMS AGAINST THE UNITED STATES GOVERNMENT, ITS CONTRACTORS
+ *  AND SUBCONTRACTORS, AS WELL AS ANY PRIOR RECIPIENT.  IF RECIPIENT'S
+ *  USE OF THE SUBJECT SOFTWARE RESULTS IN ANY LIABILITIES, DEMANDS,
+ *  DAMAGES, EXPENSES OR LOSSES ARISING FROM SUCH USE, INCLUDING
+ *  ANY DAMAGES FROM PRODUCTS BASED ON, OR RESULTING FROM, RECIPIENT'S
+ *  USE OF THE SUBJECT SOFTWARE, RECIPIENT SHALL INDEMNIFY AND HOLD
+ *  HARMLESS THE UNITED STATES GOVERNMENT, ITS CONTRACTORS AND
+ *  SUBCONTRACTORS, AS WELL AS ANY PRIOR RECIPIENT, TO THE EXTENT
+ *  PERMITTED BY LAW.  RECIPIENT'S SOLE REMEDY FOR ANY SUCH MATTER
+ *  SHALL BE THE IMMEDIATE, UNILATERAL TERMINATION OF THIS AGREEMENT.
+ */
+
+#ifdef __GNUG__
+  #pragma implementation "NativePipeline.h"
+#endif
+
+#include <exception>
+#include <stdexcept>
+#include <cstdlib>
+#include <string>
+#include <sstream>
+#include <algorithm>
+#include <cmath>
+
+#include "NativePipeline.h"
+#include "Aggregator.h"
+#include "kombyne_data_celltype.h"
+
+using namespace VisKombyne;
+
+NativePipeline::NativePipeline(const std::string& spec, void* comm,
+                               WriteQueue* queue) :
+  m_comm(comm), m_frequency(1), m_writer(NULL)
+{
+  std::stringstream ss(spec);
+  std::string token;
+  while( ss >> token ) {
+    size_t eq = token.find('=');
+    if( std::string::npos == eq || 0 == eq )
+      throw std::runtime_error("Bad native pipeline attribute: " + token);
+    m_attributes[token.substr(0, eq)] = token.substr(eq+1);
+  }
+
+  m_type = attribute("type");
+  m_pattern = attribute("file_pattern", m_type + ".%ts");
+  m_frequency = atoi(attribute("frequency", "1").c_str());
+
+  std::string format = attribute("format", "vtk");
+  int32_t aggregators = atoi(attribute("aggregators", "0").c_str());
+  bool shared = (std::string::npos == m_pattern.find("%domain"));
+  m_writer = new Aggregator(m_comm, format, m_attributes, aggregators,
+                            shared, queue);
+}
+
+NativePipeline::~NativePipeline()
+{
+  delete m_writer;
+}
+
+NativePipeline* NativePipeline::create(const std::string& spec, void* comm,
+                                       WriteQueue* queue)
+{
+  std::stringstream ss(spec);
+  std::string token;
+  while( ss >> token ) {
+    if( 0 == token.compare(0, 5, "type=") ) {
+      std::string type = token.substr(5);
+      if( "boundary" == type )
+        return new BoundaryPipeline(spec, comm, queue);
+      if( "volume" == type )
+        return new VolumePipeline(spec, comm, queue);
+      if( "slice" == type )
+        return new SlicePipeline(spec, comm, queue);
+      if( "iso" == type )
+        return new IsoPipeline(spec, comm, queue);
+      throw std::runtime_error("Unknown native pipeline type: " + type);
+    }
+  }
+  throw std::runtime_error("Native pipeline without type: " + spec);
+}
+
+void NativePipeline::execute(UMesh& mesh, const NodalFields& fields,
+                             int64_t step)
+{
+  Extract piece;
+  extract(mesh, fields, piece);
+  m_writer->write(filename(step), piece);
+}
+
+std::string NativePipeline::attribute(const std::string& key,
+                                      const std::string& value) const
+{
+  std::map<std::string, std::string>::const_iterator it;
+  it = m_attributes.find(key);
+  return (it == m_attributes.end()) ? value : it->second;
+}
+
+std::vector<std::string> NativePipeline::strings(const std::string& key) const
+{
+  std::vector<std::string> v;
+  std::stringstream ss(attribute(key));
+  std::string item;
+  while( std::getline(ss, item, ',') )
+    if( !item.empty() )
+      v.push_back(item);
+  return v;
+}
+
+std::vector<double> NativePipeline::doubles(const std::string& key) const
+{
+  std::vector<std::string> items = strings(key);
+  std::vector<double> v(items.size());
+  for( size_t i=0; i<items.size(); ++i )
+    v[i] = atof(items[i].c_str());
+  return v;
+}
+
+std::string NativePipeline::filename(int64_t step) const
+{
+  std::string name = m_pattern;
+  std::stringstream ss;
+  ss << step;
+  size_t pos;
+  while( (pos=name.find("%ts")) != std::string::npos )
+    name.replace(pos, 3, ss.str());
+  return name;
+}
+
+
+BoundaryPipeline::BoundaryPipeline(const std::string& spec, void* comm,
+                                   WriteQueue* queue) :
+  NativePipeline(spec, comm, queue)
+{
+  m_names = strings("names");
+}
+
+void BoundaryPipeline::extract(UMesh& mesh, const NodalFields& fields,
+                               Extract& piece)
+{
+  std::vector<int32_t> map(mesh.nNodes01(), -1);
+  std::vector<int32_t> nodes;
+
+  const double* x = mesh.x();
+  const double* y = mesh.y();
+  const double* z = mesh.z();
+
+  std::vector<Boundary>& boundaries = mesh.boundaries();
+  std::vector<Boundary>::iterator it;
+  for( it = boundaries.begin(); it != boundaries.end(); ++it ) {
+    if( !m_names.empty() &&
+        std::find(m_names.begin(), m_names.end(), it->name()) == m_names.end() )
+      continue;
+
+    piece.beginPart(it->name());
+    for( int32_t shape=0; shape<2; ++shape ) {
+      const std::vector<int32_t>& faces = shape ? it->quads() : it->tris();
+      const std::vector<char>& owned = shape ? it->quadOwned()
+                                             : it->triOwned();
+      int32_t n = shape ? 4 : 3;
+      int32_t celltype = shape ? KB_CELLTYPE_QUAD : KB_CELLTYPE_TRI;
+
+      for( size_t f=0; f<owned.size(); ++f ) {
+        if( !owned[f] )
+          continue;
+        int32_t cell[4];
+        for( int32_t j=0; j<n; ++j ) {
+          int32_t node = faces[n*f+j];
+          if( -1 == map[node] ) {
+            map[node] = (int32_t)piece.addPoint(x[node], y[node], z[node]);
+            nodes.push_back(node);
+          }
+          cell[j] = map[node];
+        }
+        piece.addCell(celltype, cell, n);
+      }
+    }
+  }
+
+  NodalFields::const_iterator f;
+  for( f = fields.begin(); f != fields.end(); ++f ) {
+    std::vector<double>& values = piece.addField(f->first);
+    for( size_t i=0; i<nodes.size(); ++i )
+      values[i] = f->second[nodes[i]];
+  }
+}
+
+
+VolumePipeline::VolumePipeline(const std::string& spec, void* comm,
+                               WriteQueue* queue) :
+  NativePipeline(spec, comm, queue)
+{
+}
+
+void VolumePipeline::extract(UMesh& mesh, const NodalFields& fields,
+                             Extract& piece)
+{
+  std::vector<int32_t> map(mesh.nNodes01(), -1);
+  std::vector<int32_t> nodes;
+
+  const double* x = mesh.x();
+  const double* y = mesh.y();
+  const double* z = mesh.z();
+  const int32_t* conn = mesh.cellConnects();
+  const int32_t* owned = mesh.activeCells();
+
+  int32_t cell[8];
+  for( int64_t i=0, c=0; i<mesh.cellConnectsSize(); ++c ) {
+    int32_t celltype = conn[i++];
+    int32_t n = Extract::nodesPerCell(celltype);
+    if( owned[c] ) {
+      for( int32_t j=0; j<n; ++j ) {
+        int32_t node = conn[i+j];
+        if( -1 == map[node] ) {
+          map[node] = (int32_t)piece.addPoint(x[node], y[node], z[node]);
+          nodes.push_back(node);
+        }
+        cell[j] = map[node];
+      }
+      piece.addCell(celltype, cell, n);
+    }
+    i += n;
+  }
+
+  NodalFields::const_iterator f;
+  for( f = fields.begin(); f != fields.end(); ++f ) {
+    std::vector<double>& values = piece.addField(f->first);
+    for( size_t i=0; i<nodes.size(); ++i )
+      values[i] = f->second[nodes[i]];
+  }
+}
+
+
+SlicePipeline::SlicePipeline(const std::string& spec, void* comm,
+                             WriteQueue* queue) :
+  NativePipeline(spec, comm, queue), m_offset(0.0), m_cutter(NULL),
+  m_generation(-1)
+{
+  std::vector<double> origin = doubles("origin");
+  std::vector<double> normal = doubles("normal");
+  if( origin.empty() )
+    origin.assign(3, 0.0);
+  if( 3 != origin.size() || 3 != normal.size() )
+    throw std::runtime_error("Slice needs origin=x,y,z and normal=x,y,z");
+
+  double length = std::sqrt(normal[0]*normal[0] + normal[1]*normal[1] +
+                            normal[2]*normal[2]);
+  if( 0.0 == length )
+    throw std::runtime_error("Slice normal is zero");
+
+  for( int32_t d=0; d<3; ++d ) {
+    m_normal[d] = normal[d]/length;
+    m_offset += m_normal[d]*origin[d];
+  }
+}
+
+SlicePipeline::~SlicePipeline()
+{
+  delete m_cutter;
+}
+
+void SlicePipeline::extract(UMesh& mesh, const NodalFields& fields,
+                            Extract& piece)
+{
+  if( !m_cutter )
+    m_cutter = new Cutter(mesh);
+
+  /* The mesh may have moved on steps where the slice was not due */
+  if( mesh.generation() != m_generation ) {
+    int64_t n = mesh.nNodes01();
+    const double* x = mesh.x();
+    const double* y = mesh.y();
+    const double* z = mesh.z();
+    const double nx = m_normal[0], ny = m_normal[1], nz = m_normal[2];
+
+    m_projection.resize(n);
+    double* p = m_projection.data();
+    for( int64_t i=0; i<n; ++i )
+      p[i] = nx*x[i] + ny*y[i] + nz*z[i];
+
+    m_cutter->blockRanges(p, m_lo, m_hi);
+    m_generation = mesh.generation();
+  }
+
+  std::vector<int64_t> blocks = Cutter::candidates(m_lo, m_hi, m_offset);
+  m_cutter->cut(m_projection.data(), m_offset, blocks, fields, piece);
+}
+
+
+IsoPipeline::IsoPipeline(const std::string& spec, void* comm,
+                         WriteQueue* queue) :
+  NativePipeline(spec, comm, queue), m_cutter(NULL)
+{
+  m_field = attribute("field");
+  m_labels = strings("values");
+  m_values = doubles("values");
+  m_threads = atoi(attribute("threads", "1").c_str());
+  if( m_field.empty() || m_values.empty() )
+    throw std::runtime_error("Iso needs field=name and values=v1,v2,...");
+}
+
+IsoPipeline::~IsoPipeline()
+{
+  delete m_cutter;
+}
+
+void IsoPipeline::extract(UMesh& mesh, const NodalFields& fields,
+                          Extract& piece)
+{
+  if( !m_cutter )
+    m_cutter = new Cutter(mesh);
+
+  const double* s = NULL;
+  NodalFields::const_iterator f;
+  for( f = fields.begin(); f != fields.end(); ++f )
+    if( f->first == m_field )
+      s = f->second;
+  if( !s )
+    throw std::runtime_error("Unknown iso field: " + m_field);
+
+  std::vector<double> lo, hi;
+  m_cutter->blockRanges(s, lo, hi);
+
+  for( size_t v=0; v<m_values.size(); ++v ) {
+    std::vector<int64_t> blocks = Cutter::candidates(lo, hi, m_values[v]);
+
+    Extract surface;
+    surface.beginPart(m_field + "=" + m_labels[v]);
+    m_cutter->cut(s, m_values[v], blocks, fields, surface, m_threads);
+    piece.append(surface);
+  }
+}
@@ -0,0 +1,201 @@
+#pragma once
+
+/*
+ *  Notices:
+ *  Copyright 2023 United States Government as represented by the
+ *  Administrator of the National Aeronautics and Space Administration.
+ *  No copyright is claimed in the United States under Title 17,
+ *  U.S. Code. All Other Rights Reserved.
+ *
+ *  Disclaimers No Warranty: THE SUBJECT SOFTWARE IS PROVIDED "AS
+ *  IS" WITHOUT ANY WARRANTY OF ANY KIND, EITHER EXPRESSED, IMPLIED,
+ *  OR STATUTORY, INCLUDING, BUT NOT LIMITED TO, ANY WARRANTY THAT
+ *  THE SUBJECT SOFTWARE WILL CONFORM TO SPECIFICATIONS, ANY IMPLIED
+ *  WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE,
+ *  OR FREEDOM FROM INFRINGEMENT, ANY WARRANTY THAT THE SUBJECT
+ *  SOFTWARE WILL BE ERROR FREE, OR ANY WARRANTY THAT DOCUMENTATION,
+ *  IF PROVIDED, WILL CONFORM TO THE SUBJECT SOFTWARE. THIS AGREEMENT
+ *  DOES NOT, IN ANY MANNER, CONSTITUTE AN ENDORSEMENT BY GOVERNMENT
+ *  AGENCY OR ANY PRIOR RECIPIENT OF ANY RESULTS, RESULTING DESIGNS,
+ *  HARDWARE, SOFTWARE PRODUCTS OR ANY OTHER APPLICATIONS RESULTING
+ *  FROM USE OF THE SUBJECT SOFTWARE.  FURTHER, GOVERNMENT AGENCY
+ *  DISCLAIMS ALL WARRANTIES AND LIABILITIES REGARDING THIRD-PARTY
+ *  SOFTWARE, IF PRESENT IN THE ORIGINAL SOFTWARE, AND DISTRIBUTES
+ *  IT "AS IS." 
+ *
+ *  Waiver and Indemnity:  RECIPIENT AGREES TO WAIVE ANY AND ALL
+ *  CLAIMS AGAINST THE UNITED STATES GOVERNMENT, ITS CONTRACTORS
+ *  AND SUBCONTRACTORS, AS WELL AS ANY PRIOR RECIPIENT.  IF RECIPIENT'S
+ *  USE OF THE SUBJECT SOFTWARE RESULTS IN ANY LIABILITIES, DEMANDS,
+ *  DAMAGES, EXPENSES OR LOSSES ARISING FROM SUCH USE, INCLUDING
+ *  ANY DAMAGES FROM PRODUCTS BASED ON, OR RESULTING FROM, RECIPIENT'S
+ *  USE OF THE SUBJECT SOFTWARE, RECIPIENT SHALL INDEMNIFY AND HOLD
+ *  HARMLESS THE UNITED STATES GOVERNMENT, ITS CONTRACTORS AND
+ *  SUBCONTRACTORS, AS WELL AS ANY PRIOR RECIPIENT, TO THE EXTENT
+ *  PERMITTED BY LAW.  RECIPIENT'S SOLE REMEDY FOR ANY SUCH MATTER
+ *  SHALL BE THE IMMEDIATE, UNILATERAL TERMINATION OF THIS AGREEMENT.
+ */
+
+#include <string>
+#include <vector>
+#include <map>
+#include <cstdint>
+
+#include "UMesh.h"
+#include "Extract.h"
+#include "Writer.h"
+#include "WriteQueue.h"
+#include "Cutter.h"
+
+namespace VisKombyne
+{
+
+/**
+ * Pipeline executed by the plugin itself, independently of Kombyne.
+ *
+ * A pipeline is described by a specification string of whitespace
+ * separated key=value attributes, e.g.
+ *
+ *   "type=boundary names=wing,tail format=vtk file_pattern=bnd.%ts"
+ *
+ * Common attributes are "type", "format" (default vtk), "file_pattern"
+ * (default <type>.%ts, %ts is replaced by the solver step) and "frequency"
+ * (default 1).
+ */
+class NativePipeline
+{
+  public:
+    NativePipeline(const std::string& spec, void* comm, WriteQueue* queue);
+    virtual ~NativePipeline();
+
+    /**
+     * Create a native pipeline from its specification.
+     *
+     * @param spec  Pipeline specification
+     * @param comm  Communications object
+     * @param queue  Queue of the outputs
+     */
+    static NativePipeline* create(const std::string& spec, void* comm,
+                                  WriteQueue* queue);
+
+    inline const std::string& type() const { return m_type; }
+    inline bool due(int64_t step) const
+      { return m_frequency > 0 && 0 == step%m_frequency; }
+
+    /**
+     * Extract this rank's piece and write the pipeline output.
+     */
+    void execute(UMesh& mesh, const NodalFields& fields, int64_t step);
+
+    std::string attribute(const std::string& key,
+                          const std::string& value="") const;
+    std::vector<std::string> strings(const std::string& key) const;
+    std::vector<double> doubles(const std::string& key) const;
+
+  protected:
+    virtual void extract(UMesh& mesh, const NodalFields& fields,
+                         Extract& piece) = 0;
+    std::string filename(int64_t step) const;
+
+  protected:
+    void* m_comm;
+
+  private:
+    std::map<std::string, std::string> m_attributes;
+    std::string m_type;
+    std::string m_pattern;
+    int32_t m_frequency;
+    Writer* m_writer;
+};
+
+
+/**
+ * Owned faces of selected boundaries ("names", default all) with all
+ * nodal fields.
+ */
+class BoundaryPipeline : public NativePipeline
+{
+  public:
+    BoundaryPipeline(const std::string& spec, void* comm, WriteQueue* queue);
+
+  protected:
+    virtual void extract(UMesh& mesh, const NodalFields& fields,
+                         Extract& piece);
+
+  private:
+    std::vector<std::string> m_names;
+};
+
+
+/**
+ * Owned volume cells with all nodal fields.
+ */
+class VolumePipeline : public NativePipeline
+{
+  public:
+    VolumePipeline(const std::string& spec, void* comm, WriteQueue* queue);
+
+  protected:
+    virtual void extract(UMesh& mesh, const NodalFields& fields,
+                         Extract& piece);
+};
+
+
+
+/**
+ * Plane slice ("origin" and "normal", comma separated) of the owned volume
+ * cells with all nodal fields interpolated.
+ *
+ * The projections of the nodes on the normal and their ranges over the cell
+ * blocks are kept until the grid moves, so a slice only visits the blocks
+ * that straddle the plane.
+ */
+class SlicePipeline : public NativePipeline
+{
+  public:
+    SlicePipeline(const std::string& spec, void* comm, WriteQueue* queue);
+    virtual ~SlicePipeline();
+
+  protected:
+    virtual void extract(UMesh& mesh, const NodalFields& fields,
+                         Extract& piece);
+
+  private:
+    double m_normal[3];
+    double m_offset;
+    Cutter* m_cutter;
+    std::vector<double> m_projection;
+    std::vector<double> m_lo;
+    std::vector<double> m_hi;
+    int64_t m_generation;
+};
+
+
+
+/**
+ * Isosurfaces of a nodal field ("field") at one or more values ("values",
+ * comma separated) with all nodal fields interpolated, one part per value.
+ *
+ * A min/max index of the field over the cell blocks is built on each step
+ * so that only the candidate blocks are visited; they are cut by "threads"
+ * threads (default 1).
+ */
+class IsoPipeline : public NativePipeline
+{
+  public:
+    IsoPipeline(const std::string& spec, void* comm, WriteQueue* queue);
+    virtual ~IsoPipeline();
+
+  protected:
+    virtual void extract(UMesh& mesh, const NodalFields& fields,
+                         Extract& piece);
+
+  private:
+    std::string m_field;
+    std::vector<std::string> m_labels;
+    std::vector<double> m_values;
+    int32_t m_threads;
+    Cutter* m_cutter;
+};
+
+} // namespace VisKombyne
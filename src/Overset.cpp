@@ -0,0 +1,122 @@
+/*
+ *  Notices:
+ *  Copyright 2023 United States Government as represented by the
+ *  Administrator of the National Aeronautics and Space Administration.
+ *  No copyright is claimed in the United States under Title 17,
+ *  U.S. Code. All Other Rights Reserved.
+ *
+ *  Disclaimers No Warranty: THE SUBJECT SOFTWARE IS PROVIDED "AS
+ *  IS" WITHOUT ANY WARRANTY OF ANY KIND, EITHER EXPRESSED, IMPLIED,
+ *  OR STATUTORY, INCLUDING, BUT NOT LIMITED TO, ANY WARRANTY THAT
+ *  THE SUBJECT SOFTWARE WILL CONFORM TO SPECIFICATIONS, ANY IMPLIED
+ *  WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE,
+ *  OR FREEDOM FROM INFRINGEMENT, ANY WARRANTY THAT THE SUBJECT
+ *  SOFTWARE WILL BE ERROR FREE, OR ANY WARRANTY THAT DOCUMENTATION,
+ *  IF PROVIDED, WILL CONFORM TO THE SUBJECT SOFTWARE. THIS AGREEMENT
+ *  DOES NOT, IN ANY MANNER, CONSTITUTE AN ENDORSEMENT BY GOVERNMENT
+ *  AGENCY OR ANY PRIOR RECIPIENT OF ANY RESULTS, RESULTING DESIGNS,
+ *  HARDWARE, SOFTWARE PRODUCTS OR ANY OTHER APPLICATIONS RESULTING
+ *  FROM USE OF THE SUBJECT SOFTWARE.  FURTHER, GOVERNMENT AGENCY
+ *  DISCLAIMS ALL WARRANTIES AND LIABILITIES REGARDING THIRD-PARTY
+ *  SOFTWARE, IF PRESENT IN THE ORIGINAL SOFTWARE, AND DISTRIBUTES
+ *  IT "AS IS." 
+ *
+ *  Waiver and Indemnity:  RECIPIENT AGREES TO WAIVE ANY AND ALL
+ *  CLAIMS AGAINST THE UNITED STATES GOVERNMENT, ITS CONTRACTORS
+ *  AND SUBCONTRACTORS, AS WELL AS ANY PRIOR RECIPIENT.  IF RECIPIENT'S
+ *  USE OF THE SUBJECT SOFTWARE RESULTS IN ANY LIABILITIES, DEMANDS,
+ *  DAMAGES, EXPENSES OR LOSSES ARISING FROM SUCH USE, INCLUDING
+ *  ANY DAMAGES FROM PRODUCTS BASED ON, OR RESULTING FROM, RECIPIENT'S
+ *  USE OF THE SUBJECT SOFTWARE, RECIPIENT SHALL INDEMNIFY AND HOLD
+ *  HARMLESS THE UNITED STATES GOVERNMENT, ITS CONTRACTORS AND
+ *  SUBCONTRACTORS, AS WELL AS ANY PRIOR RECIPIENT, TO THE EXTENT
+ *  PERMITTED BY LAW.  RECIPIENT'S SOLE REMEDY FOR ANY SUCH MATTER
+ *  SHALL BE THE IMMEDIATE, UNILATERAL TERMINATION OF THIS AGREEMENT.
+ */
+
+#ifdef __GNUG__
+  #pragma implementation "Overset.h"
+#endif
+
+#include <exception>
+#include <stdexcept>
+#include <sstream>
+#include <iostream>
+#include <algorithm>
+
+#include "Overset.h"
+#include "Extract.h"
+#include "tinf_iris.h"
+#include "tinf_domain_assembler.h"
+#include "TinfCheck.h"
+
+using namespace VisKombyne;
+
+Overset::Overset(void* mesh, void* comm, UMesh& umesh,
+                 const std::vector<int32_t>& status) :
+  m_comm(comm), m_assembler(NULL), m_mesh(umesh), m_status(status),
+  m_generation(-1)
+{
+  int32_t error;
+
+  int32_t fcomm = tinf_iris_get_mpi_fcomm(m_comm, &error);
+  TINF_CHECK_SUCCESS(error, "Could not get Fortran communicator");
+
+  m_assembler = tinf_create_domain_assembler(mesh, fcomm);
+  if( NULL == m_assembler )
+    throw std::runtime_error("Could not create domain assembler");
+
+  assemble();
+}
+
+Overset::~Overset()
+{
+  if( m_assembler )
+    tinf_destroy_domain_assembler(m_assembler);
+}
+
+void Overset::update()
+{
+  if( m_mesh.generation() != m_generation )
+    assemble();
+}
+
+void Overset::assemble()
+{
+  int32_t error;
+
+  tinf_perform_domain_assembly(m_assembler);
+
+  int64_t nnodes = m_mesh.nNodes01();
+  std::vector<char> blank(nnodes);
+  for( int64_t i=0; i<nnodes; ++i ) {
+    int32_t status = tinf_get_node_status(m_assembler, i);
+    blank[i] = std::find(m_status.begin(), m_status.end(), status) !=
+               m_status.end();
+  }
+
+  const int32_t* conn = m_mesh.cellConnects();
+  const int32_t* owned = m_mesh.ghostCells();
+  std::vector<char> blanked(m_mesh.nCell01(), 0);
+  double count[2] = {0.0, 0.0};
+  int64_t c = 0;
+  for( int64_t i=0; i<m_mesh.cellConnectsSize(); ++c ) {
+    int32_t n = Extract::nodesPerCell(conn[i++]);
+    for( int32_t j=0; j<n; ++j, ++i )
+      blanked[c] |= blank[conn[i]];
+    count[0] += owned[c] && blanked[c];
+    count[1] += owned[c];
+  }
+  m_mesh.blankCells(blanked);
+
+  double global[2];
+  size_t dims[TINF_DATA_MAX_RANK] = {2, 1};
+  error = tinf_iris_sum(m_comm, TINF_DOUBLE, 1, dims, count, global);
+  TINF_CHECK_SUCCESS(error, "Could not reduce blanked cells");
+
+  if( 0 == tinf_iris_rank(m_comm, &error) )
+    std::cerr << "Overset blanking: " << (int64_t)global[0] << " of "
+              << (int64_t)global[1] << " cells" << std::endl;
+
+  m_generation = m_mesh.generation();
+}
@@ -0,0 +1,352 @@
+/*
+ *  Notices:
+ *  Copyright 2023 United States Government as represented by the
+ *  Administrator of the National Aeronautics and Space Administration.
+ *  No copyright is claimed in the United States under Title 17,
+ *  U.S. Code. All Other Rights Reserved.
+ *
+ *  Disclaimers No Warranty: THE SUBJECT SOFTWARE IS PROVIDED "AS
+ *  IS" WITHOUT ANY WARRANTY OF ANY KIND, EITHER EXPRESSED, IMPLIED,
+ *  OR STATUTORY, INCLUDING, BUT NOT LIMITED TO, ANY WARRANTY THAT
+ *  THE SUBJECT SOFTWARE WILL CONFORM TO SPECIFICATIONS, ANY IMPLIED
+ *  WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE,
+ *  OR FREEDOM FROM INFRINGEMENT, ANY WARRANTY THAT THE SUBJECT
+ *  SOFTWARE WILL BE ERROR FREE, OR ANY WARRANTY THAT DOCUMENTATION,
+ *  IF PROVIDED, WILL CONFORM TO THE SUBJECT SOFTWARE. THIS AGREEMENT
+ *  DOES NOT, IN ANY MANNER, CONSTITUTE AN ENDORSEMENT BY GOVERNMENT
+ *  AGENCY OR ANY PRIOR RECIPIENT OF ANY RESULTS, RESULTING DESIGNS,
+ *  HARDWARE, SOFTWARE PRODUCTS OR ANY OTHER APPLICATIONS RESULTING
+ *  FROM USE OF THE SUBJECT SOFTWARE.  FURTHER, GOVERNMENT AGENCY
+ *  DISCLAIMS ALL WARRANTIES AND LIABILITIES REGARDING THIRD-PARTY
+ *  SOFTWARE, IF PRESENT IN THE ORIGINAL SOFTWARE, AND DISTRIBUTES
+ *  IT "AS IS." 
+ *
+ *  Waiver and Indemnity:  RECIPIENT AGREES TO WAIVE ANY AND ALL
+ *  CLAIMS AGAINST THE UNITED STATES GOVERNMENT, ITS CONTRACTORS
+ *  AND SUBCONTRACTORS, AS WELL AS ANY PRIOR RECIPIENT.  IF RECIPIENT'S
+ *  USE OF THE SUBJECT SOFTWARE RESULTS IN ANY LIABILITIES, DEMANDS,
+ *  DAMAGES, EXPENSES OR LOSSES ARISING FROM SUCH USE, INCLUDING
+ *  ANY DAMAGES FROM PRODUCTS BASED ON, OR RESULTING FROM, RECIPIENT'S
+ *  USE OF THE SUBJECT SOFTWARE, RECIPIENT SHALL INDEMNIFY AND HOLD
+ *  HARMLESS THE UNITED STATES GOVERNMENT, ITS CONTRACTORS AND
+ *  SUBCONTRACTORS, AS WELL AS ANY PRIOR RECIPIENT, TO THE EXTENT
+ *  PERMITTED BY LAW.  RECIPIENT'S SOLE REMEDY FOR ANY SUCH MATTER
+ *  SHALL BE THE IMMEDIATE, UNILATERAL TERMINATION OF THIS AGREEMENT.
+ */
+
+#ifdef __GNUG__
+  #pragma implementation "Probes.h"
+#endif
+
+#include <exception>
+#include <stdexcept>
+#include <sstream>
+#include <iostream>
+#include <algorithm>
+#include <limits>
+#include <cstring>
+#include <cmath>
+#include <cfloat>
+
+#include "Probes.h"
+#include "BVH.h"
+#include "tinf_iris.h"
+#include "kombyne_data_celltype.h"
+#include "TinfCheck.h"
+
+using namespace VisKombyne;
+
+const char Probes::MAGIC[8] = {'K','B','P','R','O','B','E','\0'};
+
+namespace
+{
+
+/**
+ * Decomposition of the cell types into tetrahedra of their nodes, the hex
+ * is split around its 0-6 diagonal.
+ */
+const int32_t TET[1][4]   = {{0,1,2,3}};
+const int32_t PYR[2][4]   = {{0,1,2,4}, {0,2,3,4}};
+const int32_t WEDGE[3][4] = {{0,1,2,3}, {1,2,3,4}, {2,3,4,5}};
+const int32_t HEX[6][4]   = {{0,1,2,6}, {0,2,3,6}, {0,3,7,6},
+                             {0,7,4,6}, {0,4,5,6}, {0,5,1,6}};
+
+const double EPSILON = 1.0e-10;
+
+int32_t tetrahedra(int32_t celltype, const int32_t (**tets)[4])
+{
+  switch( celltype ) {
+    case KB_CELLTYPE_TET:   *tets = TET;   return 1;
+    case KB_CELLTYPE_PYR:   *tets = PYR;   return 2;
+    case KB_CELLTYPE_WEDGE: *tets = WEDGE; return 3;
+    case KB_CELLTYPE_HEX:   *tets = HEX;   return 6;
+  }
+  return 0;
+}
+
+/*
+ * Barycentric weights of a point in a tetrahedron, false when the point is
+ * outside or the tetrahedron is degenerate.
+ */
+bool barycentric(const double p[3], const double v[4][3], double w[4])
+{
+  double a[3][3];
+  for( int32_t i=0; i<3; ++i )
+    for( int32_t d=0; d<3; ++d )
+      a[d][i] = v[i+1][d] - v[0][d];
+  double r[3] = {p[0]-v[0][0], p[1]-v[0][1], p[2]-v[0][2]};
+
+  double det = a[0][0]*(a[1][1]*a[2][2] - a[1][2]*a[2][1])
+             - a[0][1]*(a[1][0]*a[2][2] - a[1][2]*a[2][0])
+             + a[0][2]*(a[1][0]*a[2][1] - a[1][1]*a[2][0]);
+  if( std::fabs(det) < DBL_MIN )
+    return false;
+
+  /* Cramer's rule */
+  for( int32_t i=0; i<3; ++i ) {
+    double m[3][3];
+    memcpy(m, a, sizeof(m));
+    for( int32_t d=0; d<3; ++d )
+      m[d][i] = r[d];
+    w[i+1] = (m[0][0]*(m[1][1]*m[2][2] - m[1][2]*m[2][1])
+            - m[0][1]*(m[1][0]*m[2][2] - m[1][2]*m[2][0])
+            + m[0][2]*(m[1][0]*m[2][1] - m[1][1]*m[2][0]))/det;
+  }
+  w[0] = 1.0 - w[1] - w[2] - w[3];
+
+  for( int32_t i=0; i<4; ++i )
+    if( w[i] < -EPSILON )
+      return false;
+  return true;
+}
+
+} // namespace
+
+
+Probes::Probes(void* comm, UMesh& mesh, const std::vector<double>& points,
+               const std::vector<std::string>& fields,
+               const std::string& filename, bool binary) :
+  m_comm(comm), m_mesh(mesh), m_points(points), m_names(fields),
+  m_filename(filename), m_binary(binary), m_generation(-1)
+{
+  if( 0 != m_points.size()%3 )
+    throw std::runtime_error("Probe coordinates must be given as triplets");
+
+  locate();
+
+  int32_t error;
+  if( 0 == tinf_iris_rank(m_comm, &error) )
+    open();
+}
+
+Probes::~Probes()
+{
+  if( m_file.is_open() )
+    m_file.close();
+}
+
+void Probes::locate()
+{
+  int32_t error;
+
+  const int32_t* conn = m_mesh.cellConnects();
+  const int32_t* owned = m_mesh.activeCells();
+  const double* x = m_mesh.x();
+  const double* y = m_mesh.y();
+  const double* z = m_mesh.z();
+
+  /* Boxes of the owned cells */
+  std::vector<double> boxes;
+  std::vector<int64_t> offsets;
+  int64_t c = 0;
+  for( int64_t i=0; i<m_mesh.cellConnectsSize(); ++c ) {
+    int32_t n = Extract::nodesPerCell(conn[i]);
+    if( owned[c] ) {
+      double box[6] = {DBL_MAX, DBL_MAX, DBL_MAX, -DBL_MAX, -DBL_MAX, -DBL_MAX};
+      for( int32_t j=0; j<n; ++j ) {
+        int32_t node = conn[i+1+j];
+        double p[3] = {x[node], y[node], z[node]};
+        for( int32_t d=0; d<3; ++d ) {
+          box[d] = std::min(box[d], p[d] - EPSILON);
+          box[d+3] = std::max(box[d+3], p[d] + EPSILON);
+        }
+      }
+      boxes.insert(boxes.end(), box, box+6);
+      offsets.push_back(i);
+    }
+    i += n + 1;
+  }
+
+  BVH bvh(boxes);
+
+  int64_t nprobes = size();
+  std::vector<int32_t> nodes(4*nprobes, 0);
+  std::vector<double> weights(4*nprobes, 0.0);
+  std::vector<int32_t> found(nprobes, 0);
+
+  std::vector<int64_t> items;
+  for( int64_t p=0; p<nprobes; ++p ) {
+    const double* point = &m_points[3*p];
+    bvh.query(point, items);
+
+    std::vector<int64_t>::iterator it;
+    for(it = items.begin(); !found[p] && it != items.end(); ++it) {
+      const int32_t* cell = conn + offsets[*it];
+      const int32_t (*tets)[4];
+      int32_t ntets = tetrahedra(cell[0], &tets);
+      for( int32_t t=0; !found[p] && t<ntets; ++t ) {
+        double v[4][3];
+        for( int32_t k=0; k<4; ++k ) {
+          int32_t node = cell[1+tets[t][k]];
+          v[k][0] = x[node];
+          v[k][1] = y[node];
+          v[k][2] = z[node];
+        }
+        if( barycentric(point, v, &weights[4*p]) ) {
+          for( int32_t k=0; k<4; ++k )
+            nodes[4*p+k] = cell[1+tets[t][k]];
+          found[p] = 1;
+        }
+      }
+    }
+  }
+
+  /* Probes on partition boundaries belong to the lowest rank holding them */
+  int32_t rank = tinf_iris_rank(m_comm, &error);
+  int32_t nprocs = tinf_iris_number_of_processes(m_comm, &error);
+  std::vector<int32_t> local(nprobes), owner(nprobes);
+  for( int64_t p=0; p<nprobes; ++p )
+    local[p] = found[p] ? rank : nprocs;
+
+  if( nprobes > 0 ) {
+    size_t dims[TINF_DATA_MAX_RANK] = {(size_t)nprobes, 1};
+    error = tinf_iris_min(m_comm, TINF_INT32, 1, dims, local.data(),
+                          owner.data());
+    TINF_CHECK_SUCCESS(error, "Could not reduce probe owners");
+  }
+
+  m_owned.clear();
+  m_nodes.clear();
+  m_weights.clear();
+  m_found.assign(nprobes, 1);
+  int64_t missing = 0;
+  for( int64_t p=0; p<nprobes; ++p ) {
+    if( owner[p] == nprocs ) {
+      m_found[p] = 0;
+      ++missing;
+    }
+    if( owner[p] != rank )
+      continue;
+    m_owned.push_back(p);
+    m_nodes.insert(m_nodes.end(), &nodes[4*p], &nodes[4*p+4]);
+    m_weights.insert(m_weights.end(), &weights[4*p], &weights[4*p+4]);
+  }
+
+  if( missing > 0 && 0 == rank )
+    std::cerr << "Probes: " << missing << " of " << nprobes
+              << " probes are outside of the mesh" << std::endl;
+
+  m_generation = m_mesh.generation();
+}
+
+void Probes::open()
+{
+  std::ifstream existing(m_filename.c_str(), std::ios::binary);
+  bool append = existing.good() &&
+                existing.peek() != std::ifstream::traits_type::eof();
+  existing.close();
+
+  std::ios::openmode mode = std::ios::out | std::ios::app;
+  if( m_binary )
+    mode |= std::ios::binary;
+  m_file.open(m_filename.c_str(), mode);
+  if( !m_file )
+    throw std::runtime_error("Could not open probe file " + m_filename);
+
+  /* Restarted runs keep appending to the same history */
+  if( append )
+    return;
+
+  int64_t nprobes = size();
+  if( m_binary ) {
+    int64_t nfields = m_names.size();
+    m_file.write(MAGIC, sizeof(MAGIC));
+    m_file.write((const char*)&nprobes, sizeof(nprobes));
+    m_file.write((const char*)&nfields, sizeof(nfields));
+    std::vector<std::string>::iterator it;
+    for(it = m_names.begin(); it != m_names.end(); ++it) {
+      char name[64] = {0};
+      strncpy(name, it->c_str(), sizeof(name)-1);
+      m_file.write(name, sizeof(name));
+    }
+    m_file.write((const char*)m_points.data(), nprobes*3*sizeof(double));
+  } else {
+    m_file << "step,time,probe,x,y,z";
+    std::vector<std::string>::iterator it;
+    for(it = m_names.begin(); it != m_names.end(); ++it)
+      m_file << "," << *it;
+    m_file << std::endl;
+  }
+}
+
+void Probes::sample(int64_t step, double time, const NodalFields& fields)
+{
+  int32_t error;
+
+  if( fields.size() != m_names.size() )
+    throw std::runtime_error("Probe fields do not match the probe names");
+
+  if( m_mesh.generation() != m_generation )
+    locate();
+
+  int64_t nprobes = size();
+  size_t nfields = fields.size();
+  if( 0 == nprobes || 0 == nfields )
+    return;
+
+  std::vector<double> local(nprobes*nfields, 0.0);
+  for( size_t o=0; o<m_owned.size(); ++o ) {
+    int64_t p = m_owned[o];
+    const int32_t* nodes = &m_nodes[4*o];
+    const double* weights = &m_weights[4*o];
+    for( size_t f=0; f<nfields; ++f ) {
+      const double* values = fields[f].second;
+      local[p*nfields+f] = weights[0]*values[nodes[0]] +
+                           weights[1]*values[nodes[1]] +
+                           weights[2]*values[nodes[2]] +
+                           weights[3]*values[nodes[3]];
+    }
+  }
+
+  std::vector<double> global(local.size());
+  size_t dims[TINF_DATA_MAX_RANK] = {local.size(), 1};
+  error = tinf_iris_sum(m_comm, TINF_DOUBLE, 1, dims, local.data(),
+                        global.data());
+  TINF_CHECK_SUCCESS(error, "Could not reduce probe samples");
+
+  if( 0 != tinf_iris_rank(m_comm, &error) )
+    return;
+
+  /* Probes outside of the mesh are reported as NaN */
+  for( int64_t p=0; p<nprobes; ++p )
+    if( !m_found[p] )
+      std::fill(&global[p*nfields], &global[(p+1)*nfields],
+                std::numeric_limits<double>::quiet_NaN());
+
+  if( m_binary ) {
+    m_file.write((const char*)&step, sizeof(step));
+    m_file.write((const char*)&time, sizeof(time));
+    m_file.write((const char*)global.data(), global.size()*sizeof(double));
+  } else {
+    m_file.precision(std::numeric_limits<double>::digits10 + 2);
+    for( int64_t p=0; p<nprobes; ++p ) {
+      m_file << step << "," << time << "," << p << ","
+             << m_points[3*p] << "," << m_points[3*p+1] << ","
+             << m_points[3*p+2];
+      for( size_t f=0; f<nfields; ++f )
+        m_file << "," << global[p*nfields+f];
+      m_file << "\n";
+    }
+  }
+  m_file.flush();
+}
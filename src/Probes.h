@@ -0,0 +1,112 @@
+#pragma once
+
+/*
+ *  Notices:
+ *  Copyright 2023 United States Government as represented by the
+ *  Administrator of the National Aeronautics and Space Administration.
+ *  No copyright is claimed in the United States under Title 17,
+ *  U.S. Code. All Other Rights Reserved.
+ *
+ *  Disclaimers No Warranty: THE SUBJECT SOFTWARE IS PROVIDED "AS
+ *  IS" WITHOUT ANY WARRANTY OF ANY KIND, EITHER EXPRESSED, IMPLIED,
+ *  OR STATUTORY, INCLUDING, BUT NOT LIMITED TO, ANY WARRANTY THAT
+ *  THE SUBJECT SOFTWARE WILL CONFORM TO SPECIFICATIONS, ANY IMPLIED
+ *  WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE,
+ *  OR FREEDOM FROM INFRINGEMENT, ANY WARRANTY THAT THE SUBJECT
+ *  SOFTWARE WILL BE ERROR FREE, OR ANY WARRANTY THAT DOCUMENTATION,
+ *  IF PROVIDED, WILL CONFORM TO THE SUBJECT SOFTWARE. THIS AGREEMENT
+ *  DOES NOT, IN ANY MANNER, CONSTITUTE AN ENDORSEMENT BY GOVERNMENT
+ *  AGENCY OR ANY PRIOR RECIPIENT OF ANY RESULTS, RESULTING DESIGNS,
+ *  HARDWARE, SOFTWARE PRODUCTS OR ANY OTHER APPLICATIONS RESULTING
+ *  FROM USE OF THE SUBJECT SOFTWARE.  FURTHER, GOVERNMENT AGENCY
+ *  DISCLAIMS ALL WARRANTIES AND LIABILITIES REGARDING THIRD-PARTY
+ *  SOFTWARE, IF PRESENT IN THE ORIGINAL SOFTWARE, AND DISTRIBUTES
+ *  IT "AS IS." 
+ *
+ *  Waiver and Indemnity:  RECIPIENT AGREES TO WAIVE ANY AND ALL
+ *  CLAIMS AGAINST THE UNITED STATES GOVERNMENT, ITS CONTRACTORS
+ *  AND SUBCONTRACTORS, AS WELL AS ANY PRIOR RECIPIENT.  IF RECIPIENT'S
+ *  USE OF THE SUBJECT SOFTWARE RESULTS IN ANY LIABILITIES, DEMANDS,
+ *  DAMAGES, EXPENSES OR LOSSES ARISING FROM SUCH USE, INCLUDING
+ *  ANY DAMAGES FROM PRODUCTS BASED ON, OR RESULTING FROM, RECIPIENT'S
+ *  USE OF THE SUBJECT SOFTWARE, RECIPIENT SHALL INDEMNIFY AND HOLD
+ *  HARMLESS THE UNITED STATES GOVERNMENT, ITS CONTRACTORS AND
+ *  SUBCONTRACTORS, AS WELL AS ANY PRIOR RECIPIENT, TO THE EXTENT
+ *  PERMITTED BY LAW.  RECIPIENT'S SOLE REMEDY FOR ANY SUCH MATTER
+ *  SHALL BE THE IMMEDIATE, UNILATERAL TERMINATION OF THIS AGREEMENT.
+ */
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <cstdint>
+
+#include "UMesh.h"
+#include "Extract.h"
+
+namespace VisKombyne
+{
+
+/**
+ * Time histories of nodal fields at fixed probe points.
+ *
+ * Each probe is located once in a bounding volume hierarchy of the owned
+ * cells, the owning rank caches the nodes and the barycentric weights of
+ * the sub-tetrahedron holding the point.  The location is only repeated
+ * when the mesh coordinates change.  Every sample interpolates all fields
+ * at all probes with a single reduction, rank 0 appends the samples to a
+ * CSV or binary file.
+ */
+class Probes
+{
+  public:
+    /**
+     * Constructor.
+     *
+     * @param comm  Communications object
+     * @param mesh  Mesh the probes are located in
+     * @param points  Probe coordinates (x, y, z per probe)
+     * @param fields  Names of the sampled fields
+     * @param filename  File the samples are appended to
+     * @param binary  Binary instead of CSV samples
+     */
+    Probes(void* comm, UMesh& mesh, const std::vector<double>& points,
+           const std::vector<std::string>& fields,
+           const std::string& filename, bool binary);
+
+    virtual ~Probes();
+
+    inline int64_t size() const { return m_points.size()/3; }
+    inline const std::vector<std::string>& fields() const { return m_names; }
+
+    /**
+     * Sample the fields, in the order of the names given at construction.
+     */
+    void sample(int64_t step, double time, const NodalFields& fields);
+
+    static const char MAGIC[8];
+
+  private:
+    void locate();
+    void open();
+
+  private:
+    void* m_comm;
+    UMesh& m_mesh;
+    std::vector<double> m_points;
+    std::vector<std::string> m_names;
+    std::string m_filename;
+    bool m_binary;
+    std::ofstream m_file;
+
+    /** Mesh generation of the cached location */
+    int64_t m_generation;
+    /** Probes owned by this rank, with 4 nodes and 4 weights each */
+    std::vector<int64_t> m_owned;
+    std::vector<int32_t> m_nodes;
+    std::vector<double> m_weights;
+    /** Probes located in the mesh */
+    std::vector<char> m_found;
+};
+
+} // namespace VisKombyne
@@ -0,0 +1,255 @@
+/*
+ *  Notices:
+ *  Copyright 2023 United States Government as represented by the
+ *  Administrator of the National Aeronautics and Space Administration.
+ *  No copyright is claimed in the United States under Title 17,
+ *  U.S. Code. All Other Rights Reserved.
+ *
+ *  Disclaimers No Warranty: THE SUBJECT SOFTWARE IS PROVIDED "AS
+ *  IS" WITHOUT ANY WARRANTY OF ANY KIND, EITHER EXPRESSED, IMPLIED,
+ *  OR STATUTORY, INCLUDING, BUT NOT LIMITED TO, ANY WARRANTY THAT
+ *  THE SUBJECT SOFTWARE WILL CONFORM TO SPECIFICATIONS, ANY IMPLIED
+ *  WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE,
+ *  OR FREEDOM FROM INFRINGEMENT, ANY WARRANTY THAT THE SUBJECT
+ *  SOFTWARE WILL BE ERROR FREE, OR ANY WARRANTY THAT DOCUMENTATION,
+ *  IF PROVIDED, WILL CONFORM TO THE SUBJECT SOFTWARE. THIS AGREEMENT
+ *  DOES NOT, IN ANY MANNER, CONSTITUTE AN ENDORSEMENT BY GOVERNMENT
+ *  AGENCY OR ANY PRIOR RECIPIENT OF ANY RESULTS, RESULTING DESIGNS,
+ *  HARDWARE, SOFTWARE PRODUCTS OR ANY OTHER APPLICATIONS RESULTING
+ *  FROM USE OF THE SUBJECT SOFTWARE.  FURTHER, GOVERNMENT AGENCY
+ *  DISCLAIMS ALL WARRANTIES AND LIABILITIES REGARDING THIRD-PARTY
+ *  SOFTWARE, IF PRESENT IN THE ORIGINAL SOFTWARE, AND DISTRIBUTES
+ *  IT "AS IS." 
+ *
+ *  Waiver and Indemnity:  RECIPIENT AGREES TO WAIVE ANY AND ALL
+ *  CLAIMS AGAINST THE UNITED STATES GOVERNMENT, ITS CONTRACTORS
+ *  AND SUBCONTRACTORS, AS WELL AS ANY PRIOR RECIPIENT.  IF RECIPIENT'S
+ *  USE OF THE SUBJECT SOFTWARE RESULTS IN ANY LIABILITIES, DEMANDS,
+ *  DAMAGES, EXPENSES OR LOSSES ARISING FROM SUCH USE, INCLUDING
+ *  ANY DAMAGES FROM PRODUCTS BASED ON, OR RESULTING FROM, RECIPIENT'S
+ *  USE OF THE SUBJECT SOFTWARE, RECIPIENT SHALL INDEMNIFY AND HOLD
+ *  HARMLESS THE UNITED STATES GOVERNMENT, ITS CONTRACTORS AND
+ *  SUBCONTRACTORS, AS WELL AS ANY PRIOR RECIPIENT, TO THE EXTENT
+ *  PERMITTED BY LAW.  RECIPIENT'S SOLE REMEDY FOR ANY SUCH MATTER
+ *  SHALL BE THE IMMEDIATE, UNILATERAL TERMINATION OF THIS AGREEMENT.
+ */
+
+#ifdef __GNUG__
+  #pragma implementation "Region.h"
+#endif
+
+#include <exception>
+#include <stdexcept>
+#include <algorithm>
+
+#include "Region.h"
+#include "Extract.h"
+
+using namespace VisKombyne;
+
+Region::Region(UMesh& mesh) :
+  m_mesh(mesh), m_has_box(false), m_has_sphere(false), m_layers(0),
+  m_generation(-1)
+{
+}
+
+void Region::box(const double box[6])
+{
+  std::copy(box, box+6, m_box);
+  m_has_box = true;
+}
+
+void Region::sphere(const double sphere[4])
+{
+  std::copy(sphere, sphere+4, m_sphere);
+  m_has_sphere = true;
+}
+
+bool Region::inside(double x, double y, double z) const
+{
+  if( m_has_box && x >= m_box[0] && y >= m_box[1] && z >= m_box[2] &&
+      x <= m_box[3] && y <= m_box[4] && z <= m_box[5] )
+    return true;
+
+  if( m_has_sphere ) {
+    double dx = x - m_sphere[0], dy = y - m_sphere[1], dz = z - m_sphere[2];
+    if( dx*dx + dy*dy + dz*dz <= m_sphere[3]*m_sphere[3] )
+      return true;
+  }
+  return false;
+}
+
+void Region::update()
+{
+  if( m_mesh.generation() != m_generation )
+    select();
+
+  const double* x = m_mesh.x();
+  const double* y = m_mesh.y();
+  const double* z = m_mesh.z();
+  for( size_t i=0; i<m_nodes.size(); ++i ) {
+    m_x[i] = x[m_nodes[i]];
+    m_y[i] = y[m_nodes[i]];
+    m_z[i] = z[m_nodes[i]];
+  }
+}
+
+/*
+ * Give the ghost copies of the node marks the value of their owner.  The
+ * owner holds every cell around its nodes, so its marks are complete.
+ */
+void Region::syncMarked(std::vector<char>& marked)
+{
+  std::vector<double> values(marked.begin(), marked.end());
+  m_mesh.syncNodes(values.data());
+  for( size_t i=0; i<marked.size(); ++i )
+    marked[i] = (0.0 != values[i]);
+}
+
+void Region::select()
+{
+  const int32_t* conn = m_mesh.cellConnects();
+  const int32_t* ghost = m_mesh.ghostCells();
+  const double* x = m_mesh.x();
+  const double* y = m_mesh.y();
+  const double* z = m_mesh.z();
+  int64_t nnodes = m_mesh.nNodes01();
+  int64_t ncells = m_mesh.nCell01();
+
+  /* Seed nodes: in the box or sphere, or on a selected boundary */
+  std::vector<char> marked(nnodes, 0);
+  for( int64_t i=0; i<nnodes; ++i )
+    marked[i] = inside(x[i], y[i], z[i]);
+
+  std::vector<Boundary>& bound = m_mesh.boundaries();
+  std::vector<Boundary>::iterator b;
+  for(b = bound.begin(); b != bound.end(); ++b) {
+    if( std::find(m_tags.begin(), m_tags.end(), b->tag()) == m_tags.end() )
+      continue;
+    std::vector<int32_t>::iterator n;
+    for(n = b->tris().begin(); n != b->tris().end(); ++n)
+      marked[*n] = 1;
+    for(n = b->quads().begin(); n != b->quads().end(); ++n)
+      marked[*n] = 1;
+  }
+  if( defined() )
+    syncMarked(marked);
+
+  std::vector<int64_t> offsets(ncells);
+  for( int64_t i=0, c=0; c<ncells; ++c ) {
+    offsets[c] = i;
+    i += Extract::nodesPerCell(conn[i]) + 1;
+  }
+
+  /* Cells touching a marked node, each layer marks the nodes of the cells
+   * selected so far and exchanges the marks so that the growth crosses the
+   * partition boundaries.  Without criteria all cells are selected. */
+  std::vector<char> selected(ncells, !defined());
+  for( int32_t layer=0; defined() && layer<=m_layers; ++layer ) {
+    for( int64_t c=0; c<ncells; ++c ) {
+      const int32_t* cell = conn + offsets[c];
+      int32_t n = Extract::nodesPerCell(cell[0]);
+      for( int32_t j=1; !selected[c] && j<=n; ++j )
+        selected[c] = marked[cell[j]];
+    }
+    if( layer == m_layers )
+      break;
+    for( int64_t c=0; c<ncells; ++c ) {
+      if( !selected[c] )
+        continue;
+      const int32_t* cell = conn + offsets[c];
+      int32_t n = Extract::nodesPerCell(cell[0]);
+      for( int32_t j=1; j<=n; ++j )
+        marked[cell[j]] = 1;
+    }
+    syncMarked(marked);
+  }
+
+  /* Cells blanked by an overset assembly are never shown */
+  for( int64_t c=0; c<ncells; ++c )
+    if( m_mesh.blanked(c) )
+      selected[c] = 0;
+
+  /* Gather lists and compacted connectivity */
+  std::vector<int32_t> map(nnodes, -1);
+  m_cells.clear();
+  for( int64_t c=0; c<ncells; ++c ) {
+    if( !selected[c] )
+      continue;
+    m_cells.push_back(c);
+    const int32_t* cell = conn + offsets[c];
+    int32_t n = Extract::nodesPerCell(cell[0]);
+    for( int32_t j=1; j<=n; ++j )
+      map[cell[j]] = 0;
+  }
+
+  m_nodes.clear();
+  for( int64_t i=0; i<nnodes; ++i ) {
+    if( map[i] < 0 )
+      continue;
+    map[i] = m_nodes.size();
+    m_nodes.push_back(i);
+  }
+  m_x.resize(m_nodes.size());
+  m_y.resize(m_nodes.size());
+  m_z.resize(m_nodes.size());
+
+  m_conn.clear();
+  m_ghost_cells.clear();
+  std::vector<int64_t>::iterator c;
+  for(c = m_cells.begin(); c != m_cells.end(); ++c) {
+    const int32_t* cell = conn + offsets[*c];
+    int32_t n = Extract::nodesPerCell(cell[0]);
+    m_conn.push_back(cell[0]);
+    for( int32_t j=1; j<=n; ++j )
+      m_conn.push_back(map[cell[j]]);
+    m_ghost_cells.push_back(ghost[*c]);
+  }
+
+  /* Boundary faces inside the region */
+  m_bound.clear();
+  for(b = bound.begin(); b != bound.end(); ++b) {
+    std::string name = b->name();
+    Boundary region(b->tag(), name);
+    int64_t nodes[4];
+
+    const std::vector<int32_t>& tris = b->tris();
+    for( size_t f=0; f<b->triOwned().size(); ++f ) {
+      bool in = true;
+      for( int32_t j=0; j<3; ++j ) {
+        nodes[j] = map[tris[3*f+j]];
+        in = in && nodes[j] >= 0;
+      }
+      if( in )
+        region.addTri(nodes, b->triOwned()[f]);
+    }
+
+    const std::vector<int32_t>& quads = b->quads();
+    for( size_t f=0; f<b->quadOwned().size(); ++f ) {
+      bool in = true;
+      for( int32_t j=0; j<4; ++j ) {
+        nodes[j] = map[quads[4*f+j]];
+        in = in && nodes[j] >= 0;
+      }
+      if( in )
+        region.addQuad(nodes, b->quadOwned()[f]);
+    }
+
+    if( !region.tris().empty() || !region.quads().empty() )
+      m_bound.push_back(region);
+  }
+
+  m_generation = m_mesh.generation();
+}
+
+void Region::gatherNodes(const double* values, double* region) const
+{
+  for( size_t i=0; i<m_nodes.size(); ++i )
+    region[i] = values[m_nodes[i]];
+}
+
+void Region::gatherCells(const double* values, double* region) const
+{
+  for( size_t i=0; i<m_cells.size(); ++i )
+    region[i] = values[m_cells[i]];
+}
@@ -0,0 +1,120 @@
+#pragma once
+
+/*
+ *  Notices:
+ *  Copyright 2023 United States Government as represented by the
+ *  Administrator of the National Aeronautics and Space Administration.
+ *  No copyright is claimed in the United States under Title 17,
+ *  U.S. Code. All Other Rights Reserved.
+ *
+ *  Disclaimers No Warranty: THE SUBJECT SOFTWARE IS PROVIDED "AS
+ *  IS" WITHOUT ANY WARRANTY OF ANY KIND, EITHER EXPRESSED, IMPLIED,
+ *  OR STATUTORY, INCLUDING, BUT NOT LIMITED TO, ANY WARRANTY THAT
+ *  THE SUBJECT SOFTWARE WILL CONFORM TO SPECIFICATIONS, ANY IMPLIED
+ *  WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE,
+ *  OR FREEDOM FROM INFRINGEMENT, ANY WARRANTY THAT THE SUBJECT
+ *  SOFTWARE WILL BE ERROR FREE, OR ANY WARRANTY THAT DOCUMENTATION,
+ *  IF PROVIDED, WILL CONFORM TO THE SUBJECT SOFTWARE. THIS AGREEMENT
+ *  DOES NOT, IN ANY MANNER, CONSTITUTE AN ENDORSEMENT BY GOVERNMENT
+ *  AGENCY OR ANY PRIOR RECIPIENT OF ANY RESULTS, RESULTING DESIGNS,
+ *  HARDWARE, SOFTWARE PRODUCTS OR ANY OTHER APPLICATIONS RESULTING
+ *  FROM USE OF THE SUBJECT SOFTWARE.  FURTHER, GOVERNMENT AGENCY
+ *  DISCLAIMS ALL WARRANTIES AND LIABILITIES REGARDING THIRD-PARTY
+ *  SOFTWARE, IF PRESENT IN THE ORIGINAL SOFTWARE, AND DISTRIBUTES
+ *  IT "AS IS." 
+ *
+ *  Waiver and Indemnity:  RECIPIENT AGREES TO WAIVE ANY AND ALL
+ *  CLAIMS AGAINST THE UNITED STATES GOVERNMENT, ITS CONTRACTORS
+ *  AND SUBCONTRACTORS, AS WELL AS ANY PRIOR RECIPIENT.  IF RECIPIENT'S
+ *  USE OF THE SUBJECT SOFTWARE RESULTS IN ANY LIABILITIES, DEMANDS,
+ *  DAMAGES, EXPENSES OR LOSSES ARISING FROM SUCH USE, INCLUDING
+ *  ANY DAMAGES FROM PRODUCTS BASED ON, OR RESULTING FROM, RECIPIENT'S
+ *  USE OF THE SUBJECT SOFTWARE, RECIPIENT SHALL INDEMNIFY AND HOLD
+ *  HARMLESS THE UNITED STATES GOVERNMENT, ITS CONTRACTORS AND
+ *  SUBCONTRACTORS, AS WELL AS ANY PRIOR RECIPIENT, TO THE EXTENT
+ *  PERMITTED BY LAW.  RECIPIENT'S SOLE REMEDY FOR ANY SUCH MATTER
+ *  SHALL BE THE IMMEDIATE, UNILATERAL TERMINATION OF THIS AGREEMENT.
+ */
+
+#include <vector>
+#include <cstdint>
+
+#include "UMesh.h"
+
+namespace VisKombyne
+{
+
+/**
+ * Region of interest of a UMesh handed to Kombyne instead of the whole
+ * partition.
+ *
+ * Cells are selected when one of their nodes lies in a box or a sphere or
+ * on a boundary with one of the given tags, the selection then grows by
+ * a number of cell layers.  The selected cells are compacted into their
+ * own connectivity over a gather list of the nodes they use, with the
+ * boundary faces whose nodes all belong to the region.  The selection is
+ * made once, and again whenever a moving grid changed, collectively since
+ * the node marks are exchanged between the layers.  Cells blanked in
+ * the UMesh are always left out, without criteria the region is the whole
+ * mesh less the blanked cells.
+ */
+class Region
+{
+  public:
+    Region(UMesh& mesh);
+
+    void box(const double box[6]);
+    void sphere(const double sphere[4]);
+    inline void tags(const std::vector<int64_t>& tags) { m_tags = tags; }
+    inline void layers(int32_t layers) { m_layers = layers; }
+    inline bool defined() const
+      { return m_has_box || m_has_sphere || !m_tags.empty(); }
+
+    /**
+     * Select the region if the mesh changed and gather the coordinates.
+     */
+    void update();
+
+    inline bool empty() const { return m_cells.empty(); }
+    inline int64_t nNodes() const { return m_nodes.size(); }
+    inline int64_t nCells() const { return m_cells.size(); }
+    inline double* x() { return m_x.data(); }
+    inline double* y() { return m_y.data(); }
+    inline double* z() { return m_z.data(); }
+    inline std::vector<int32_t>& cellConnects() { return m_conn; }
+    inline std::vector<int32_t>& ghostCells() { return m_ghost_cells; }
+    inline std::vector<Boundary>& boundaries() { return m_bound; }
+
+    /** Values of a nodal array at the region nodes */
+    void gatherNodes(const double* values, double* region) const;
+
+    /** Values of a cell array at the region cells */
+    void gatherCells(const double* values, double* region) const;
+
+  private:
+    void select();
+    inline bool inside(double x, double y, double z) const;
+    inline void syncMarked(std::vector<char>& marked);
+
+  private:
+    UMesh& m_mesh;
+    bool m_has_box;
+    double m_box[6];
+    bool m_has_sphere;
+    double m_sphere[4];
+    std::vector<int64_t> m_tags;
+    int32_t m_layers;
+
+    int64_t m_generation;
+    /** Gather lists of the region nodes and cells */
+    std::vector<int32_t> m_nodes;
+    std::vector<int64_t> m_cells;
+    std::vector<double> m_x;
+    std::vector<double> m_y;
+    std::vector<double> m_z;
+    std::vector<int32_t> m_conn;
+    std::vector<int32_t> m_ghost_cells;
+    std::vector<Boundary> m_bound;
+};
+
+} // namespace VisKombyne
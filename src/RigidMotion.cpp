@@ -0,0 +1,319 @@
+/*
+ *  Notices:
+ *  Copyright 2023 United States Government as represented by the
+ *  Administrator of the National Aeronautics and Space Administration.
+ *  No copyright is claimed in the United States under Title 17,
+ *  U.S. Code. All Other Rights Reserved.
+ *
+ *  Disclaimers No Warranty: THE SUBJECT SOFTWARE IS PROVIDED "AS
+ *  IS" WITHOUT ANY WARRANTY OF ANY KIND, EITHER EXPRESSED, IMPLIED,
+ *  OR STATUTORY, INCLUDING, BUT NOT LIMITED TO, ANY WARRANTY THAT
+ *  THE SUBJECT SOFTWARE WILL CONFORM TO SPECIFICATIONS, ANY IMPLIED
+ *  WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE,
+ *  OR FREEDOM FROM INFRINGEMENT, ANY WARRANTY THAT THE SUBJECT
+ *  SOFTWARE WILL BE ERROR FREE, OR ANY WARRANTY THAT DOCUMENTATION,
+ *  IF PROVIDED, WILL CONFORM TO THE SUBJECT SOFTWARE. THIS AGREEMENT
+ *  DOES NOT, IN ANY MANNER, CONSTITUTE AN ENDORSEMENT BY GOVERNMENT
+ *  AGENCY OR ANY PRIOR RECIPIENT OF ANY RESULTS, RESULTING DESIGNS,
+ *  HARDWARE, SOFTWARE PRODUCTS OR ANY OTHER APPLICATIONS RESULTING
+ *  FROM USE OF THE SUBJECT SOFTWARE.  FURTHER, GOVERNMENT AGENCY
+ *  DISCLAIMS ALL WARRANTIES AND LIABILITIES REGARDING THIRD-PARTY
+ *  SOFTWARE, IF PRESENT IN THE ORIGINAL SOFTWARE, AND DISTRIBUTES
+ *  IT "AS IS." 
+ *
+ *  Waiver and Indemnity:  RECIPIENT AGREES TO WAIVE ANY AND ALL
+ *  CLAIMS AGAINST THE UNITED STATES GOVERNMENT, ITS CONTRACTORS
+ *  AND SUBCONTRACTORS, AS WELL AS ANY PRIOR RECIPIENT.  IF RECIPIENT'S
+ *  USE OF THE SUBJECT SOFTWARE RESULTS IN ANY LIABILITIES, DEMANDS,
+ *  DAMAGES, EXPENSES OR LOSSES ARISING FROM SUCH USE, INCLUDING
+ *  ANY DAMAGES FROM PRODUCTS BASED ON, OR RESULTING FROM, RECIPIENT'S
+ *  USE OF THE SUBJECT SOFTWARE, RECIPIENT SHALL INDEMNIFY AND HOLD
+ *  HARMLESS THE UNITED STATES GOVERNMENT, ITS CONTRACTORS AND
+ *  SUBCONTRACTORS, AS WELL AS ANY PRIOR RECIPIENT, TO THE EXTENT
+ *  PERMITTED BY LAW.  RECIPIENT'S SOLE REMEDY FOR ANY SUCH MATTER
+ *  SHALL BE THE IMMEDIATE, UNILATERAL TERMINATION OF THIS AGREEMENT.
+ */
+
+#ifdef __GNUG__
+  #pragma implementation "RigidMotion.h"
+#endif
+
+#include <exception>
+#include <stdexcept>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <sstream>
+#include <algorithm>
+#include <iterator>
+
+#include "RigidMotion.h"
+#include "Tessellation.h"
+#include "tinf_6dof.h"
+#include "tinf_mesh.h"
+#include "pancake_cxx/Problem.h"
+#include "TinfCheck.h"
+
+using namespace VisKombyne;
+
+const int64_t RigidMotion::BLOCK;
+
+/*
+ * Transforms are homogeneous 4x4 matrices stored by rows, i.e.
+ * x' = t[0]*x + t[1]*y + t[2]*z + t[3], etc.  RigidMotion::transform()
+ * converts the tinf_6dof layout to this one.
+ */
+void RigidBody::reference(const double* x, const double* y, const double* z,
+                          const double t[16])
+{
+  size_t n = m_nodes.size();
+
+  m_xref.resize(n);
+  m_yref.resize(n);
+  m_zref.resize(n);
+  m_xt.resize(n);
+  m_yt.resize(n);
+  m_zt.resize(n);
+
+  /* Undo the current transform (inverse of a rigid motion is R^T(x-d)) so
+   * that a restart away from the reference position is handled. */
+  for( size_t i=0; i<n; ++i ) {
+    int64_t node = m_nodes[i];
+    double dx = x[node] - t[3];
+    double dy = y[node] - t[7];
+    double dz = z[node] - t[11];
+    m_xref[i] = t[0]*dx + t[4]*dy + t[8]*dz;
+    m_yref[i] = t[1]*dx + t[5]*dy + t[9]*dz;
+    m_zref[i] = t[2]*dx + t[6]*dy + t[10]*dz;
+  }
+
+  std::copy(t, t+16, m_transform);
+}
+
+bool RigidBody::apply(const double t[16], double* x, double* y, double* z)
+{
+  if( std::equal(t, t+16, m_transform) )
+    return false;
+
+  size_t n = m_nodes.size();
+
+  const double* __restrict__ xr = m_xref.data();
+  const double* __restrict__ yr = m_yref.data();
+  const double* __restrict__ zr = m_zref.data();
+  double* __restrict__ xt = m_xt.data();
+  double* __restrict__ yt = m_yt.data();
+  double* __restrict__ zt = m_zt.data();
+
+  /* Contiguous (vectorizable) transform followed by the scatter */
+  for( size_t i=0; i<n; ++i ) {
+    xt[i] = t[0]*xr[i] + t[1]*yr[i] + t[2]*zr[i] + t[3];
+    yt[i] = t[4]*xr[i] + t[5]*yr[i] + t[6]*zr[i] + t[7];
+    zt[i] = t[8]*xr[i] + t[9]*yr[i] + t[10]*zr[i] + t[11];
+  }
+
+  const int64_t* nodes = m_nodes.data();
+  for( size_t i=0; i<n; ++i ) {
+    x[nodes[i]] = xt[i];
+    y[nodes[i]] = yt[i];
+    z[nodes[i]] = zt[i];
+  }
+
+  std::copy(t, t+16, m_transform);
+
+  return true;
+}
+
+
+RigidMotion::RigidMotion(void* prob, void* mesh, void* soln, void* comm,
+                         double time,
+                         const double* x, const double* y, const double* z) :
+  m_sixdof(NULL), m_mesh(mesh), m_rows(false), m_static(0),
+  m_ndeforming(0)
+{
+  int error;
+
+  pancake::Problem problem(prob);
+  problem.value("kombyne:rigid_transform_rows", &m_rows);
+
+  error = tinf_6dof_create(&m_sixdof, prob, mesh, soln, comm);
+  TINF_CHECK_SUCCESS(error, "Could not create 6-DOF object");
+
+  bindNodes(prob, mesh);
+
+  double t[16];
+  std::vector<RigidBody>::iterator it;
+  for( it = m_bodies.begin(); it != m_bodies.end(); ++it ) {
+    transform(it->id(), time, t);
+    it->reference(x, y, z, t);
+  }
+}
+
+RigidMotion::~RigidMotion()
+{
+  if( m_sixdof )
+    tinf_6dof_destroy(&m_sixdof);
+}
+
+bool RigidMotion::requested(void* prob)
+{
+  pancake::Problem problem(prob);
+
+  bool rigid = false;
+  problem.value("kombyne:rigid_motion", &rigid);
+
+  return rigid;
+}
+
+bool RigidMotion::apply(double time, double* x, double* y, double* z)
+{
+  bool changed = false;
+  double t[16];
+
+  std::vector<RigidBody>::iterator it;
+  for( it = m_bodies.begin(); it != m_bodies.end(); ++it ) {
+    transform(it->id(), time, t);
+    changed = it->apply(t, x, y, z) || changed;
+  }
+
+  return refreshDeforming(x, y, z) || changed;
+}
+
+void RigidMotion::bindNodes(void* prob, void* mesh)
+{
+  int error;
+
+  pancake::Problem problem(prob);
+  std::vector<int32_t> ids;
+  problem.value("kombyne:rigid_body_id", ids);
+  std::vector<int64_t> tags;
+  problem.value("kombyne:rigid_body_tag", tags);
+
+  if( ids.size() != tags.size() )
+    throw std::runtime_error("Mismatched rigid body ids and tags");
+  std::vector<int64_t> deforming;
+  problem.value("kombyne:rigid_deforming_tag", deforming);
+
+  std::vector<int32_t> unique(ids);
+  std::sort(unique.begin(), unique.end());
+  unique.erase(std::unique(unique.begin(), unique.end()), unique.end());
+
+  m_bodies.reserve(unique.size());
+  std::vector<int32_t>::iterator u;
+  for( u = unique.begin(); u != unique.end(); ++u )
+    m_bodies.push_back(RigidBody(*u));
+
+  int64_t nnodes = tinf_mesh_node_count(mesh, &error);
+  TINF_CHECK_SUCCESS(error, "Could not get number of mesh nodes");
+
+  /* -1 for static nodes, -2 for deforming ones */
+  std::vector<int32_t> body(nnodes, -1);
+  int64_t nodes[Tessellation::MAX_NODES];
+
+  for( int64_t i=0; i<tinf_mesh_element_count(mesh,&error); ++i ) {
+    enum TINF_ELEMENT_TYPE type = tinf_mesh_element_type(mesh, i, &error);
+    int32_t n = Tessellation::nodesPerElement(type);
+    if( 0 == n )
+      continue;
+
+    int64_t tag = tinf_mesh_element_tag(mesh, i, &error);
+    TINF_CHECK_SUCCESS(error, "Could not get element tag");
+
+    if( std::find(deforming.begin(), deforming.end(), tag) !=
+        deforming.end() ) {
+      error = tinf_mesh_element_nodes(mesh, i, nodes);
+      TINF_CHECK_SUCCESS(error, "Could not get element nodes");
+      for( int32_t j=0; j<n; ++j )
+        body[nodes[j]] = -2;
+      continue;
+    }
+
+    std::vector<int64_t>::iterator t = std::find(tags.begin(), tags.end(), tag);
+    if( t == tags.end() )
+      continue;
+
+    int32_t b = (int32_t)std::distance(unique.begin(),
+                   std::lower_bound(unique.begin(), unique.end(),
+                                    ids[std::distance(tags.begin(), t)]));
+
+    error = tinf_mesh_element_nodes(mesh, i, nodes);
+    TINF_CHECK_SUCCESS(error, "Could not get element nodes");
+
+    /* Nodes shared with a deforming region follow the mesh */
+    for( int32_t j=0; j<n; ++j ) {
+      if( -2 == body[nodes[j]] )
+        continue;
+      if( -1 != body[nodes[j]] && b != body[nodes[j]] )
+        throw std::runtime_error("Node bound to more than one rigid body");
+      body[nodes[j]] = b;
+    }
+  }
+
+  for( int64_t i=0; i<nnodes; ++i ) {
+    if( body[i] >= 0 ) {
+      m_bodies[body[i]].nodes().push_back(i);
+    } else if( -1 == body[i] ) {
+      ++m_static;
+    } else {
+      /* Runs of at most BLOCK nodes bound the retrieval buffers */
+      ++m_ndeforming;
+      if( m_deforming.empty() ||
+          m_deforming.back().first + m_deforming.back().second != i ||
+          m_deforming.back().second == BLOCK )
+        m_deforming.push_back(std::make_pair(i, (int64_t)0));
+      ++m_deforming.back().second;
+    }
+  }
+}
+
+bool RigidMotion::refreshDeforming(double* x, double* y, double* z)
+{
+  int error;
+  bool changed = false;
+
+  std::vector<double> xd(BLOCK), yd(BLOCK), zd(BLOCK);
+
+  std::vector<std::pair<int64_t,int64_t> >::iterator it;
+  for( it = m_deforming.begin(); it != m_deforming.end(); ++it ) {
+    int64_t start = it->first, cnt = it->second;
+    error = tinf_mesh_nodes_coordinates(m_mesh, TINF_DOUBLE, start, cnt,
+                                        xd.data(), yd.data(), zd.data());
+    TINF_CHECK_SUCCESS(error, "Could not get deforming node coordinates");
+
+    if( !std::equal(xd.begin(), xd.begin()+cnt, x+start) ||
+        !std::equal(yd.begin(), yd.begin()+cnt, y+start) ||
+        !std::equal(zd.begin(), zd.begin()+cnt, z+start) ) {
+      std::copy(xd.begin(), xd.begin()+cnt, x+start);
+      std::copy(yd.begin(), yd.begin()+cnt, y+start);
+      std::copy(zd.begin(), zd.begin()+cnt, z+start);
+      changed = true;
+    }
+  }
+
+  return changed;
+}
+
+void RigidMotion::transform(int32_t body, double time, double t[16])
+{
+  int error;
+  double cg[3];
+
+  /* tinf_6dof.h only specifies a flat homogeneous matrix; the Fortran
+   * binding (dimension(16)) of a transform(4,4) is column-major, i.e. the
+   * translation arrives in t[12], t[13], t[14].  Transpose into the
+   * row-major layout used by RigidBody unless told the solver already
+   * returns rows (kombyne:rigid_transform_rows). */
+  error = tinf_6dof_get_condition(m_sixdof, body, time, t, cg);
+  TINF_CHECK_SUCCESS(error, "Could not get rigid body transform");
+
+  if( !m_rows ) {
+    for( int i=0; i<4; ++i )
+      for( int j=i+1; j<4; ++j )
+        std::swap(t[4*i+j], t[4*j+i]);
+  }
+
+  /* A rigid motion keeps the projective row at (0, 0, 0, 1); anything else
+   * is the other layout, which would silently transpose the rotation. */
+  if( 0.0 != t[12] || 0.0 != t[13] || 0.0 != t[14] || 1.0 != t[15] )
+    throw std::runtime_error("Rigid body transform is not a homogeneous "
+                             "rigid motion, check kombyne:rigid_transform_rows");
+}
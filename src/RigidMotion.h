@@ -0,0 +1,137 @@
+#pragma once
+
+/*
+ *  Notices:
+ *  Copyright 2023 United States Government as represented by the
+ *  Administrator of the National Aeronautics and Space Administration.
+ *  No copyright is claimed in the United States under Title 17,
+ *  U.S. Code. All Other Rights Reserved.
+ *
+ *  Disclaimers No Warranty: THE SUBJECT SOFTWARE IS PROVIDED "AS
+ *  IS" WITHOUT ANY WARRANTY OF ANY KIND, EITHER EXPRESSED, IMPLIED,
+ *  OR STATUTORY, INCLUDING, BUT NOT LIMITED TO, ANY WARRANTY THAT
+ *  THE SUBJECT SOFTWARE WILL CONFORM TO SPECIFICATIONS, ANY IMPLIED
+ *  WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE,
+ *  OR FREEDOM FROM INFRINGEMENT, ANY WARRANTY THAT THE SUBJECT
+ *  SOFTWARE WILL BE ERROR FREE, OR ANY WARRANTY THAT DOCUMENTATION,
+ *  IF PROVIDED, WILL CONFORM TO THE SUBJECT SOFTWARE. THIS AGREEMENT
+ *  DOES NOT, IN ANY MANNER, CONSTITUTE AN ENDORSEMENT BY GOVERNMENT
+ *  AGENCY OR ANY PRIOR RECIPIENT OF ANY RESULTS, RESULTING DESIGNS,
+ *  HARDWARE, SOFTWARE PRODUCTS OR ANY OTHER APPLICATIONS RESULTING
+ *  FROM USE OF THE SUBJECT SOFTWARE.  FURTHER, GOVERNMENT AGENCY
+ *  DISCLAIMS ALL WARRANTIES AND LIABILITIES REGARDING THIRD-PARTY
+ *  SOFTWARE, IF PRESENT IN THE ORIGINAL SOFTWARE, AND DISTRIBUTES
+ *  IT "AS IS." 
+ *
+ *  Waiver and Indemnity:  RECIPIENT AGREES TO WAIVE ANY AND ALL
+ *  CLAIMS AGAINST THE UNITED STATES GOVERNMENT, ITS CONTRACTORS
+ *  AND SUBCONTRACTORS, AS WELL AS ANY PRIOR RECIPIENT.  IF RECIPIENT'S
+ *  USE OF THE SUBJECT SOFTWARE RESULTS IN ANY LIABILITIES, DEMANDS,
+ *  DAMAGES, EXPENSES OR LOSSES ARISING FROM SUCH USE, INCLUDING
+ *  ANY DAMAGES FROM PRODUCTS BASED ON, OR RESULTING FROM, RECIPIENT'S
+ *  USE OF THE SUBJECT SOFTWARE, RECIPIENT SHALL INDEMNIFY AND HOLD
+ *  HARMLESS THE UNITED STATES GOVERNMENT, ITS CONTRACTORS AND
+ *  SUBCONTRACTORS, AS WELL AS ANY PRIOR RECIPIENT, TO THE EXTENT
+ *  PERMITTED BY LAW.  RECIPIENT'S SOLE REMEDY FOR ANY SUCH MATTER
+ *  SHALL BE THE IMMEDIATE, UNILATERAL TERMINATION OF THIS AGREEMENT.
+ */
+
+#include <vector>
+#include <utility>
+#include <cstdint>
+
+namespace VisKombyne
+{
+
+/**
+ * Rigid body motion of the mesh nodes.
+ *
+ * Nodes are bound to a body through the tag of the elements that use them
+ * (parallel "kombyne:rigid_body_id"/"kombyne:rigid_body_tag" arrays).  The
+ * reference coordinates of each body are kept and the current coordinates
+ * are recovered from the homogeneous transform provided by tinf_6dof.
+ */
+class RigidBody
+{
+  public:
+    RigidBody(int32_t id) : m_id(id) {}
+
+    inline int32_t id() const { return m_id; }
+    inline std::vector<int64_t>& nodes() { return m_nodes; }
+
+    void reference(const double* x, const double* y, const double* z,
+                   const double transform[16]);
+    bool apply(const double transform[16], double* x, double* y, double* z);
+
+  private:
+    int32_t m_id;
+    std::vector<int64_t> m_nodes;
+    std::vector<double> m_xref;
+    std::vector<double> m_yref;
+    std::vector<double> m_zref;
+    std::vector<double> m_xt;
+    std::vector<double> m_yt;
+    std::vector<double> m_zt;
+    double m_transform[16];
+};
+
+
+/**
+ * Nodes of the elements tagged "kombyne:rigid_deforming_tag" are retrieved
+ * from the mesh at every update, all other nodes bound to no body (e.g. a
+ * static overset background grid) keep their initial coordinates.
+ */
+class RigidMotion
+{
+  public:
+    /**
+     * Constructor.
+     *
+     * @param prob  Problem description object
+     * @param mesh  Mesh object
+     * @param soln  Solution object (solver owning the body motion)
+     * @param comm  Communications object
+     * @param time  Simulation time of the current coordinates
+     * @param x, y, z  Current node coordinates
+     */
+    RigidMotion(void* prob, void* mesh, void* soln, void* comm, double time,
+                const double* x, const double* y, const double* z);
+    virtual ~RigidMotion();
+
+    /**
+     * Check if the problem description requests rigid motion.
+     */
+    static bool requested(void* prob);
+
+    /**
+     * Move the nodes of every body to their position at @p time.
+     *
+     * @returns true if any node moved since the last update.
+     */
+    bool apply(double time, double* x, double* y, double* z);
+
+    /** Number of local nodes neither bound to a body nor deforming */
+    inline int64_t nStatic() const { return m_static; }
+    /** Number of local nodes retrieved from the mesh at every update */
+    inline int64_t nDeforming() const { return m_ndeforming; }
+
+  private:
+    /** Largest node range retrieved at once */
+    static const int64_t BLOCK = 4096;
+
+    inline void bindNodes(void* prob, void* mesh);
+    inline void transform(int32_t body, double time, double t[16]);
+    inline bool refreshDeforming(double* x, double* y, double* z);
+
+  private:
+    void* m_sixdof;
+    void* m_mesh;
+    bool m_rows;
+    int64_t m_static;
+    int64_t m_ndeforming;
+    /** Contiguous {start, count} node ranges of the deforming nodes */
+    std::vector<std::pair<int64_t,int64_t> > m_deforming;
+    std::vector<RigidBody> m_bodies;
+};
+
+} // namespace VisKombyne
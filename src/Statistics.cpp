@@ -0,0 +1,91 @@
+/*
+ *  Notices:
+ *  Copyright 2023 United States Government as represented by the
+ *  Administrator of the National Aeronautics and Space Administration.
+ *  No copyright is claimed in the United States under Title 17,
+ *  U.S. Code. All Other Rights Reserved.
+ *
+ *  Disclaimers No Warranty: THE SUBJECT SOFTWARE IS PROVIDED "AS
+ *  IS" WITHOUT ANY WARRANTY OF ANY KIND, EITHER EXPRESSED, IMPLIED,
+ *  OR STATUTORY, INCLUDING, BUT NOT LIMITED TO, ANY WARRANTY THAT
+ *  THE SUBJECT SOFTWARE WILL CONFORM TO SPECIFICATIONS, ANY IMPLIED
+ *  WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE,
+ *  OR FREEDOM FROM INFRINGEMENT, ANY WARRANTY THAT THE SUBJECT
+ *  SOFTWARE WILL BE ERROR FREE, OR ANY WARRANTY THAT DOCUMENTATION,
+ *  IF PROVIDED, WILL CONFORM TO THE SUBJECT SOFTWARE. THIS AGREEMENT
+ *  DOES NOT, IN ANY MANNER, CONSTITUTE AN ENDORSEMENT BY GOVERNMENT
+ *  AGENCY OR ANY PRIOR RECIPIENT OF ANY RESULTS, RESULTING DESIGNS,
+ *  HARDWARE, SOFTWARE PRODUCTS OR ANY OTHER APPLICATIONS RESULTING
+ *  FROM USE OF THE SUBJECT SOFTWARE.  FURTHER, GOVERNMENT AGENCY
+ *  DISCLAIMS ALL WARRANTIES AND LIABILITIES REGARDING THIRD-PARTY
+ *  SOFTWARE, IF PRESENT IN THE ORIGINAL SOFTWARE, AND DISTRIBUTES
+ *  IT "AS IS." 
+ *
+ *  Waiver and Indemnity:  RECIPIENT AGREES TO WAIVE ANY AND ALL
+ *  CLAIMS AGAINST THE UNITED STATES GOVERNMENT, ITS CONTRACTORS
+ *  AND SUBCONTRACTORS, AS WELL AS ANY PRIOR RECIPIENT.  IF RECIPIENT'S
+ *  USE OF THE SUBJECT SOFTWARE RESULTS IN ANY LIABILITIES, DEMANDS,
+ *  DAMAGES, EXPENSES OR LOSSES ARISING FROM SUCH USE, INCLUDING
+ *  ANY DAMAGES FROM PRODUCTS BASED ON, OR RESULTING FROM, RECIPIENT'S
+ *  USE OF THE SUBJECT SOFTWARE, RECIPIENT SHALL INDEMNIFY AND HOLD
+ *  HARMLESS THE UNITED STATES GOVERNMENT, ITS CONTRACTORS AND
+ *  SUBCONTRACTORS, AS WELL AS ANY PRIOR RECIPIENT, TO THE EXTENT
+ *  PERMITTED BY LAW.  RECIPIENT'S SOLE REMEDY FOR ANY SUCH MATTER
+ *  SHALL BE THE IMMEDIATE, UNILATERAL TERMINATION OF THIS AGREEMENT.
+ */
+
+#ifdef __GNUG__
+  #pragma implementation "Statistics.h"
+#endif
+
+#include <cmath>
+#include <algorithm>
+
+#include "Statistics.h"
+
+using namespace VisKombyne;
+
+void Statistics::update(const double* values)
+{
+  int64_t n = size();
+
+  const double* __restrict__ v = values;
+  double* __restrict__ mean = m_mean.data();
+  double* __restrict__ m2 = m_m2.data();
+  double* __restrict__ vmin = m_min.data();
+  double* __restrict__ vmax = m_max.data();
+
+  if( 0 == m_count ) {
+    std::copy(v, v+n, mean);
+    std::copy(v, v+n, vmin);
+    std::copy(v, v+n, vmax);
+    std::fill(m2, m2+n, 0.0);
+    m_count = 1;
+    return;
+  }
+
+  double rcount = 1.0/(double)(++m_count);
+
+  for( int64_t i=0; i<n; ++i ) {
+    double delta = v[i] - mean[i];
+    mean[i] += delta*rcount;
+    m2[i] += delta*(v[i] - mean[i]);
+    vmin[i] = std::min(vmin[i], v[i]);
+    vmax[i] = std::max(vmax[i], v[i]);
+  }
+}
+
+double* Statistics::rms()
+{
+  int64_t n = size();
+
+  const double* __restrict__ m2 = m_m2.data();
+  double* __restrict__ rms = m_rms.data();
+
+  double rcount = (m_count > 0) ? 1.0/(double)m_count : 0.0;
+
+  for( int64_t i=0; i<n; ++i )
+    rms[i] = std::sqrt(m2[i]*rcount);
+
+  return rms;
+}
@@ -0,0 +1,414 @@
+/*
+ *  Notices:
+ *  Copyright 2023 United States Government as represented by the
+ *  Administrator of the National Aeronautics and Space Administration.
+ *  No copyright is claimed in the United States under Title 17,
+ *  U.S. Code. All Other Rights Reserved.
+ *
+ *  Disclaimers No Warranty: THE SUBJECT SOFTWARE IS PROVIDED "AS
+ *  IS" WITHOUT ANY WARRANTY OF ANY KIND, EITHER EXPRESSED, IMPLIED,
+ *  OR STATUTORY, INCLUDING, BUT NOT LIMITED TO, ANY WARRANTY THAT
+ *  THE SUBJECT SOFTWARE WILL CONFORM TO SPECIFICATIONS, ANY IMPLIED
+ *  WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE,
+ *  OR FREEDOM FROM INFRINGEMENT, ANY WARRANTY THAT THE SUBJECT
+ *  SOFTWARE WILL BE ERROR FREE, OR ANY WARRANTY THAT DOCUMENTATION,
+ *  IF PROVIDED, WILL CONFORM TO THE SUBJECT SOFTWARE. THIS AGREEMENT
+ *  DOES NOT, IN ANY MANNER, CONSTITUTE AN ENDORSEMENT BY GOVERNMENT
+ *  AGENCY OR ANY PRIOR RECIPIENT OF ANY RESULTS, RESULTING DESIGNS,
+ *  HARDWARE, SOFTWARE PRODUCTS OR ANY OTHER APPLICATIONS RESULTING
+ *  FROM USE OF THE SUBJECT SOFTWARE.  FURTHER, GOVERNMENT AGENCY
+ *  DISCLAIMS ALL WARRANTIES AND LIABILITIES REGARDING THIRD-PARTY
+ *  SOFTWARE, IF PRESENT IN THE ORIGINAL SOFTWARE, AND DISTRIBUTES
+ *  IT "AS IS." 
+ *
+ *  Waiver and Indemnity:  RECIPIENT AGREES TO WAIVE ANY AND ALL
+ *  CLAIMS AGAINST THE UNITED STATES GOVERNMENT, ITS CONTRACTORS
+ *  AND SUBCONTRACTORS, AS WELL AS ANY PRIOR RECIPIENT.  IF RECIPIENT'S
+ *  USE OF THE SUBJECT SOFTWARE RESULTS IN ANY LIABILITIES, DEMANDS,
+ *  DAMAGES, EXPENSES OR LOSSES ARISING FROM SUCH USE, INCLUDING
+ *  ANY DAMAGES FROM PRODUCTS BASED ON, OR RESULTING FROM, RECIPIENT'S
+ *  USE OF THE SUBJECT SOFTWARE, RECIPIENT SHALL INDEMNIFY AND HOLD
+ *  HARMLESS THE UNITED STATES GOVERNMENT, ITS CONTRACTORS AND
+ *  SUBCONTRACTORS, AS WELL AS ANY PRIOR RECIPIENT, TO THE EXTENT
+ *  PERMITTED BY LAW.  RECIPIENT'S SOLE REMEDY FOR ANY SUCH MATTER
+ *  SHALL BE THE IMMEDIATE, UNILATERAL TERMINATION OF THIS AGREEMENT.
+ */
+
+#ifdef __GNUG__
+  #pragma implementation "Tessellation.h"
+#endif
+
+#include <exception>
+#include <stdexcept>
+#include <sstream>
+#include <algorithm>
+#include <numeric>
+#include <thread>
+#include <atomic>
+
+#include "Tessellation.h"
+#include "tinf_mesh.h"
+#include "kombyne_data_celltype.h"
+#include "TinfCheck.h"
+
+using namespace VisKombyne;
+
+namespace
+{
+
+const int32_t TRI   = KB_CELLTYPE_TRI;
+const int32_t QUAD  = KB_CELLTYPE_QUAD;
+const int32_t TET   = KB_CELLTYPE_TET;
+const int32_t PYR   = KB_CELLTYPE_PYR;
+const int32_t WEDGE = KB_CELLTYPE_WEDGE;
+const int32_t HEX   = KB_CELLTYPE_HEX;
+
+/**
+ * Split of an element type into linear sub-cells, on the CGNS node
+ * numbering of the element.  Types without a split of their own derive
+ * from the linear type and keep the corner cell.
+ */
+template<int32_t TYPE> struct Split;
+
+template<> struct Split<TINF_TRI_3>    { static const int32_t cells[1][9]; };
+template<> struct Split<TINF_QUAD_4>   { static const int32_t cells[1][9]; };
+template<> struct Split<TINF_TETRA_4>  { static const int32_t cells[1][9]; };
+template<> struct Split<TINF_PYRA_5>   { static const int32_t cells[1][9]; };
+template<> struct Split<TINF_PENTA_6>  { static const int32_t cells[1][9]; };
+template<> struct Split<TINF_HEXA_8>   { static const int32_t cells[1][9]; };
+
+template<> struct Split<TINF_TRI_6>    { static const int32_t cells[4][9]; };
+template<> struct Split<TINF_QUAD_9>   { static const int32_t cells[4][9]; };
+template<> struct Split<TINF_TETRA_10> { static const int32_t cells[8][9]; };
+template<> struct Split<TINF_PYRA_14>  { static const int32_t cells[10][9]; };
+template<> struct Split<TINF_PENTA_18> { static const int32_t cells[8][9]; };
+template<> struct Split<TINF_HEXA_27>  { static const int32_t cells[8][9]; };
+
+const int32_t Split<TINF_TRI_3>::cells[1][9]   = {{TRI, 0,1,2}};
+const int32_t Split<TINF_QUAD_4>::cells[1][9]  = {{QUAD, 0,1,2,3}};
+const int32_t Split<TINF_TETRA_4>::cells[1][9] = {{TET, 0,1,2,3}};
+const int32_t Split<TINF_PYRA_5>::cells[1][9]  = {{PYR, 0,1,2,3,4}};
+const int32_t Split<TINF_PENTA_6>::cells[1][9] = {{WEDGE, 0,1,2,3,4,5}};
+const int32_t Split<TINF_HEXA_8>::cells[1][9]  = {{HEX, 0,1,2,3,4,5,6,7}};
+
+/* Corner triangles and the middle one on the mid-edge nodes */
+const int32_t Split<TINF_TRI_6>::cells[4][9] = {
+  {TRI, 0,3,5}, {TRI, 3,1,4}, {TRI, 5,4,2}, {TRI, 3,4,5}
+};
+
+/* Quadrants around the face center */
+const int32_t Split<TINF_QUAD_9>::cells[4][9] = {
+  {QUAD, 0,4,8,7}, {QUAD, 4,1,5,8}, {QUAD, 8,5,2,6}, {QUAD, 7,8,6,3}
+};
+
+/* Corner tets, and the inner octahedron about the 4-9 diagonal */
+const int32_t Split<TINF_TETRA_10>::cells[8][9] = {
+  {TET, 0,4,6,7}, {TET, 4,1,5,8}, {TET, 6,5,2,9}, {TET, 7,8,9,3},
+  {TET, 4,9,8,5}, {TET, 4,9,7,8}, {TET, 4,9,6,7}, {TET, 4,9,5,6}
+};
+
+/* Base quadrant pyramids, the apex pyramid and the inverted pyramid under
+ * it, with tets filling the gaps on the sides */
+const int32_t Split<TINF_PYRA_14>::cells[10][9] = {
+  {PYR, 0,5,13,8,9}, {PYR, 5,1,6,13,10}, {PYR, 13,6,2,7,11},
+  {PYR, 8,13,7,3,12}, {PYR, 9,10,11,12,4}, {PYR, 9,12,11,10,13},
+  {TET, 5,9,10,13}, {TET, 6,10,11,13}, {TET, 7,11,12,13}, {TET, 8,12,9,13}
+};
+
+/* Two layers of the split triangle, through the side face centers */
+const int32_t Split<TINF_PENTA_18>::cells[8][9] = {
+  {WEDGE, 0,6,8, 9,15,17},   {WEDGE, 6,1,7, 15,10,16},
+  {WEDGE, 8,7,2, 17,16,11},  {WEDGE, 6,7,8, 15,16,17},
+  {WEDGE, 9,15,17, 3,12,14}, {WEDGE, 15,10,16, 12,4,13},
+  {WEDGE, 17,16,11, 14,13,5}, {WEDGE, 15,16,17, 12,13,14}
+};
+
+/* Octants of the 3x3x3 node lattice */
+const int32_t Split<TINF_HEXA_27>::cells[8][9] = {
+  {HEX, 0,8,20,11, 12,21,26,24},  {HEX, 8,1,9,20, 21,13,22,26},
+  {HEX, 11,20,10,3, 24,26,23,15}, {HEX, 20,9,2,10, 26,22,14,23},
+  {HEX, 12,21,26,24, 4,16,25,19}, {HEX, 21,13,22,26, 16,5,17,25},
+  {HEX, 24,26,23,15, 19,25,18,7}, {HEX, 26,22,14,23, 25,17,6,18}
+};
+
+template<> struct Split<TINF_TRI_9>       : Split<TINF_TRI_3> {};
+template<> struct Split<TINF_TRI_10>      : Split<TINF_TRI_3> {};
+template<> struct Split<TINF_TRI_12>      : Split<TINF_TRI_3> {};
+template<> struct Split<TINF_TRI_15>      : Split<TINF_TRI_3> {};
+template<> struct Split<TINF_QUAD_8>      : Split<TINF_QUAD_4> {};
+template<> struct Split<TINF_QUAD_12>     : Split<TINF_QUAD_4> {};
+template<> struct Split<TINF_QUAD_16>     : Split<TINF_QUAD_4> {};
+template<> struct Split<TINF_QUAD_P4_16>  : Split<TINF_QUAD_4> {};
+template<> struct Split<TINF_QUAD_25>     : Split<TINF_QUAD_4> {};
+template<> struct Split<TINF_TETRA_16>    : Split<TINF_TETRA_4> {};
+template<> struct Split<TINF_TETRA_20>    : Split<TINF_TETRA_4> {};
+template<> struct Split<TINF_TETRA_22>    : Split<TINF_TETRA_4> {};
+template<> struct Split<TINF_TETRA_34>    : Split<TINF_TETRA_4> {};
+template<> struct Split<TINF_TETRA_35>    : Split<TINF_TETRA_4> {};
+template<> struct Split<TINF_PYRA_13>     : Split<TINF_PYRA_5> {};
+template<> struct Split<TINF_PYRA_21>     : Split<TINF_PYRA_5> {};
+template<> struct Split<TINF_PYRA_29>     : Split<TINF_PYRA_5> {};
+template<> struct Split<TINF_PYRA_30>     : Split<TINF_PYRA_5> {};
+template<> struct Split<TINF_PYRA_P4_29>  : Split<TINF_PYRA_5> {};
+template<> struct Split<TINF_PYRA_50>     : Split<TINF_PYRA_5> {};
+template<> struct Split<TINF_PYRA_55>     : Split<TINF_PYRA_5> {};
+template<> struct Split<TINF_PENTA_15>    : Split<TINF_PENTA_6> {};
+template<> struct Split<TINF_PENTA_24>    : Split<TINF_PENTA_6> {};
+template<> struct Split<TINF_PENTA_33>    : Split<TINF_PENTA_6> {};
+template<> struct Split<TINF_PENTA_38>    : Split<TINF_PENTA_6> {};
+template<> struct Split<TINF_PENTA_40>    : Split<TINF_PENTA_6> {};
+template<> struct Split<TINF_PENTA_66>    : Split<TINF_PENTA_6> {};
+template<> struct Split<TINF_PENTA_75>    : Split<TINF_PENTA_6> {};
+template<> struct Split<TINF_HEXA_20>     : Split<TINF_HEXA_8> {};
+template<> struct Split<TINF_HEXA_32>     : Split<TINF_HEXA_8> {};
+template<> struct Split<TINF_HEXA_44>     : Split<TINF_HEXA_8> {};
+template<> struct Split<TINF_HEXA_56>     : Split<TINF_HEXA_8> {};
+template<> struct Split<TINF_HEXA_64>     : Split<TINF_HEXA_8> {};
+template<> struct Split<TINF_HEXA_98>     : Split<TINF_HEXA_8> {};
+template<> struct Split<TINF_HEXA_125>    : Split<TINF_HEXA_8> {};
+
+template<int32_t TYPE> const Tessellation::Table* table()
+{
+  static const Tessellation::Table t = {
+    (int32_t)(sizeof(Split<TYPE>::cells)/sizeof(Split<TYPE>::cells[0])),
+    Split<TYPE>::cells
+  };
+  return &t;
+}
+
+} // namespace
+
+
+#define TESSELLATION_CASE(TYPE) case TYPE: return table<TYPE>();
+
+const Tessellation::Table* Tessellation::cells(int32_t type)
+{
+  switch( type ) {
+    TESSELLATION_CASE(TINF_TETRA_4)
+    TESSELLATION_CASE(TINF_TETRA_10)
+    TESSELLATION_CASE(TINF_TETRA_16)
+    TESSELLATION_CASE(TINF_TETRA_20)
+    TESSELLATION_CASE(TINF_TETRA_22)
+    TESSELLATION_CASE(TINF_TETRA_34)
+    TESSELLATION_CASE(TINF_TETRA_35)
+    TESSELLATION_CASE(TINF_PYRA_5)
+    TESSELLATION_CASE(TINF_PYRA_13)
+    TESSELLATION_CASE(TINF_PYRA_14)
+    TESSELLATION_CASE(TINF_PYRA_21)
+    TESSELLATION_CASE(TINF_PYRA_29)
+    TESSELLATION_CASE(TINF_PYRA_30)
+    TESSELLATION_CASE(TINF_PYRA_P4_29)
+    TESSELLATION_CASE(TINF_PYRA_50)
+    TESSELLATION_CASE(TINF_PYRA_55)
+    TESSELLATION_CASE(TINF_PENTA_6)
+    TESSELLATION_CASE(TINF_PENTA_15)
+    TESSELLATION_CASE(TINF_PENTA_18)
+    TESSELLATION_CASE(TINF_PENTA_24)
+    TESSELLATION_CASE(TINF_PENTA_33)
+    TESSELLATION_CASE(TINF_PENTA_38)
+    TESSELLATION_CASE(TINF_PENTA_40)
+    TESSELLATION_CASE(TINF_PENTA_66)
+    TESSELLATION_CASE(TINF_PENTA_75)
+    TESSELLATION_CASE(TINF_HEXA_8)
+    TESSELLATION_CASE(TINF_HEXA_20)
+    TESSELLATION_CASE(TINF_HEXA_27)
+    TESSELLATION_CASE(TINF_HEXA_32)
+    TESSELLATION_CASE(TINF_HEXA_44)
+    TESSELLATION_CASE(TINF_HEXA_56)
+    TESSELLATION_CASE(TINF_HEXA_64)
+    TESSELLATION_CASE(TINF_HEXA_98)
+    TESSELLATION_CASE(TINF_HEXA_125)
+    default: return NULL;
+  }
+}
+
+const Tessellation::Table* Tessellation::faces(int32_t type)
+{
+  switch( type ) {
+    TESSELLATION_CASE(TINF_TRI_3)
+    TESSELLATION_CASE(TINF_TRI_6)
+    TESSELLATION_CASE(TINF_TRI_9)
+    TESSELLATION_CASE(TINF_TRI_10)
+    TESSELLATION_CASE(TINF_TRI_12)
+    TESSELLATION_CASE(TINF_TRI_15)
+    TESSELLATION_CASE(TINF_QUAD_4)
+    TESSELLATION_CASE(TINF_QUAD_8)
+    TESSELLATION_CASE(TINF_QUAD_9)
+    TESSELLATION_CASE(TINF_QUAD_12)
+    TESSELLATION_CASE(TINF_QUAD_16)
+    TESSELLATION_CASE(TINF_QUAD_P4_16)
+    TESSELLATION_CASE(TINF_QUAD_25)
+    default: return NULL;
+  }
+}
+
+#undef TESSELLATION_CASE
+
+int32_t Tessellation::nodesPerElement(int32_t type)
+{
+  switch( type ) {
+    case TINF_TRI_3:        return 3;
+    case TINF_TRI_6:        return 6;
+    case TINF_TRI_9:        return 9;
+    case TINF_TRI_10:       return 10;
+    case TINF_TRI_12:       return 12;
+    case TINF_TRI_15:       return 15;
+    case TINF_QUAD_4:       return 4;
+    case TINF_QUAD_8:       return 8;
+    case TINF_QUAD_9:       return 9;
+    case TINF_QUAD_12:      return 12;
+    case TINF_QUAD_16:      return 16;
+    case TINF_QUAD_P4_16:   return 16;
+    case TINF_QUAD_25:      return 25;
+    case TINF_TETRA_4:      return 4;
+    case TINF_TETRA_10:     return 10;
+    case TINF_TETRA_16:     return 16;
+    case TINF_TETRA_20:     return 20;
+    case TINF_TETRA_22:     return 22;
+    case TINF_TETRA_34:     return 34;
+    case TINF_TETRA_35:     return 35;
+    case TINF_PYRA_5:       return 5;
+    case TINF_PYRA_13:      return 13;
+    case TINF_PYRA_14:      return 14;
+    case TINF_PYRA_21:      return 21;
+    case TINF_PYRA_29:      return 29;
+    case TINF_PYRA_30:      return 30;
+    case TINF_PYRA_P4_29:   return 29;
+    case TINF_PYRA_50:      return 50;
+    case TINF_PYRA_55:      return 55;
+    case TINF_PENTA_6:      return 6;
+    case TINF_PENTA_15:     return 15;
+    case TINF_PENTA_18:     return 18;
+    case TINF_PENTA_24:     return 24;
+    case TINF_PENTA_33:     return 33;
+    case TINF_PENTA_38:     return 38;
+    case TINF_PENTA_40:     return 40;
+    case TINF_PENTA_66:     return 66;
+    case TINF_PENTA_75:     return 75;
+    case TINF_HEXA_8:       return 8;
+    case TINF_HEXA_20:      return 20;
+    case TINF_HEXA_27:      return 27;
+    case TINF_HEXA_32:      return 32;
+    case TINF_HEXA_44:      return 44;
+    case TINF_HEXA_56:      return 56;
+    case TINF_HEXA_64:      return 64;
+    case TINF_HEXA_98:      return 98;
+    case TINF_HEXA_125:     return 125;
+    default:                return 0;
+  }
+}
+
+int32_t Tessellation::cellSize(int32_t celltype)
+{
+  switch( celltype ) {
+    case KB_CELLTYPE_TRI:   return 3;
+    case KB_CELLTYPE_QUAD:  return 4;
+    case KB_CELLTYPE_TET:   return 4;
+    case KB_CELLTYPE_PYR:   return 5;
+    case KB_CELLTYPE_WEDGE: return 6;
+    case KB_CELLTYPE_HEX:   return 8;
+  }
+  throw std::runtime_error("Unsupported cell type for tessellation");
+}
+
+
+Tessellation::Tessellation(void* mesh, int32_t nthreads) :
+  m_mesh(mesh), m_nthreads(std::max(nthreads, 1))
+{
+  build();
+}
+
+/*
+ * Count the sub-cells of every element, then fill the connectivity at the
+ * offsets of their elements, both passes split over threads.
+ */
+void Tessellation::build()
+{
+  int error;
+
+  int64_t nelem = tinf_mesh_element_count(m_mesh, &error);
+  TINF_CHECK_SUCCESS(error, "Could not get number of elements");
+  int64_t part = tinf_mesh_partition_id(m_mesh, &error);
+  TINF_CHECK_SUCCESS(error, "Could not get mesh partition Id");
+
+  std::vector<const Table*> tables(nelem);
+  std::vector<int64_t> ncells(nelem+1, 0);
+  std::vector<int64_t> lconn(nelem+1, 0);
+  std::atomic<int32_t> status(TINF_SUCCESS);
+
+  parallel(nelem, [&](int64_t begin, int64_t end) {
+    int32_t err;
+    for( int64_t i=begin; i<end; ++i ) {
+      const Table* t = cells(tinf_mesh_element_type(m_mesh, i, &err));
+      if( TINF_SUCCESS != err )
+        status = err;
+      tables[i] = t;
+      if( NULL == t )
+        continue;
+
+      ncells[i+1] = t->ncells;
+      for( int32_t c=0; c<t->ncells; ++c )
+        lconn[i+1] += 1 + cellSize(t->cells[c][0]);
+    }
+  });
+  TINF_CHECK_SUCCESS(status, "Could not get element type");
+
+  std::partial_sum(ncells.begin(), ncells.end(), ncells.begin());
+  std::partial_sum(lconn.begin(), lconn.end(), lconn.begin());
+
+  m_conn.resize(lconn[nelem]);
+  m_elements.resize(ncells[nelem]);
+  m_owned.resize(ncells[nelem]);
+
+  parallel(nelem, [&](int64_t begin, int64_t end) {
+    int64_t nodes[MAX_NODES];
+    int32_t err;
+    for( int64_t i=begin; i<end; ++i ) {
+      const Table* t = tables[i];
+      if( NULL == t )
+        continue;
+
+      err = tinf_mesh_element_nodes(m_mesh, i, nodes);
+      if( TINF_SUCCESS != err ) {
+        status = err;
+        continue;
+      }
+      int32_t owned = (int32_t)(part == tinf_mesh_element_owner(m_mesh, i,
+                                                                  &err));
+      if( TINF_SUCCESS != err )
+        status = err;
+
+      int32_t* conn = &m_conn[lconn[i]];
+      for( int64_t c=0, k=ncells[i]; c<t->ncells; ++c, ++k ) {
+        const int32_t* row = t->cells[c];
+        int32_t n = cellSize(row[0]);
+        *conn++ = row[0];
+        for( int32_t j=1; j<=n; ++j )
+          *conn++ = (int32_t)nodes[row[j]];
+        m_elements[k] = i;
+        m_owned[k] = owned;
+      }
+    }
+  });
+  TINF_CHECK_SUCCESS(status, "Could not get element connectivity");
+}
+
+/*
+ * Run f(begin, end) over contiguous element ranges on the threads.
+ */
+template<class F> void Tessellation::parallel(int64_t n, F f)
+{
+  int64_t chunk = (n + m_nthreads - 1)/m_nthreads;
+
+  std::vector<std::thread> threads;
+  for( int32_t t=1; t<m_nthreads; ++t ) {
+    int64_t begin = std::min(t*chunk, n);
+    int64_t end = std::min(begin + chunk, n);
+    threads.push_back(std::thread(f, begin, end));
+  }
+  f(0, std::min(chunk, n));
+
+  std::vector<std::thread>::iterator it;
+  for(it = threads.begin(); it != threads.end(); ++it)
+    it->join();
+}
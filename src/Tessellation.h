@@ -0,0 +1,102 @@
+#pragma once
+
+/*
+ *  Notices:
+ *  Copyright 2023 United States Government as represented by the
+ *  Administrator of the National Aeronautics and Space Administration.
+ *  No copyright is claimed in the United States under Title 17,
+ *  U.S. Code. All Other Rights Reserved.
+ *
+ *  Disclaimers No Warranty: THE SUBJECT SOFTWARE IS PROVIDED "AS
+ *  IS" WITHOUT ANY WARRANTY OF ANY KIND, EITHER EXPRESSED, IMPLIED,
+ *  OR STATUTORY, INCLUDING, BUT NOT LIMITED TO, ANY WARRANTY THAT
+ *  THE SUBJECT SOFTWARE WILL CONFORM TO SPECIFICATIONS, ANY IMPLIED
+ *  WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE,
+ *  OR FREEDOM FROM INFRINGEMENT, ANY WARRANTY THAT THE SUBJECT
+ *  SOFTWARE WILL BE ERROR FREE, OR ANY WARRANTY THAT DOCUMENTATION,
+ *  IF PROVIDED, WILL CONFORM TO THE SUBJECT SOFTWARE. THIS AGREEMENT
+ *  DOES NOT, IN ANY MANNER, CONSTITUTE AN ENDORSEMENT BY GOVERNMENT
+ *  AGENCY OR ANY PRIOR RECIPIENT OF ANY RESULTS, RESULTING DESIGNS,
+ *  HARDWARE, SOFTWARE PRODUCTS OR ANY OTHER APPLICATIONS RESULTING
+ *  FROM USE OF THE SUBJECT SOFTWARE.  FURTHER, GOVERNMENT AGENCY
+ *  DISCLAIMS ALL WARRANTIES AND LIABILITIES REGARDING THIRD-PARTY
+ *  SOFTWARE, IF PRESENT IN THE ORIGINAL SOFTWARE, AND DISTRIBUTES
+ *  IT "AS IS." 
+ *
+ *  Waiver and Indemnity:  RECIPIENT AGREES TO WAIVE ANY AND ALL
+ *  CLAIMS AGAINST THE UNITED STATES GOVERNMENT, ITS CONTRACTORS
+ *  AND SUBCONTRACTORS, AS WELL AS ANY PRIOR RECIPIENT.  IF RECIPIENT'S
+ *  USE OF THE SUBJECT SOFTWARE RESULTS IN ANY LIABILITIES, DEMANDS,
+ *  DAMAGES, EXPENSES OR LOSSES ARISING FROM SUCH USE, INCLUDING
+ *  ANY DAMAGES FROM PRODUCTS BASED ON, OR RESULTING FROM, RECIPIENT'S
+ *  USE OF THE SUBJECT SOFTWARE, RECIPIENT SHALL INDEMNIFY AND HOLD
+ *  HARMLESS THE UNITED STATES GOVERNMENT, ITS CONTRACTORS AND
+ *  SUBCONTRACTORS, AS WELL AS ANY PRIOR RECIPIENT, TO THE EXTENT
+ *  PERMITTED BY LAW.  RECIPIENT'S SOLE REMEDY FOR ANY SUCH MATTER
+ *  SHALL BE THE IMMEDIATE, UNILATERAL TERMINATION OF THIS AGREEMENT.
+ */
+
+#include <vector>
+#include <cstdint>
+
+namespace VisKombyne
+{
+
+/**
+ * Linear sub-tessellation of the mesh elements.
+ *
+ * High-order cells are split into linear sub-cells on their edge, face
+ * and interior nodes by per-type split tables.  Element types whose extra
+ * nodes do not form a lattice of linear cells (serendipity and cubic and
+ * higher orders) keep their corner cell.  The tessellation is built once
+ * when the mesh is ingested; the topology is static, moving meshes only
+ * update the node coordinates, so it costs nothing per step.  With more
+ * than one thread the element reads run concurrently, which requires a
+ * thread-safe tinf_mesh implementation.
+ */
+class Tessellation
+{
+  public:
+    /** Sub-cells of an element type, rows of {celltype, nodes...} */
+    struct Table
+    {
+      int32_t ncells;
+      const int32_t (*cells)[9];
+    };
+
+    /** Split table of a volume element type, NULL for other types */
+    static const Table* cells(int32_t type);
+    /** Split table of a face element type, NULL for other types */
+    static const Table* faces(int32_t type);
+    /** Nodes of an element type, 0 for unsupported types */
+    static int32_t nodesPerElement(int32_t type);
+    /** Nodes of a linear cell type */
+    static int32_t cellSize(int32_t celltype);
+
+    /** Largest number of nodes of an element */
+    static const int32_t MAX_NODES = 125;
+
+    Tessellation(void* mesh, int32_t nthreads=1);
+
+    inline int64_t nCells() const { return m_elements.size(); }
+    /** Sub-cell connectivity, {celltype, nodes...} per cell */
+    inline const std::vector<int32_t>& connectivity() const { return m_conn; }
+    /** Mesh element of each sub-cell */
+    inline const std::vector<int64_t>& elements() const { return m_elements; }
+    /** Sub-cells of elements owned by this partition */
+    inline const std::vector<int32_t>& owned() const { return m_owned; }
+
+  private:
+    void build();
+    template<class F> void parallel(int64_t n, F f);
+
+  private:
+    void* m_mesh;
+    int32_t m_nthreads;
+
+    std::vector<int32_t> m_conn;
+    std::vector<int64_t> m_elements;
+    std::vector<int32_t> m_owned;
+};
+
+} // namespace VisKombyne
@@ -40,32 +40,33 @@
 
 #include <exception>
 #include <cstdlib>
+#include <cmath>
 #include <string>
 #include <sstream>
 #include <algorithm>
 #include <iterator>
 #include <iostream>
+#include <future>
 
 #include "UMesh.h"
 #include "tinf_mesh.h"
 #include "tinf_iris.h"
+#include "Tessellation.h"
 #include "pancake_cxx/Problem.h"
 #include "kombyne_data_celltype.h"
+#include "TinfCheck.h"
 
 using namespace VisKombyne;
 
-#define TINF_CHECK_SUCCESS(error, msg) ({ \
-  if( TINF_SUCCESS != error ) { \
-    std::stringstream ss; \
-    ss << error; \
-    std::string message = std::string(msg) + ": " + ss.str(); \
-    throw std::runtime_error(message.c_str()); \
-  } \
-})
+const int64_t UMesh::NODE_BLOCK;
 
 
 UMesh::UMesh(void* prob, void* mesh, void* comm) :
-  m_mesh(mesh), m_comm(comm), m_moving(false)
+  m_mesh(mesh), m_comm(comm), m_moving(false), m_changed(true),
+  m_generation(0), m_tolerance(0.0), m_nthreads(1), m_rigid(NULL),
+  m_nnodes01(0), m_x(NULL), m_y(NULL), m_z(NULL), m_ncell01(0), m_lconn(0),
+  m_cellconnects(NULL), m_ghost_nodes(NULL), m_ghost_cells(NULL),
+  m_sync(NULL)
 {
   int error;
 
@@ -74,6 +75,8 @@ UMesh::UMesh(void* prob, void* mesh, void* comm) :
   problem.value("bc:family", families);
   std::vector<int64_t> tags;
   problem.value("bc:tag", tags);
+  problem.value("kombyne:grid_change_tolerance", &m_tolerance);
+  problem.value("kombyne:mesh_threads", &m_nthreads);
 
 //if( 0 == tinf_iris_rank(comm, &error) ) {
 //  std::vector<std::string>::iterator it;
@@ -84,15 +87,37 @@ UMesh::UMesh(void* prob, void* mesh, void* comm) :
 //    std::cerr << "Corresponding Boundary Tag: " << *t << std::endl;
 //}
 
-  addNodes();
-  buildConnectivity();
-  flagGhostNodes();
-  flagGhostCells();
-  addBoundaries(families, tags);
+  /* The tinf_mesh interface makes no thread-safety promise, so the mesh is
+   * ingested serially unless kombyne:mesh_threads asks for more, in which
+   * case the mesh implementation must allow concurrent tinf_mesh_* calls,
+   * also alongside the caller's own initialization. */
+  if( m_nthreads <= 1 ) {
+    addNodes();
+    buildConnectivity();
+    flagGhostNodes();
+    addBoundaries(families, tags);
+    return;
+  }
+
+  /* Ingest the mesh on worker threads so that the caller can proceed with
+   * its own initialization; join() must be called before the mesh is used. */
+  m_nodes_task = std::async(std::launch::async,
+                            [this]() { addNodes(); flagGhostNodes(); });
+  m_cells_task = std::async(std::launch::async,
+                            [this]() { buildConnectivity(); });
+  m_bound_task = std::async(std::launch::async,
+                            [this, families, tags]() {
+                              addBoundaries(families, tags);
+                            });
 }
 
 UMesh::~UMesh()
 {
+  wait();
+
+  if( m_sync )
+    tinf_iris_delete_sync_pattern(m_comm, m_sync);
+  delete m_rigid;
   free(m_ghost_cells);
   free(m_ghost_nodes);
   free(m_cellconnects);
@@ -101,6 +126,20 @@ UMesh::~UMesh()
   free(m_z);
 }
 
+void UMesh::join()
+{
+  if( m_nodes_task.valid() ) m_nodes_task.get();
+  if( m_cells_task.valid() ) m_cells_task.get();
+  if( m_bound_task.valid() ) m_bound_task.get();
+}
+
+void UMesh::wait()
+{
+  if( m_nodes_task.valid() ) m_nodes_task.wait();
+  if( m_cells_task.valid() ) m_cells_task.wait();
+  if( m_bound_task.valid() ) m_bound_task.wait();
+}
+
 void UMesh::addNodes()
 {
   int error;
@@ -115,6 +154,7 @@ void UMesh::addNodes()
     if( m_z ) free(m_z);
     if( m_y ) free(m_y);
     if( m_x ) free(m_x);
+    m_x = m_y = m_z = NULL;
     throw std::runtime_error("Failed to allocate Node coordinates");
   }
 
@@ -130,127 +170,162 @@ void UMesh::getNodes()
   TINF_CHECK_SUCCESS(error, "Could not get mesh coordinates");
 }
 
-void UMesh::buildConnectivity()
+void UMesh::syncNodes(double* values)
 {
-  int32_t       error;
-
-  int64_t ntet  = tinf_mesh_element_type_count(m_mesh, TINF_TETRA_4, &error);
-  TINF_CHECK_SUCCESS(error, "Could not get number of Tets");
-  int64_t npyr  = tinf_mesh_element_type_count(m_mesh, TINF_PYRA_5, &error);
-  TINF_CHECK_SUCCESS(error, "Could not get number of Pyramids");
-  int64_t nprz  = tinf_mesh_element_type_count(m_mesh, TINF_PENTA_6, &error);
-  TINF_CHECK_SUCCESS(error, "Could not get number of Prisms");
-  int64_t nhex  = tinf_mesh_element_type_count(m_mesh, TINF_HEXA_8, &error);
-  TINF_CHECK_SUCCESS(error, "Could not get number of Hexes");
-
-  m_lconn = 5*ntet+6*npyr+7*nprz+9*nhex;
-  if( (m_cellconnects=(int32_t*)malloc(m_lconn*sizeof(int32_t))) == NULL ) {
-    throw std::runtime_error("Could not allocate cell connectivity");
+  int error;
+
+  /* The pattern is built on first use, few configurations need it */
+  if( NULL == m_sync ) {
+    std::vector<int64_t> global(m_nnodes01);
+    std::vector<int64_t> have, need;
+    for( int64_t i=0; i<m_nnodes01; ++i ) {
+      global[i] = tinf_mesh_global_node_id(m_mesh, i, &error);
+      TINF_CHECK_SUCCESS(error, "Could not get global node Id");
+      if( m_ghost_nodes[i] )
+        have.push_back(i);
+      else
+        need.push_back(i);
+    }
+    m_sync = tinf_iris_build_sync_pattern(m_comm, global.data(),
+                                          global.size(), have.data(),
+                                          have.size(), need.data(),
+                                          need.size(), &error);
+    TINF_CHECK_SUCCESS(error, "Could not build node sync pattern");
   }
-  int64_t cellconnect[8];
 
-  /* Assign connectivity */
+  size_t dims[TINF_DATA_MAX_RANK] = {(size_t)m_nnodes01, 1};
+  error = tinf_iris_sync(m_comm, m_sync, TINF_DOUBLE, 1, dims, values);
+  TINF_CHECK_SUCCESS(error, "Could not sync ghost nodes");
+}
 
-  int64_t lconn = 0;
-  m_ncell01 = 0;
+void UMesh::blankCells(const std::vector<char>& blanked)
+{
+  m_blanked = blanked;
+  m_active.resize(m_ncell01);
+  for( int64_t c=0; c<m_ncell01; ++c )
+    m_active[c] = m_ghost_cells[c] && !blanked[c];
+}
 
-  for( int64_t i=0; i<tinf_mesh_element_count(m_mesh,&error); ++i ) {
-    switch( tinf_mesh_element_type(m_mesh, i, &error) ) {
-//    case TINF_TRI_3:
-//      m_cellconnects[lconn++] = KB_CELLTYPE_TRI;
-//      error = tinf_mesh_element_nodes(m_mesh, i, cellconnect);
-//      std::copy(cellconnect, cellconnect+3, &m_cellconnects[lconn]);
-//      lconn += 3;
-//      m_ncell01++;
-//      break;
-//    case TINF_QUAD_4:
-//      m_cellconnects[lconn++] = KB_CELLTYPE_QUAD;
-//      error = tinf_mesh_element_nodes(m_mesh, i, cellconnect);
-//      std::copy(cellconnect, cellconnect+4, &m_cellconnects[lconn]);
-//      lconn += 4;
-//      m_ncell01++;
-//      break;
-      case TINF_TETRA_4:
-        m_cellconnects[lconn++] = KB_CELLTYPE_TET;
-        error = tinf_mesh_element_nodes(m_mesh, i, cellconnect);
-        TINF_CHECK_SUCCESS(error, "Could not get Tet connectivity");
-        std::copy(cellconnect, cellconnect+4, &m_cellconnects[lconn]);
-        lconn += 4;
-        m_ncell01++;
-        break;
-      case TINF_PYRA_5:
-        m_cellconnects[lconn++] = KB_CELLTYPE_PYR;
-        error = tinf_mesh_element_nodes(m_mesh, i, cellconnect);
-        TINF_CHECK_SUCCESS(error, "Could not get Pyramid connectivity");
-        std::copy(cellconnect, cellconnect+5, &m_cellconnects[lconn]);
-        lconn += 5;
-        m_ncell01++;
-        break;
-      case TINF_PENTA_6:
-        m_cellconnects[lconn++] = KB_CELLTYPE_WEDGE;
-        error = tinf_mesh_element_nodes(m_mesh, i, cellconnect);
-        TINF_CHECK_SUCCESS(error, "Could not get Prism connectivity");
-        std::copy(cellconnect, cellconnect+6, &m_cellconnects[lconn]);
-        lconn += 6;
-        m_ncell01++;
-        break;
-      case TINF_HEXA_8:
-        m_cellconnects[lconn++] = KB_CELLTYPE_HEX;
-        error = tinf_mesh_element_nodes(m_mesh, i, cellconnect);
-        TINF_CHECK_SUCCESS(error, "Could not get Hex connectivity");
-        std::copy(cellconnect, cellconnect+8, &m_cellconnects[lconn]);
-        lconn += 8;
-        m_ncell01++;
-        break;
-    }
-  }
-  if( m_lconn != lconn )
-    throw std::runtime_error("Missing Cells");
+void UMesh::rigidMotion(void* prob, void* soln, double time)
+{
+  int error;
+
+  if( !RigidMotion::requested(prob) )
+    return;
+
+  m_rigid = new RigidMotion(prob, m_mesh, soln, m_comm, time, m_x, m_y, m_z);
+
+  /* Nodes outside every body (e.g. an overset background grid) are static
+   * unless their elements are tagged as deforming */
+  double count[2] = { (double)m_rigid->nStatic(),
+                      (double)m_rigid->nDeforming() };
+  double global[2];
+  size_t dims[TINF_DATA_MAX_RANK] = {2, 1};
+  error = tinf_iris_sum(m_comm, TINF_DOUBLE, 1, dims, count, global);
+  TINF_CHECK_SUCCESS(error, "Could not reduce rigid motion nodes");
+
+  if( 0 == tinf_iris_rank(m_comm, &error) )
+    std::cerr << "Rigid motion: " << (int64_t)global[0] << " static and "
+              << (int64_t)global[1] << " deforming nodes" << std::endl;
 }
 
-void UMesh::flagGhostNodes()
+void UMesh::updateCoordinates(double time)
 {
   int error;
 
-  if( (m_ghost_nodes=(int32_t*)malloc(m_nnodes01*sizeof(int32_t))) == NULL)
-    throw std::runtime_error("Could not allocate ghost nodes");
+  m_changed = false;
 
-  int64_t part = tinf_mesh_partition_id(m_mesh, &error);
-  TINF_CHECK_SUCCESS(error, "Could not get mesh partition Id");
+  if( !m_moving )
+    return;
 
-  for( int64_t i=0; i<m_nnodes01; ++i ) {
-    m_ghost_nodes[i] = (int)(part == tinf_mesh_node_owner(m_mesh, i, &error));
-    TINF_CHECK_SUCCESS(error, "Could not get node owner");
+  /* Rigid motion only needs the body transforms, fall back to retrieving
+   * the coordinates of deforming meshes. */
+  if( m_rigid ) {
+    m_changed = m_rigid->apply(time, m_x, m_y, m_z);
+  } else {
+    m_changed = refreshNodes();
   }
+
+  /* The generation gates collective work (e.g. Region), it must advance on
+   * every rank when the grid moved on any */
+  int32_t local = m_changed ? 1 : 0, changed = 0;
+  size_t dims[TINF_DATA_MAX_RANK] = {1, 1};
+  error = tinf_iris_max(m_comm, TINF_INT32, 0, dims, &local, &changed);
+  TINF_CHECK_SUCCESS(error, "Could not reduce grid changes");
+
+  if( changed )
+    ++m_generation;
 }
 
-void UMesh::flagGhostCells()
+bool UMesh::refreshNodes()
 {
   int error;
+  bool changed = false;
+
+  std::vector<double> x(NODE_BLOCK), y(NODE_BLOCK), z(NODE_BLOCK);
+
+  /* Only overwrite the blocks displaced by more than the tolerance, the
+   * remaining ones are left untouched in the arrays borrowed by Kombyne. */
+  for( int64_t start=0; start<m_nnodes01; start+=NODE_BLOCK ) {
+    int64_t cnt = std::min(NODE_BLOCK, m_nnodes01-start);
+
+    error = tinf_mesh_nodes_coordinates(m_mesh, TINF_DOUBLE, start, cnt,
+                                        x.data(), y.data(), z.data());
+    TINF_CHECK_SUCCESS(error, "Could not get mesh coordinates");
+
+    const double* __restrict__ xc = m_x+start;
+    const double* __restrict__ yc = m_y+start;
+    const double* __restrict__ zc = m_z+start;
+    double dmax = 0.0;
+    for( int64_t i=0; i<cnt; ++i ) {
+      double d = std::max(std::max(std::fabs(x[i]-xc[i]), std::fabs(y[i]-yc[i])),
+                          std::fabs(z[i]-zc[i]));
+      dmax = std::max(dmax, d);
+    }
+
+    if( dmax > m_tolerance ) {
+      std::copy(x.begin(), x.begin()+cnt, m_x+start);
+      std::copy(y.begin(), y.begin()+cnt, m_y+start);
+      std::copy(z.begin(), z.begin()+cnt, m_z+start);
+      changed = true;
+    }
+  }
+
+  return changed;
+}
+
+void UMesh::buildConnectivity()
+{
+  Tessellation tess(m_mesh, m_nthreads);
+
+  m_ncell01 = tess.nCells();
+  m_lconn = tess.connectivity().size();
+  if( (m_cellconnects=(int32_t*)malloc(m_lconn*sizeof(int32_t))) == NULL ) {
+    throw std::runtime_error("Could not allocate cell connectivity");
+  }
+  std::copy(tess.connectivity().begin(), tess.connectivity().end(),
+            m_cellconnects);
+  m_cell_elements = tess.elements();
 
   if( (m_ghost_cells=(int32_t*)malloc(m_ncell01*sizeof(int32_t))) == NULL) {
     throw std::runtime_error("Could not allocate ghost cells");
   }
+  std::copy(tess.owned().begin(), tess.owned().end(), m_ghost_cells);
+}
+
+void UMesh::flagGhostNodes()
+{
+  int error;
+
+  if( (m_ghost_nodes=(int32_t*)malloc(m_nnodes01*sizeof(int32_t))) == NULL)
+    throw std::runtime_error("Could not allocate ghost nodes");
 
   int64_t part = tinf_mesh_partition_id(m_mesh, &error);
   TINF_CHECK_SUCCESS(error, "Could not get mesh partition Id");
 
-  int64_t ncell01 = 0;
-
-  for( int64_t i=0; i<tinf_mesh_element_count(m_mesh,&error); ++i ) {
-    switch( tinf_mesh_element_type(m_mesh, i, &error) ) {
-//    case TINF_TRI_3:
-//    case TINF_QUAD_4:
-      case TINF_TETRA_4:
-      case TINF_PYRA_5:
-      case TINF_PENTA_6:
-      case TINF_HEXA_8:
-        m_ghost_cells[ncell01++] = (int)(part == tinf_mesh_element_owner(m_mesh,
-                                                                       i,
-                                                                       &error));
-        TINF_CHECK_SUCCESS(error, "Could not get cell owner");
-        break;
-    }
+  for( int64_t i=0; i<m_nnodes01; ++i ) {
+    m_ghost_nodes[i] = (int)(part == tinf_mesh_node_owner(m_mesh, i, &error));
+    TINF_CHECK_SUCCESS(error, "Could not get node owner");
   }
 }
 
@@ -259,12 +334,7 @@ void UMesh::addBoundaries(std::vector<std::string> families,
 {
   int error;
 
-  int64_t ntri  = tinf_mesh_element_type_count(m_mesh, TINF_TRI_3, &error);
-  TINF_CHECK_SUCCESS(error, "Could not get Triangle element count");
-  int64_t nquad = tinf_mesh_element_type_count(m_mesh, TINF_QUAD_4, &error);
-  TINF_CHECK_SUCCESS(error, "Could not get Quad element count");
-
-  std::vector<int64_t> tags = boundaryTags(ntri, nquad);
+  std::vector<int64_t> tags = boundaryTags();
 
   m_bound.reserve(tags.size());
 
@@ -282,19 +352,16 @@ void UMesh::addBoundaries(std::vector<std::string> families,
   }
 }
 
-std::vector<int64_t> UMesh::boundaryTags(int64_t ntri, int64_t nquad)
+std::vector<int64_t> UMesh::boundaryTags()
 {
   int error;
 
-  std::vector<int64_t> v(ntri+nquad,0);
+  std::vector<int64_t> v;
 
-  for( int64_t i=0, j=0; i<tinf_mesh_element_count(m_mesh,&error); ++i ) {
-    switch( tinf_mesh_element_type(m_mesh, i, &error) ) {
-      case TINF_TRI_3:
-      case TINF_QUAD_4:
-        v[j++] = tinf_mesh_element_tag(m_mesh, i, &error);
-        TINF_CHECK_SUCCESS(error, "Could not get boundary tag");
-        break;
+  for( int64_t i=0; i<tinf_mesh_element_count(m_mesh,&error); ++i ) {
+    if( Tessellation::faces(tinf_mesh_element_type(m_mesh, i, &error)) ) {
+      v.push_back(tinf_mesh_element_tag(m_mesh, i, &error));
+      TINF_CHECK_SUCCESS(error, "Could not get boundary tag");
     }
   }
 
@@ -312,24 +379,32 @@ void UMesh::addBoundary(int64_t tag, std::string& family)
   m_bound.push_back(Boundary(tag,family));
   Boundary& bound = m_bound.back();
 
-  int64_t nodes[4];
+  int64_t part = tinf_mesh_partition_id(m_mesh, &error);
+  TINF_CHECK_SUCCESS(error, "Could not get mesh partition Id");
+
+  int64_t nodes[Tessellation::MAX_NODES];
+  int64_t face[4];
 
+  /* High-order faces are added as their linear sub-faces */
   for( int64_t i=0; i<tinf_mesh_element_count(m_mesh,&error); ++i ) {
-    switch( tinf_mesh_element_type(m_mesh, i, &error) ) {
-      case TINF_TRI_3:
-        if( tinf_mesh_element_tag(m_mesh, i, &error) == tag ) {
-          error = tinf_mesh_element_nodes(m_mesh, i, nodes);
-          TINF_CHECK_SUCCESS(error, "Could not get Triangle element nodes");
-          bound.addTri(nodes);
-        }
-        break;
-      case TINF_QUAD_4:
-        if( tinf_mesh_element_tag(m_mesh, i, &error) == tag ) {
-          error = tinf_mesh_element_nodes(m_mesh, i, nodes);
-          TINF_CHECK_SUCCESS(error, "Could not get Quad element nodes");
-          bound.addQuad(nodes);
-        }
-        break;
+    const Tessellation::Table* t;
+    t = Tessellation::faces(tinf_mesh_element_type(m_mesh, i, &error));
+    if( NULL == t || tinf_mesh_element_tag(m_mesh, i, &error) != tag )
+      continue;
+
+    error = tinf_mesh_element_nodes(m_mesh, i, nodes);
+    TINF_CHECK_SUCCESS(error, "Could not get boundary element nodes");
+    bool owned = part == tinf_mesh_element_owner(m_mesh, i, &error);
+
+    for( int32_t c=0; c<t->ncells; ++c ) {
+      const int32_t* row = t->cells[c];
+      int32_t n = Tessellation::cellSize(row[0]);
+      for( int32_t j=0; j<n; ++j )
+        face[j] = nodes[row[j+1]];
+      if( KB_CELLTYPE_TRI == row[0] )
+        bound.addTri(face, owned);
+      else
+        bound.addQuad(face, owned);
     }
   }
 }
@@ -38,6 +38,9 @@
 
 #include <string>
 #include <vector>
+#include <future>
+
+#include "RigidMotion.h"
 
 namespace VisKombyne
 {
@@ -47,7 +50,8 @@ class Boundary
   public:
 #ifdef TEST_CONSTRUCTION
     Boundary(const Boundary& copy) : m_tag(copy.m_tag), m_name(copy.m_name),
-      m_tris(copy.m_tris), m_quads(copy.m_quads)
+      m_tris(copy.m_tris), m_quads(copy.m_quads),
+      m_tri_owned(copy.m_tri_owned), m_quad_owned(copy.m_quad_owned)
     { std::cerr << "Copy Construct Boundary " << copy.m_tag << std::endl; }
     Boundary(int64_t tag, std::string name) : m_tag(tag), m_name(name)
     { std::cerr << "Construct Boundary " << m_tag << std::endl; }
@@ -58,21 +62,27 @@ class Boundary
 
     Boundary(int64_t tag, std::string& name) : m_tag(tag), m_name(name) {}
 
-    inline void addTri(int64_t nodes[3])
-      { m_tris.insert(m_tris.end(), nodes, nodes+3); }
-    inline void addQuad(int64_t nodes[4])
-      { m_quads.insert(m_quads.end(), nodes, nodes+4); }
+    inline void addTri(int64_t nodes[3], bool owned)
+      { m_tris.insert(m_tris.end(), nodes, nodes+3);
+        m_tri_owned.push_back(owned); }
+    inline void addQuad(int64_t nodes[4], bool owned)
+      { m_quads.insert(m_quads.end(), nodes, nodes+4);
+        m_quad_owned.push_back(owned); }
 
     inline int64_t tag() const { return m_tag; }
     inline std::string name() const { return m_name; }
     inline std::vector<int32_t>& tris() { return m_tris; }
     inline std::vector<int32_t>& quads() { return m_quads; }
+    inline const std::vector<char>& triOwned() const { return m_tri_owned; }
+    inline const std::vector<char>& quadOwned() const { return m_quad_owned; }
 
   private:
     int64_t m_tag;
     std::string m_name;
     std::vector<int32_t> m_tris;
     std::vector<int32_t> m_quads;
+    std::vector<char> m_tri_owned;
+    std::vector<char> m_quad_owned;
 };
 
 
@@ -82,10 +92,15 @@ class UMesh
     UMesh(void* prob, void* mesh, void* comm);
     virtual ~UMesh();
 
+    void join();
     void getNodes();
+    void rigidMotion(void* prob, void* soln, double time);
+    void updateCoordinates(double time);
     inline void moving(bool moving) { m_moving = moving; }
     inline bool moving() { return m_moving; }
-    inline void updateCoordinates() { if( m_moving ) getNodes(); }
+    inline bool changed() const { return m_changed; }
+    /** Number of coordinate updates that moved the grid on any rank */
+    inline int64_t generation() const { return m_generation; }
 
     inline int64_t nNodes01() const { return m_nnodes01; }
     inline double* x() { return m_x; }
@@ -96,24 +111,48 @@ class UMesh
     inline int32_t* cellConnects() const { return m_cellconnects; }
     inline int32_t* ghostNodes() const { return m_ghost_nodes; }
     inline int32_t* ghostCells() const { return m_ghost_cells; }
+    /** Owned cells not blanked by an overset assembly */
+    inline const int32_t* activeCells() const
+      { return m_active.empty() ? m_ghost_cells : m_active.data(); }
+    inline bool blanked(int64_t cell) const
+      { return !m_blanked.empty() && m_blanked[cell]; }
+    void blankCells(const std::vector<char>& blanked);
+    /** Mesh element of each cell */
+    inline const std::vector<int64_t>& cellElements() const
+      { return m_cell_elements; }
     inline std::vector<Boundary>& boundaries() { return m_bound; }
 
+    /**
+     * Overwrite the ghost node values of a nodal array with those of the
+     * owning ranks.
+     */
+    void syncNodes(double* values);
+
   private:
+    /** Number of nodes per change-detection block */
+    static const int64_t NODE_BLOCK = 4096;
+
     inline void addNodes();
+    inline bool refreshNodes();
     inline void buildConnectivity();
     inline void addGhostNodes();
     inline void addGhostCells();
     inline void flagGhostNodes();
-    inline void flagGhostCells();
     inline void addBoundaries(std::vector<std::string> families,
                               std::vector<int64_t> bc_tags);
-    inline std::vector<int64_t> boundaryTags(int64_t ntri, int64_t nquad);
+    inline std::vector<int64_t> boundaryTags();
     inline void addBoundary(int64_t tag, std::string& family);
+    inline void wait();
 
   private:
     void* m_mesh;
     void* m_comm;
     bool m_moving;
+    bool m_changed;
+    int64_t m_generation;
+    double m_tolerance;
+    int32_t m_nthreads;
+    RigidMotion* m_rigid;
 
     int64_t m_nnodes01;
     double* m_x;
@@ -124,7 +163,15 @@ class UMesh
     int32_t* m_cellconnects;
     int32_t* m_ghost_nodes;
     int32_t* m_ghost_cells;
+    std::vector<int64_t> m_cell_elements;
+    std::vector<char> m_blanked;
+    std::vector<int32_t> m_active;
     std::vector<Boundary> m_bound;
+    void* m_sync;
+
+    std::future<void> m_nodes_task;
+    std::future<void> m_cells_task;
+    std::future<void> m_bound_task;
 };
 
 } // namespace VisKombyne
@@ -0,0 +1,238 @@
+/*
+ *  Notices:
+ *  Copyright 2023 United States Government as represented by the
+ *  Administrator of the National Aeronautics and Space Administration.
+ *  No copyright is claimed in the United States under Title 17,
+ *  U.S. Code. All Other Rights Reserved.
+ *
+ *  Disclaimers No Warranty: THE SUBJECT SOFTWARE IS PROVIDED "AS
+ *  IS" WITHOUT ANY WARRANTY OF ANY KIND, EITHER EXPRESSED, IMPLIED,
+ *  OR STATUTORY, INCLUDING, BUT NOT LIMITED TO, ANY WARRANTY THAT
+ *  THE SUBJECT SOFTWARE WILL CONFORM TO SPECIFICATIONS, ANY IMPLIED
+ *  WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE,
+ *  OR FREEDOM FROM INFRINGEMENT, ANY WARRANTY THAT THE SUBJECT
+ *  SOFTWARE WILL BE ERROR FREE, OR ANY WARRANTY THAT DOCUMENTATION,
+ *  IF PROVIDED, WILL CONFORM TO THE SUBJECT SOFTWARE. THIS AGREEMENT
+ *  DOES NOT, IN ANY MANNER, CONSTITUTE AN ENDORSEMENT BY GOVERNMENT
+ *  AGENCY OR ANY PRIOR RECIPIENT OF ANY RESULTS, RESULTING DESIGNS,
+ *  HARDWARE, SOFTWARE PRODUCTS OR ANY OTHER APPLICATIONS RESULTING
+ *  FROM USE OF THE SUBJECT SOFTWARE.  FURTHER, GOVERNMENT AGENCY
+ *  DISCLAIMS ALL WARRANTIES AND LIABILITIES REGARDING THIRD-PARTY
+ *  SOFTWARE, IF PRESENT IN THE ORIGINAL SOFTWARE, AND DISTRIBUTES
+ *  IT "AS IS." 
+ *
+ *  Waiver and Indemnity:  RECIPIENT AGREES TO WAIVE ANY AND ALL
+ *  CLAIMS AGAINST THE UNITED STATES GOVERNMENT, ITS CONTRACTORS
+ *  AND SUBCONTRACTORS, AS WELL AS ANY PRIOR RECIPIENT.  IF RECIPIENT'S
+ *  USE OF THE SUBJECT SOFTWARE RESULTS IN ANY LIABILITIES, DEMANDS,
+ *  DAMAGES, EXPENSES OR LOSSES ARISING FROM SUCH USE, INCLUDING
+ *  ANY DAMAGES FROM PRODUCTS BASED ON, OR RESULTING FROM, RECIPIENT'S
+ *  USE OF THE SUBJECT SOFTWARE, RECIPIENT SHALL INDEMNIFY AND HOLD
+ *  HARMLESS THE UNITED STATES GOVERNMENT, ITS CONTRACTORS AND
+ *  SUBCONTRACTORS, AS WELL AS ANY PRIOR RECIPIENT, TO THE EXTENT
+ *  PERMITTED BY LAW.  RECIPIENT'S SOLE REMEDY FOR ANY SUCH MATTER
+ *  SHALL BE THE IMMEDIATE, UNILATERAL TERMINATION OF THIS AGREEMENT.
+ */
+
+#ifdef __GNUG__
+  #pragma implementation "VTKWriter.h"
+#endif
+
+#include <exception>
+#include <stdexcept>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <sstream>
+#include <algorithm>
+
+#include "VTKWriter.h"
+#include "tinf_iris.h"
+#include "kombyne_data_celltype.h"
+#include "TinfCheck.h"
+
+using namespace VisKombyne;
+
+/* Legacy VTK binary data is big-endian */
+static inline void putInt32(std::vector<char>& buf, int32_t value)
+{
+  uint32_t u;
+  memcpy(&u, &value, sizeof(u));
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+  u = __builtin_bswap32(u);
+#endif
+  const char* c = (const char*)&u;
+  buf.insert(buf.end(), c, c+sizeof(u));
+}
+
+static inline void putDouble(std::vector<char>& buf, double value)
+{
+  uint64_t u;
+  memcpy(&u, &value, sizeof(u));
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+  u = __builtin_bswap64(u);
+#endif
+  const char* c = (const char*)&u;
+  buf.insert(buf.end(), c, c+sizeof(u));
+}
+
+static inline void putString(std::vector<char>& buf, const std::string& s)
+{
+  buf.insert(buf.end(), s.begin(), s.end());
+}
+
+static int32_t vtkCellType(int32_t celltype)
+{
+  switch( celltype ) {
+    case KB_CELLTYPE_TRI:   return 5;
+    case KB_CELLTYPE_QUAD:  return 9;
+    case KB_CELLTYPE_TET:   return 10;
+    case KB_CELLTYPE_PYR:   return 14;
+    case KB_CELLTYPE_WEDGE: return 13;
+    case KB_CELLTYPE_HEX:   return 12;
+  }
+  throw std::runtime_error("Unsupported VTK cell type");
+}
+
+
+VTKWriter::VTKWriter(void* comm) : m_comm(comm)
+{
+  int32_t error;
+
+  m_mpi_comm = MPI_Comm_f2c(tinf_iris_get_mpi_fcomm(m_comm, &error));
+  TINF_CHECK_SUCCESS(error, "Could not get writer communicator");
+  m_rank = tinf_iris_rank(m_comm, &error);
+  TINF_CHECK_SUCCESS(error, "Could not get writer rank");
+}
+
+void VTKWriter::write(const std::string& filename, const Extract& piece)
+{
+  int32_t error;
+
+  /* Piece sizes: points, cells and legacy cell list length (the interleaved
+   * cell type is replaced by the node count) */
+  int64_t local[3] = { piece.nPoints(), piece.nCells(),
+                       (int64_t)piece.connectivity().size() };
+  int64_t offset[3] = { 0, 0, 0 };
+  int64_t total[3] = { 0, 0, 0 };
+
+  MPI_Exscan(local, offset, 3, MPI_INT64_T, MPI_SUM, m_mpi_comm);
+  if( 0 == m_rank )
+    std::fill(offset, offset+3, 0);
+  MPI_Allreduce(local, total, 3, MPI_INT64_T, MPI_SUM, m_mpi_comm);
+
+  const std::vector<std::string>& names = piece.fieldNames();
+  const std::vector<std::vector<double> >& values = piece.fieldValues();
+
+  /* Section headers, rank 0 prepends them to its own data which always
+   * starts each section */
+  std::vector<std::string> headers;
+  std::stringstream ss;
+  ss << "# vtk DataFile Version 3.0\n" << filename << "\nBINARY\n"
+     << "DATASET UNSTRUCTURED_GRID\nPOINTS " << total[0] << " double\n";
+  headers.push_back(ss.str());
+  ss.str("");
+  ss << "\nCELLS " << total[1] << " " << total[2] << "\n";
+  headers.push_back(ss.str());
+  ss.str("");
+  ss << "\nCELL_TYPES " << total[1] << "\n";
+  headers.push_back(ss.str());
+  for( size_t f=0; f<names.size(); ++f ) {
+    ss.str("");
+    if( 0 == f )
+      ss << "\nPOINT_DATA " << total[0];
+    std::string name = names[f];
+    std::replace(name.begin(), name.end(), ' ', '_');
+    ss << "\nSCALARS " << name << " double 1\nLOOKUP_TABLE default\n";
+    headers.push_back(ss.str());
+  }
+
+  int64_t nsections = headers.size();
+  std::vector<int64_t> itemsize(nsections, sizeof(double));
+  itemsize[0] = 3*sizeof(double);
+  itemsize[1] = sizeof(int32_t);
+  itemsize[2] = sizeof(int32_t);
+  std::vector<int64_t> items(nsections, total[0]);
+  items[1] = total[2];
+  items[2] = total[1];
+  std::vector<int64_t> start(nsections, offset[0]);
+  start[1] = offset[2];
+  start[2] = offset[1];
+
+  if( 0 == m_rank )
+    std::remove(filename.c_str());
+  tinf_iris_barrier(m_comm);
+
+  int32_t fd;
+  error = tinf_iris_file_open(m_comm, filename.c_str(), filename.size(),
+                              MPI_MODE_CREATE|MPI_MODE_WRONLY, NULL, &fd);
+  TINF_CHECK_SUCCESS(error, "Could not open VTK file");
+
+  size_t base = 0;
+  std::vector<char> buffer;
+
+  for( int64_t s=0; s<nsections; ++s ) {
+    buffer.clear();
+    if( 0 == m_rank )
+      putString(buffer, headers[s]);
+
+    if( 0 == s ) {
+      const std::vector<double>& x = piece.x();
+      const std::vector<double>& y = piece.y();
+      const std::vector<double>& z = piece.z();
+      buffer.reserve(buffer.size() + local[0]*itemsize[0]);
+      for( int64_t i=0; i<local[0]; ++i ) {
+        putDouble(buffer, x[i]);
+        putDouble(buffer, y[i]);
+        putDouble(buffer, z[i]);
+      }
+    } else if( 1 == s ) {
+      const std::vector<int32_t>& conn = piece.connectivity();
+      buffer.reserve(buffer.size() + local[2]*itemsize[1]);
+      for( size_t i=0; i<conn.size(); ) {
+        int32_t n = Extract::nodesPerCell(conn[i++]);
+        putInt32(buffer, n);
+        for( int32_t j=0; j<n; ++j )
+          putInt32(buffer, conn[i++] + (int32_t)offset[0]);
+      }
+    } else if( 2 == s ) {
+      const std::vector<int32_t>& conn = piece.connectivity();
+      buffer.reserve(buffer.size() + local[1]*itemsize[2]);
+      for( size_t i=0; i<conn.size(); i+=Extract::nodesPerCell(conn[i])+1 )
+        putInt32(buffer, vtkCellType(conn[i]));
+    } else {
+      const std::vector<double>& v = values[s-3];
+      buffer.reserve(buffer.size() + local[0]*itemsize[s]);
+      for( int64_t i=0; i<local[0]; ++i )
+        putDouble(buffer, v[i]);
+    }
+
+    size_t at = base + (0 == m_rank ? 0 : headers[s].size() +
+                                          start[s]*itemsize[s]);
+    writeAt(fd, at, buffer);
+
+    base += headers[s].size() + items[s]*itemsize[s];
+  }
+
+  /* Terminate the last section */
+  buffer.clear();
+  if( 0 == m_rank )
+    putString(buffer, "\n");
+  writeAt(fd, base, buffer);
+
+  error = tinf_iris_file_close(m_comm, fd);
+  TINF_CHECK_SUCCESS(error, "Could not close VTK file");
+}
+
+/*
+ * Collective write of a byte buffer, the offset is in bytes from the start
+ * of the file.
+ */
+void VTKWriter::writeAt(int32_t fd, size_t offset, std::vector<char>& buffer)
+{
+  int32_t error;
+
+  error = tinf_iris_file_write_at_all(m_comm, TINF_CHAR, fd, offset,
+                                      buffer.data(), buffer.size());
+  TINF_CHECK_SUCCESS(error, "Could not write VTK file");
+}
@@ -0,0 +1,211 @@
+/*
+ *  Notices:
+ *  Copyright 2023 United States Government as represented by the
+ *  Administrator of the National Aeronautics and Space Administration.
+ *  No copyright is claimed in the United States under Title 17,
+ *  U.S. Code. All Other Rights Reserved.
+ *
+ *  Disclaimers No Warranty: THE SUBJECT SOFTWARE IS PROVIDED "AS
+ *  IS" WITHOUT ANY WARRANTY OF ANY KIND, EITHER EXPRESSED, IMPLIED,
+ *  OR STATUTORY, INCLUDING, BUT NOT LIMITED TO, ANY WARRANTY THAT
+ *  THE SUBJECT SOFTWARE WILL CONFORM TO SPECIFICATIONS, ANY IMPLIED
+ *  WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE,
+ *  OR FREEDOM FROM INFRINGEMENT, ANY WARRANTY THAT THE SUBJECT
+ *  SOFTWARE WILL BE ERROR FREE, OR ANY WARRANTY THAT DOCUMENTATION,
+ *  IF PROVIDED, WILL CONFORM TO THE SUBJECT SOFTWARE. THIS AGREEMENT
+ *  DOES NOT, IN ANY MANNER, CONSTITUTE AN ENDORSEMENT BY GOVERNMENT
+ *  AGENCY OR ANY PRIOR RECIPIENT OF ANY RESULTS, RESULTING DESIGNS,
+ *  HARDWARE, SOFTWARE PRODUCTS OR ANY OTHER APPLICATIONS RESULTING
+ *  FROM USE OF THE SUBJECT SOFTWARE.  FURTHER, GOVERNMENT AGENCY
+ *  DISCLAIMS ALL WARRANTIES AND LIABILITIES REGARDING THIRD-PARTY
+ *  SOFTWARE, IF PRESENT IN THE ORIGINAL SOFTWARE, AND DISTRIBUTES
+ *  IT "AS IS." 
+ *
+ *  Waiver and Indemnity:  RECIPIENT AGREES TO WAIVE ANY AND ALL
+ *  CLAIMS AGAINST THE UNITED STATES GOVERNMENT, ITS CONTRACTORS
+ *  AND SUBCONTRACTORS, AS WELL AS ANY PRIOR RECIPIENT.  IF RECIPIENT'S
+ *  USE OF THE SUBJECT SOFTWARE RESULTS IN ANY LIABILITIES, DEMANDS,
+ *  DAMAGES, EXPENSES OR LOSSES ARISING FROM SUCH USE, INCLUDING
+ *  ANY DAMAGES FROM PRODUCTS BASED ON, OR RESULTING FROM, RECIPIENT'S
+ *  USE OF THE SUBJECT SOFTWARE, RECIPIENT SHALL INDEMNIFY AND HOLD
+ *  HARMLESS THE UNITED STATES GOVERNMENT, ITS CONTRACTORS AND
+ *  SUBCONTRACTORS, AS WELL AS ANY PRIOR RECIPIENT, TO THE EXTENT
+ *  PERMITTED BY LAW.  RECIPIENT'S SOLE REMEDY FOR ANY SUCH MATTER
+ *  SHALL BE THE IMMEDIATE, UNILATERAL TERMINATION OF THIS AGREEMENT.
+ */
+
+#ifdef __GNUG__
+  #pragma implementation "WriteQueue.h"
+#endif
+
+#include <stdexcept>
+#include <string>
+#include <sstream>
+#include <iostream>
+#include <cfloat>
+#include <mpi.h>
+
+#include "WriteQueue.h"
+#include "tinf_iris.h"
+#include "pancake_cxx/ExecutionTimer.h"
+#include "TinfCheck.h"
+
+using namespace VisKombyne;
+
+WriteQueue::WriteQueue(void* comm, int32_t capacity) :
+  m_comm(comm), m_capacity(capacity), m_busy(false), m_stop(false),
+  m_max_depth(0), m_bytes(0.0), m_write_time(0.0), m_stall_time(0.0)
+{
+  int error;
+
+  if( m_capacity <= 0 ) {
+    m_capacity = 0;
+    return;
+  }
+
+  int provided;
+  MPI_Query_thread(&provided);
+  if( provided < MPI_THREAD_MULTIPLE ) {
+    if( 0 == tinf_iris_rank(m_comm, &error) )
+      std::cerr << "Write queue disabled: MPI_THREAD_MULTIPLE is not "
+                   "provided, native outputs are written synchronously"
+                << std::endl;
+    m_capacity = 0;
+    return;
+  }
+
+  m_thread = std::thread(&WriteQueue::run, this);
+}
+
+WriteQueue::~WriteQueue()
+{
+  if( !async() )
+    return;
+
+  {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_stop = true;
+  }
+  m_pushed.notify_one();
+  m_thread.join();
+}
+
+void WriteQueue::push(Writer* writer, const std::string& filename,
+                      Extract& piece)
+{
+  if( !async() ) {
+    pancake::ExecutionTimer timer;
+    m_bytes += piece.bytes();
+    writer->write(filename, piece);
+    m_write_time += timer.elapsed();
+    m_stall_time += timer.elapsed();
+    return;
+  }
+
+  std::unique_lock<std::mutex> lock(m_mutex);
+
+  pancake::ExecutionTimer timer;
+  while( depth() >= (size_t)m_capacity && !m_error )
+    m_popped.wait(lock);
+  m_stall_time += timer.elapsed();
+  rethrow();
+
+  m_items.push_back(Item());
+  Item& item = m_items.back();
+  item.writer = writer;
+  item.filename = filename;
+  std::swap(item.piece, piece);
+
+  if( depth() > m_max_depth )
+    m_max_depth = depth();
+
+  lock.unlock();
+  m_pushed.notify_one();
+}
+
+void WriteQueue::flush()
+{
+  if( !async() )
+    return;
+
+  std::unique_lock<std::mutex> lock(m_mutex);
+  pancake::ExecutionTimer timer;
+  while( (!m_items.empty() || m_busy) && !m_error )
+    m_popped.wait(lock);
+  m_stall_time += timer.elapsed();
+  rethrow();
+}
+
+void WriteQueue::report(int64_t step)
+{
+  int error;
+
+  double local[3], global[3];
+  {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    local[0] = m_max_depth;
+    local[1] = m_stall_time;
+    local[2] = (m_write_time > 0.0) ? -m_bytes/m_write_time : -DBL_MAX;
+    m_max_depth = depth();
+    m_bytes = m_write_time = m_stall_time = 0.0;
+  }
+
+  /* The throughput is reported for the slowest rank that wrote */
+  size_t dims[TINF_DATA_MAX_RANK] = {3, 1};
+  error = tinf_iris_max(m_comm, TINF_DOUBLE, 1, dims, local, global);
+  TINF_CHECK_SUCCESS(error, "Could not reduce write queue metrics");
+
+  if( 0 == tinf_iris_rank(m_comm, &error) )
+    std::cerr << "Write queue: step=" << step << ", depth=" << global[0]
+              << "/" << m_capacity << ", stall=" << global[1]
+              << "s, throughput="
+              << ((global[2] > -DBL_MAX) ? -global[2]/(1024.0*1024.0) : 0.0)
+              << "MB/s" << std::endl;
+}
+
+void WriteQueue::run()
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+
+  while( true ) {
+    while( m_items.empty() && !m_stop )
+      m_pushed.wait(lock);
+    if( m_items.empty() )
+      break;
+
+    Item item;
+    item.writer = m_items.front().writer;
+    item.filename.swap(m_items.front().filename);
+    std::swap(item.piece, m_items.front().piece);
+    m_items.pop_front();
+    m_busy = true;
+    lock.unlock();
+
+    pancake::ExecutionTimer timer;
+    size_t bytes = item.piece.bytes();
+    std::exception_ptr error;
+    try {
+      item.writer->write(item.filename, item.piece);
+    } catch(...) {
+      error = std::current_exception();
+    }
+    double seconds = timer.elapsed();
+
+    lock.lock();
+    m_busy = false;
+    m_bytes += bytes;
+    m_write_time += seconds;
+    if( error && !m_error )
+      m_error = error;
+    m_popped.notify_all();
+  }
+}
+
+void WriteQueue::rethrow()
+{
+  if( m_error ) {
+    std::exception_ptr error = m_error;
+    m_error = std::exception_ptr();
+    std::rethrow_exception(error);
+  }
+}
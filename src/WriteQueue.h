@@ -0,0 +1,130 @@
+#pragma once
+
+/*
+ *  Notices:
+ *  Copyright 2023 United States Government as represented by the
+ *  Administrator of the National Aeronautics and Space Administration.
+ *  No copyright is claimed in the United States under Title 17,
+ *  U.S. Code. All Other Rights Reserved.
+ *
+ *  Disclaimers No Warranty: THE SUBJECT SOFTWARE IS PROVIDED "AS
+ *  IS" WITHOUT ANY WARRANTY OF ANY KIND, EITHER EXPRESSED, IMPLIED,
+ *  OR STATUTORY, INCLUDING, BUT NOT LIMITED TO, ANY WARRANTY THAT
+ *  THE SUBJECT SOFTWARE WILL CONFORM TO SPECIFICATIONS, ANY IMPLIED
+ *  WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE,
+ *  OR FREEDOM FROM INFRINGEMENT, ANY WARRANTY THAT THE SUBJECT
+ *  SOFTWARE WILL BE ERROR FREE, OR ANY WARRANTY THAT DOCUMENTATION,
+ *  IF PROVIDED, WILL CONFORM TO THE SUBJECT SOFTWARE. THIS AGREEMENT
+ *  DOES NOT, IN ANY MANNER, CONSTITUTE AN ENDORSEMENT BY GOVERNMENT
+ *  AGENCY OR ANY PRIOR RECIPIENT OF ANY RESULTS, RESULTING DESIGNS,
+ *  HARDWARE, SOFTWARE PRODUCTS OR ANY OTHER APPLICATIONS RESULTING
+ *  FROM USE OF THE SUBJECT SOFTWARE.  FURTHER, GOVERNMENT AGENCY
+ *  DISCLAIMS ALL WARRANTIES AND LIABILITIES REGARDING THIRD-PARTY
+ *  SOFTWARE, IF PRESENT IN THE ORIGINAL SOFTWARE, AND DISTRIBUTES
+ *  IT "AS IS." 
+ *
+ *  Waiver and Indemnity:  RECIPIENT AGREES TO WAIVE ANY AND ALL
+ *  CLAIMS AGAINST THE UNITED STATES GOVERNMENT, ITS CONTRACTORS
+ *  AND SUBCONTRACTORS, AS WELL AS ANY PRIOR RECIPIENT.  IF RECIPIENT'S
+ *  USE OF THE SUBJECT SOFTWARE RESULTS IN ANY LIABILITIES, DEMANDS,
+ *  DAMAGES, EXPENSES OR LOSSES ARISING FROM SUCH USE, INCLUDING
+ *  ANY DAMAGES FROM PRODUCTS BASED ON, OR RESULTING FROM, RECIPIENT'S
+ *  USE OF THE SUBJECT SOFTWARE, RECIPIENT SHALL INDEMNIFY AND HOLD
+ *  HARMLESS THE UNITED STATES GOVERNMENT, ITS CONTRACTORS AND
+ *  SUBCONTRACTORS, AS WELL AS ANY PRIOR RECIPIENT, TO THE EXTENT
+ *  PERMITTED BY LAW.  RECIPIENT'S SOLE REMEDY FOR ANY SUCH MATTER
+ *  SHALL BE THE IMMEDIATE, UNILATERAL TERMINATION OF THIS AGREEMENT.
+ */
+
+#include <string>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+#include <cstdint>
+
+#include "Extract.h"
+#include "Writer.h"
+
+namespace VisKombyne
+{
+
+/**
+ * Bounded queue of native outputs drained by a writer thread.
+ *
+ * Extraction stays on the solver thread, the persistence of the extracted
+ * pieces is deferred to a dedicated thread so that slow file systems only
+ * stall the solver when the queue is full.  The writers issue MPI calls
+ * from that thread, so the queue requires MPI_THREAD_MULTIPLE and falls
+ * back to synchronous writes otherwise (or with a capacity of 0).
+ */
+class WriteQueue
+{
+  public:
+    /**
+     * Constructor.
+     *
+     * @param comm  Communications object
+     * @param capacity  Maximum number of pending outputs, including the one
+     *                  being written (0 for synchronous)
+     */
+    WriteQueue(void* comm, int32_t capacity);
+
+    /** Drains the queue and joins the writer thread */
+    ~WriteQueue();
+
+    inline bool async() const { return m_capacity > 0; }
+
+    /**
+     * Queue an output, blocking while the queue is full.  The piece is
+     * taken over by the queue and left empty.
+     *
+     * @param writer  Writer of the output, must outlive the queue
+     * @param filename  Output file name
+     * @param piece  Data to write
+     */
+    void push(Writer* writer, const std::string& filename, Extract& piece);
+
+    /** Wait until all the queued outputs are written */
+    void flush();
+
+    /**
+     * Log the queue metrics since the last report on rank 0 (collective).
+     */
+    void report(int64_t step);
+
+  private:
+    struct Item
+    {
+      Writer* writer;
+      std::string filename;
+      Extract piece;
+    };
+
+    void run();
+    /** Pending outputs, including the one being written */
+    inline size_t depth() const { return m_items.size() + (m_busy ? 1 : 0); }
+    inline void rethrow();
+
+  private:
+    void* m_comm;
+    int32_t m_capacity;
+
+    std::deque<Item> m_items;
+    bool m_busy;
+    bool m_stop;
+    std::exception_ptr m_error;
+    std::mutex m_mutex;
+    std::condition_variable m_pushed;
+    std::condition_variable m_popped;
+    std::thread m_thread;
+
+    /* Metrics since the last report */
+    size_t m_max_depth;
+    double m_bytes;
+    double m_write_time;
+    double m_stall_time;
+};
+
+} // namespace VisKombyne
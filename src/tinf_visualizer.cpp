@@ -40,15 +40,7 @@
 #include "tinf_iris.h"
 #include "tinf_visualizer.h"
 #include "Kombyne.h"
-
-#define TINF_CHECK_SUCCESS(error, msg) ({ \
-  if( TINF_SUCCESS != error ) { \
-    std::stringstream ss; \
-    ss << error; \
-    std::string message = std::string(msg) + ": " + ss.str(); \
-    throw std::runtime_error(message.c_str()); \
-  } \
-})
+#include "TinfCheck.h"
 
 int32_t
 tinf_visualizer_create(void **visual, void *problem, void *mesh,
@@ -87,8 +79,7 @@ tinf_visualizer(void *visual, _BOOL_ final_call)
   try {
     VisKombyne::Kombyne* vis = (VisKombyne::Kombyne*)(visual);
 
-    if( vis->processTimestep() )
-      vis->execute();
+    vis->visualize();
 
     return TINF_SUCCESS;
   } catch( std::runtime_error& e) {